@@ -0,0 +1,137 @@
+#!/bin/sh
+#
+# bench.sh: run cross-engine benchmark workloads.
+#
+# Copyright (c) 2001-2024 Michael P. Touloumtzis.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+
+# Each workload in bench/ is a template in one or more of the engines'
+# languages (lc, slc, mlc) with a size parameter, substituted either as
+# a decimal (@SIZE@) or as a Church numeral (@CHURCH@).  We run every
+# available engine/workload/size combination in a fresh process, scrape
+# the statistics each engine prints after its reduction, and write one
+# CSV row per run.  Rows come out in a fixed order and every column but
+# 'seconds' is deterministic, so reports from two builds diff cleanly.
+#
+# Steps are beta-reductions, the one unit all three engines share; peak
+# is the high-water mark of live heap nodes (terms, for lc) and gcs the
+# number of collections (for slc, completed mid-reduction sweeps).
+#
+# Usage: bench.sh [-T] [-t <timeout>] [<workload>...]
+#
+#	-T		Omit the timing column, for exact comparisons
+#	-t <seconds>	Per-run time limit (default 30)
+
+set -e
+
+BENCHDIR=bench
+TIMEOUT=30
+TIMING=y
+
+while getopts "Tt:" opt; do
+	case $opt in
+	T) TIMING= ;;
+	t) TIMEOUT=$OPTARG ;;
+	*) echo "Usage: $0 [-T] [-t <timeout>] [<workload>...]" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+# Workloads and the sizes at which to run them.
+WORKLOADS="
+church-pow	4 8 12
+ski-pow		4 8 12
+sort		2 4 8 16
+sudoku		20 40 60
+"
+
+TMPFILE=`mktemp`
+trap 'rm -f $TMPFILE $TMPFILE.out' EXIT
+
+church() {
+	case $1 in
+	mlc)	body=x; i=0
+		while [ $i -lt $2 ]; do body="$body; f"; i=$((i + 1)); done
+		printf "%s" "[f. [x. $body]]" ;;
+	*)	body=x; i=0
+		while [ $i -lt $2 ]; do body="f ($body)"; i=$((i + 1)); done
+		printf "%s" "(\\f x. $body)" ;;
+	esac
+}
+
+run() {
+	case $1 in
+	lc)	(cd src/lc; exec timeout $TIMEOUT ./lc) < $TMPFILE ;;
+	slc)	SLC_INCLUDE=lib/slc timeout $TIMEOUT src/slc/slc $TMPFILE ;;
+	mlc)	MLC_INCLUDE=lib/mlc timeout $TIMEOUT src/mlc/mlc -e $TMPFILE ;;
+	esac
+}
+
+# Only statistics printed after the last 'dt:' line count, so the values
+# belong to the final reduction and normal forms can't be mistaken for
+# statistics.  The engines print 'name value' pairs, which we collect.
+scrape() {
+	awk -v engine=$1 -v status=$2 -v timing=$TIMING '
+	$1 == "dt:" { split("", v); dt = $2; sub(/s$/, "", dt); next }
+	dt != "" {
+		for (i = 1; i < NF; ++i)
+			if ($(i + 1) ~ /^[0-9.]+$/) v[$i] = $(i + 1)
+	}
+	END {
+		if (dt == "") { status = status == "ok" ? "error" : status }
+		if (status != "ok") { printf "%s,,,%s\n", status, timing ? "," : ""; exit }
+		if (engine == "lc") steps = v["betas"]
+		else if (engine == "slc") steps = v["beta_value"] + v["beta_inert"]
+		else steps = v["beta"]
+		printf "%s,%s,%s,%s", status, steps, v["peak"], v["gcs"] + 0
+		if (timing) printf ",%s", dt
+		printf "\n"
+	}'
+}
+
+printf "engine,workload,size,status,steps,peak,gcs"
+[ -n "$TIMING" ] && printf ",seconds"
+printf "\n"
+
+echo "$WORKLOADS" | while read workload sizes; do
+	[ -n "$workload" ] || continue
+	if [ $# -gt 0 ]; then
+		case " $* " in *" $workload "*) ;; *) continue ;; esac
+	fi
+	for engine in lc slc mlc; do
+		template=$BENCHDIR/$workload.$engine
+		[ -f $template ] || continue
+		for size in $sizes; do
+			numeral=$(church $engine $size | sed 's/[\\&/]/\\&/g')
+			sed -e "s/@SIZE@/$size/g" -e "s/@CHURCH@/$numeral/g" \
+			    $template > $TMPFILE
+			if run $engine > $TMPFILE.out 2>&1; then
+				status=ok
+			elif [ $? -eq 124 ]; then
+				status=timeout
+			else
+				status=error
+			fi
+			printf "%s,%s,%s," $engine $workload $size
+			scrape $engine $status < $TMPFILE.out
+		done
+	done
+done
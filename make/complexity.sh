@@ -0,0 +1,256 @@
+#!/bin/sh
+#
+# complexity.sh: fit cost growth exponents over scalable term families.
+#
+# Copyright (c) 2024 Michael P. Touloumtzis.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+
+
+# SLC implements the SCAM, whose claim is reasonable cost: machine work
+# polynomial (in fact linear) in the number of beta-steps and the size of
+# the input, with O(1) transitions.  This script generates three families
+# of closed terms, each scaled by a parameter n, in the syntax of each
+# engine (lc, slc, mlc):
+#
+#	church-exp	2^n by Church exponentiation (2^n steps under
+#			sharing; the input grows only with n)
+#	size-explode	n nested applications of \x y. y x x, whose normal
+#			form has 2^n leaves but which takes n steps
+#	dup-arg		\x. x (x (... (x I))), with n occurrences, applied
+#			to an argument costing n steps; linear with shared
+#			arguments, quadratic when they're copied
+#
+# We run each engine on every family and size in a fresh process, scrape
+# steps (beta-reductions), machine transitions (eval_rl plus eval_lr, for
+# slc and mlc; lc isn't an abstract machine), nodes allocated, and the
+# reduction time, and fit each to a power law in the family's scale (2^n
+# for church-exp, n otherwise) by least squares on a log-log scale.  A
+# reasonable machine has exponents near 1 everywhere; a complexity
+# regression shows up as a changed exponent.  Costs which grow
+# exponentially in the scale are reported as such (see below).  Timings
+# are noisy at small sizes, so the deterministic exponents are the ones
+# to compare.
+#
+# Usage: complexity.sh [-r] [-T] [-t <timeout>] [<family>...]
+#
+#	-r		Report each run rather than fitted exponents
+#	-T		Omit timings, for exact comparisons
+#	-t <seconds>	Per-run time limit (default 30)
+
+set -e
+
+RAW=
+TIMEOUT=30
+TIMING=y
+
+while getopts "rTt:" opt; do
+	case $opt in
+	r) RAW=y ;;
+	T) TIMING= ;;
+	t) TIMEOUT=$OPTARG ;;
+	*) echo "Usage: $0 [-r] [-T] [-t <timeout>] [<family>...]" >&2
+	   exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+# Families and the sizes at which to run them.
+FAMILIES="
+church-exp	4 6 8 10 12
+size-explode	4 6 8 10 12
+dup-arg		8 16 32 64
+"
+
+TMPFILE=`mktemp`
+trap 'rm -f $TMPFILE $TMPFILE.out $TMPFILE.csv' EXIT
+
+# Term constructors in the syntax of $engine.
+lam() {
+	case $engine in
+	mlc)	printf "[%s. %s]" "$1" "$2" ;;
+	*)	printf "(\\\\%s. %s)" "$1" "$2" ;;
+	esac
+}
+
+app() {
+	case $engine in
+	mlc)	printf "%s (%s)" "$1" "$2" ;;
+	*)	printf "(%s %s)" "$1" "$2" ;;
+	esac
+}
+
+church() {
+	body=x; i=0
+	while [ $i -lt $1 ]; do body=$(app f "$body"); i=$((i + 1)); done
+	lam f "$(lam x "$body")"
+}
+
+church_exp() {
+	pow=$(lam b "$(lam e "$(app e b)")")
+	app "$(app "$pow" "$(church 2)")" "$(church $1)"
+}
+
+size_explode() {
+	dup=$(lam x "$(lam y "$(app "$(app y x)" x)")")
+	term=$(lam z z); i=0
+	while [ $i -lt $1 ]; do term=$(app "$dup" "$term"); i=$((i + 1)); done
+	printf "%s" "$term"
+}
+
+dup_arg() {
+	body=$(lam z z); i=0
+	while [ $i -lt $1 ]; do body=$(app x "$body"); i=$((i + 1)); done
+	id=$(lam z z)
+	app "$(lam x "$body")" "$(app "$(app "$(church $1)" "$id")" "$id")"
+}
+
+generate() {
+	case $1 in
+	church-exp)	church_exp $2 ;;
+	size-explode)	size_explode $2 ;;
+	dup-arg)	dup_arg $2 ;;
+	esac
+	[ $engine = mlc ] && printf "."
+	printf "\n"
+}
+
+run() {
+	case $1 in
+	lc)	(cd src/lc; exec timeout $TIMEOUT ./lc) < $TMPFILE ;;
+	slc)	timeout $TIMEOUT src/slc/slc -e $TMPFILE ;;
+	mlc)	timeout $TIMEOUT src/mlc/mlc -e $TMPFILE ;;
+	esac
+}
+
+# As in bench.sh, only the 'name value' pairs printed after the last 'dt:'
+# line count.
+scrape() {
+	awk -v engine=$1 -v status=$2 '
+	$1 == "dt:" { split("", v); dt = $2; sub(/s$/, "", dt); next }
+	dt != "" {
+		for (i = 1; i < NF; ++i)
+			if ($(i + 1) ~ /^[0-9.]+$/) v[$i] = $(i + 1)
+	}
+	END {
+		if (dt == "") { status = status == "ok" ? "error" : status }
+		if (status != "ok") { printf "%s,,,,\n", status; exit }
+		if (engine == "lc") steps = v["betas"]
+		else if (engine == "slc") steps = v["beta_value"] + v["beta_inert"]
+		else steps = v["beta"]
+		moves = engine == "lc" ? "" : v["eval_rl"] + v["eval_lr"]
+		printf "%s,%s,%s,%s,%s\n", status, steps, moves, v["allocs"], dt
+	}'
+}
+
+echo "$FAMILIES" | while read family sizes; do
+	[ -n "$family" ] || continue
+	if [ $# -gt 0 ]; then
+		case " $* " in *" $family "*) ;; *) continue ;; esac
+	fi
+	for engine in lc slc mlc; do
+		for size in $sizes; do
+			generate $family $size > $TMPFILE
+			if run $engine > $TMPFILE.out 2>&1; then
+				status=ok
+			elif [ $? -eq 124 ]; then
+				status=timeout
+			else
+				status=error
+			fi
+			printf "%s,%s,%s," $engine $family $size
+			scrape $engine $status < $TMPFILE.out
+		done
+	done
+done > $TMPFILE.csv
+
+if [ -n "$RAW" ]; then
+	printf "engine,family,size,status,steps,transitions,allocs"
+	[ -n "$TIMING" ] && printf ",seconds"
+	printf "\n"
+	if [ -n "$TIMING" ]; then
+		cat $TMPFILE.csv
+	else
+		sed 's/,[^,]*$//' $TMPFILE.csv
+	fi
+	exit 0
+fi
+
+# Fit log(metric) = k log(scale) + c over the successful runs of each
+# engine and family, and report k.  A power law is the wrong model for
+# exponential growth, where the fitted exponent just reflects the sizes
+# we happened to run, so we also fit log(metric) = s scale + c.  With at
+# least three points, if that fit leaves less than half the residual of
+# the log-log fit we report 'exp:b' instead, the metric growing about b
+# times per unit of scale.  Metrics with fewer than two nonzero points
+# are left blank.
+printf "engine,family,points,steps,transitions,allocs"
+[ -n "$TIMING" ] && printf ",seconds"
+printf "\n"
+awk -F, -v timing=$TIMING '
+# Residual sum of squares of the least-squares line through n points.
+function rss(n, sx, sy, sxx, sxy, syy,	d) {
+	d = n * sxx - sx * sx
+	return syy - sy * sy / n - (n * sxy - sx * sy) ^ 2 / (n * d)
+}
+function flush(	m, k, s, d, e, out) {
+	if (key == "") return
+	out = key "," npoints
+	for (m = 5; m <= (timing ? 8 : 7); ++m) {
+		if (n[m] < 2 || n[m] * sxx[m] == sx[m] * sx[m]) {
+			out = out ","
+			continue
+		}
+		k = n[m] * sxy[m] - sx[m] * sy[m]
+		k /= n[m] * sxx[m] - sx[m] * sx[m]
+		d = n[m] * szz[m] - sz[m] * sz[m]
+		e = n[m] >= 3 && d > 0
+		if (e) {
+			e = 2 * rss(n[m], sz[m], sy[m], szz[m], szy[m], syy[m])
+			e = e < rss(n[m], sx[m], sy[m], sxx[m], sxy[m], syy[m])
+		}
+		if (e) {
+			s = n[m] * szy[m] - sz[m] * sy[m]
+			s /= d
+			out = out sprintf(",exp:%.2f", exp(s))
+		} else
+			out = out sprintf(",%.2f", k)
+	}
+	print out
+	split("", n); split("", sx); split("", sy); split("", syy)
+	split("", sxx); split("", sxy)
+	split("", sz); split("", szz); split("", szy)
+	npoints = 0
+}
+{
+	if ($1 "," $2 != key) { flush(); key = $1 "," $2 }
+	if ($4 != "ok") next
+	++npoints
+	z = $2 == "church-exp" ? 2 ^ $3 : $3
+	x = log(z)
+	for (m = 5; m <= 8; ++m) {
+		if ($m == "" || $m <= 0) continue
+		y = log($m)
+		++n[m]; sx[m] += x; sy[m] += y; syy[m] += y * y
+		sxx[m] += x * x; sxy[m] += x * y
+		sz[m] += z; szz[m] += z * z; szy[m] += z * y
+	}
+}
+END { flush() }' $TMPFILE.csv
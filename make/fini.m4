@@ -54,12 +54,21 @@ d :=
 # don't know which tests map to which modules--so we associate test runs
 # with the subdir-level @test target.
 
+#
+# Tests may also keep a baseline of deterministic reduction costs in
+# test/foo.perf, which we compare with the costs the run wrote to
+# test/foo.runperf; a cost growing by more than $(PERF_TOLERANCE) percent
+# fails the test.  To accept new costs, copy foo.runperf over foo.perf.
+
 test-refs := $(sort $(wildcard $(subdir)test/*.ref))
-test-results := $(test-refs:.ref=.runout) $(test-refs:.ref=.runerr)
+test-perfs := $(sort $(wildcard $(subdir)test/*.perf))
+test-results := $(test-refs:.ref=.runout) $(test-refs:.ref=.runerr) \
+		$(test-perfs:.perf=.runperf)
 .SECONDARY: $(test-results)
 $(subdir)@testclean: clean-files := $(clean-files) $(test-results)
-$(subdir)@test: $(test-refs:.ref=.diff)
+$(subdir)@test: $(test-refs:.ref=.diff) $(test-perfs:.perf=.perfcheck)
 test-refs :=
+test-perfs :=
 test-results :=
 
 # Subdir-specific implicit rule; we can't add a global implicit rule
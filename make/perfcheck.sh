@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# perfcheck.sh: compare reduction costs against a baseline.
+#
+# Copyright (c) 2024 Michael P. Touloumtzis.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+#
+
+# Usage: perfcheck.sh <tolerance> <baseline> <actual>
+#
+# Both files hold 'metric count' lines, as written by e.g. mlc --perf.
+# The counts are deterministic, so any change reflects a change in the
+# code; we fail if a metric in the baseline grew by more than <tolerance>
+# percent (or went missing), and mention metrics which shrank by more
+# than that so the baseline can be refreshed.
+
+if [ $# -ne 3 ]; then
+	echo "Usage: $0 <tolerance> <baseline> <actual>" >&2
+	exit 1
+fi
+
+exec awk -v tolerance=$1 -v baseline=$2 -v actual=$3 '
+FNR == NR { base[$1] = $2; order[++n] = $1; next }
+{ seen[$1] = $2 }
+END {
+	status = 0
+	for (i = 1; i <= n; ++i) {
+		m = order[i]
+		if (!(m in seen)) {
+			printf "%s: %s missing\n", actual, m
+			status = 1
+		} else if (seen[m] > base[m] * (100 + tolerance) / 100) {
+			printf "%s: %s regressed from %d to %d\n",
+			       actual, m, base[m], seen[m]
+			status = 1
+		} else if (seen[m] < base[m] * (100 - tolerance) / 100) {
+			printf "%s: %s improved from %d to %d; " \
+			       "consider updating %s\n",
+			       actual, m, base[m], seen[m], baseline
+		}
+	}
+	exit status
+}' $2 $3
@@ -0,0 +1,2 @@
+make_library(libengine, memloc.c pool.c pressure.c stats.c trace.c)
+make_binary(enginetest, enginetest.c, engine util)
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <util/message.h>
+
+#include "pool.h"
+#include "pressure.h"
+#include "stats.h"
+
+#define NBLOCKS 10000
+
+static void *blocks [NBLOCKS];
+
+static struct {
+	unsigned long allocs, frees;
+	size_t largest;
+} the_pool_test_stats;
+
+static struct heap_pressure the_test_pressure = HEAP_PRESSURE_INIT;
+
+static const struct stat_desc the_pool_stat_descs [] = {
+	{ "allocs",	STAT_ULONG,	&the_pool_test_stats.allocs },
+	{ "frees",	STAT_ULONG,	&the_pool_test_stats.frees },
+	{ "largest",	STAT_SIZE,	&the_pool_test_stats.largest },
+};
+
+static const struct stat_desc the_pressure_stat_descs [] = {
+	{ "level",	STAT_FLOAT,	&the_test_pressure.level },
+	{ "threshold",	STAT_FLOAT,	&the_test_pressure.threshold },
+};
+
+static void *test_alloc(size_t bytes)
+{
+	void *block = pool_alloc(bytes);
+	size_t size = pool_block_size(block);
+	if (size < bytes || size % POOL_GRANULE)
+		panicf("pool_block_size: %zu for %zu bytes\n", size, bytes);
+	if ((uintptr_t) block % POOL_GRANULE)
+		panic("pool_alloc: misaligned block\n");
+	memset(block, 0xa5, bytes);
+	the_pool_test_stats.allocs++;
+	if (size > the_pool_test_stats.largest)
+		the_pool_test_stats.largest = size;
+	return block;
+}
+
+static void test_free(void *block)
+{
+	pool_free(block);
+	the_pool_test_stats.frees++;
+}
+
+static void run_pool_test(void)
+{
+	/* sizes cycle through every class and a few oversize blocks */
+	for (size_t i = 0; i < NBLOCKS; ++i)
+		blocks[i] = test_alloc(1 + (i * 37) % 1100);
+	for (size_t i = 0; i < NBLOCKS; i += 2)
+		test_free(blocks[i]);
+
+	/* freed blocks are recycled before slabs are carved further */
+	void *p = test_alloc(1 + ((NBLOCKS - 2) * 37) % 1100);
+	if (p != blocks[NBLOCKS - 2])
+		panic("pool_alloc: freed block not reused\n");
+	blocks[NBLOCKS - 2] = p;
+
+	for (size_t i = 1; i < NBLOCKS; i += 2)
+		test_free(blocks[i]);
+	for (size_t i = 0; i < NBLOCKS; i += 2)
+		if (i != NBLOCKS - 2)
+			blocks[i] = test_alloc(1 + (i * 37) % 1100);
+	for (size_t i = 0; i < NBLOCKS; i += 2)
+		test_free(blocks[i]);
+}
+
+static void run_pressure_test(void)
+{
+	heap_pressure_update(&the_test_pressure, 0, 0);
+	if (heap_pressure_high(&the_test_pressure))
+		panic("heap_pressure_high: empty heap\n");
+
+	/* high pressure after collecting raises the threshold... */
+	heap_pressure_update(&the_test_pressure, 95, 100);
+	if (!heap_pressure_high(&the_test_pressure))
+		panic("heap_pressure_high: full heap\n");
+	heap_pressure_calibrate(&the_test_pressure);
+	printf("full: level %g threshold %g\n",
+	       the_test_pressure.level, the_test_pressure.threshold);
+
+	/* ...and low pressure lowers it, but not below the minimum */
+	for (int i = 0; i < 4; ++i) {
+		heap_pressure_update(&the_test_pressure, 1, 100);
+		heap_pressure_calibrate(&the_test_pressure);
+		printf("empty: level %g threshold %g\n",
+		       the_test_pressure.level, the_test_pressure.threshold);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+	STATS_REGISTER("pool", the_pool_stat_descs);
+	STATS_REGISTER("pressure", the_pressure_stat_descs);
+	run_pool_test();
+	run_pressure_test();
+	stats_print_json(stdout);
+	return 0;
+}
@@ -1,5 +1,5 @@
-#ifndef LARK_MLC_MEMLOC_H
-#define LARK_MLC_MEMLOC_H
+#ifndef LARK_ENGINE_MEMLOC_H
+#define LARK_ENGINE_MEMLOC_H
 /*
  * Copyright (c) 2009-2022 Michael P. Touloumtzis.
  *
@@ -31,4 +31,4 @@
 
 extern const char *memloc(const void *addr);
 
-#endif /* LARK_MLC_MEMLOC_H */
+#endif /* LARK_ENGINE_MEMLOC_H */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <util/message.h>
+
+#include "pool.h"
+
+#define SLAB_BYTES ((size_t) 1 << 16)	/* must be a power of 2 */
+
+struct slab {
+	size_t blocksize;
+	char pad [POOL_GRANULE - sizeof (size_t)];
+	char blocks [];
+};
+
+struct pool_class {
+	void *free;			/* linked through the first word */
+	char *next, *end;		/* unused part of newest slab */
+};
+
+static struct pool_class the_classes [POOL_CLASSES];
+
+static struct slab *slab_alloc(size_t bytes, size_t blocksize)
+{
+	void *slab;
+	if (posix_memalign(&slab, SLAB_BYTES, bytes))
+		panic("Can't allocate pool slab\n");
+	((struct slab *) slab)->blocksize = blocksize;
+	return slab;
+}
+
+static inline struct slab *slab_of(const void *block)
+{
+	return (struct slab *) ((uintptr_t) block & ~(SLAB_BYTES - 1));
+}
+
+void *pool_alloc(size_t bytes)
+{
+	size_t c = bytes ? (bytes - 1) / POOL_GRANULE : 0,
+	       blocksize = (c + 1) * POOL_GRANULE;
+	if (c >= POOL_CLASSES)
+		return slab_alloc(sizeof (struct slab) + blocksize,
+				  blocksize)->blocks;
+
+	struct pool_class *pc = &the_classes[c];
+	void *block = pc->free;
+	if (block) {
+		pc->free = *(void **) block;
+		return block;
+	}
+
+	if (pc->next + blocksize > pc->end) {
+		struct slab *slab = slab_alloc(SLAB_BYTES, blocksize);
+		pc->next = slab->blocks;
+		pc->end = (char *) slab + SLAB_BYTES;
+	}
+	block = pc->next;
+	pc->next += blocksize;
+	return block;
+}
+
+void pool_free(void *block)
+{
+	assert(block);
+	struct slab *slab = slab_of(block);
+	size_t c = (slab->blocksize - 1) / POOL_GRANULE;
+	if (c >= POOL_CLASSES) {
+		free(slab);
+		return;
+	}
+	struct pool_class *pc = &the_classes[c];
+	*(void **) block = pc->free;
+	pc->free = block;
+}
+
+size_t pool_block_size(const void *block)
+{
+	return slab_of(block)->blocksize;
+}
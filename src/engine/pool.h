@@ -0,0 +1,46 @@
+#ifndef LARK_ENGINE_POOL_H
+#define LARK_ENGINE_POOL_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A size-class allocator for engine nodes.  Blocks are rounded up to a
+ * multiple of POOL_GRANULE bytes; each size class carves its blocks
+ * from aligned slabs and recycles them through its own free list, so
+ * allocating and freeing a node are a few instructions rather than a
+ * trip through malloc, and nodes of one size stay together.
+ *
+ * Each slab's header records its class, so pool_free() and
+ * pool_block_size() need only the block.  Blocks too large for any
+ * class get a slab to themselves, which is returned to malloc on free.
+ */
+
+#include <stddef.h>
+
+#define POOL_GRANULE 16
+#define POOL_CLASSES 64		/* blocks of up to 1K bytes */
+
+extern void *pool_alloc(size_t bytes);
+extern void pool_free(void *block);
+extern size_t pool_block_size(const void *block);
+
+#endif /* LARK_ENGINE_POOL_H */
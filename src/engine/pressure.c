@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2009-2022 Michael P. Touloumtzis.
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -20,30 +20,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include <stdbool.h>
+#include <assert.h>
 
-#include <util/wordtab.h>
-#include <util/symtab.h>
+#include "pressure.h"
 
-#include "memloc.h"
-
-#define MEMLOC_SIZE_HINT 100
-#define GENSYM_PREFIX_LENGTH 3		/* "gen" */
-
-static struct wordtab the_addr_syms;
-
-const char *memloc(const void *addr)
+void heap_pressure_calibrate(struct heap_pressure *hp)
 {
-	static bool initialized = false;
-	if (!initialized) {
-		wordtab_init(&the_addr_syms, MEMLOC_SIZE_HINT);
-		initialized = true;
-	}
-	symbol_mt sym = (symbol_mt) (word)
-		wordtab_get(&the_addr_syms, (word) addr);
-	if (!sym) {
-		sym = symtab_gensym();
-		wordtab_put(&the_addr_syms, (word) addr, (void*) (word) sym);
+	assert(hp->level >= 0.0);
+	assert(hp->level <  1.0);
+	assert(hp->threshold >= MIN_HEAP_THRESHOLD);
+	assert(hp->threshold <  1.0);
+	if (hp->level > hp->threshold * 0.666)
+		hp->threshold += (1.0 - hp->threshold) / 2.0;
+	else if (hp->level < hp->threshold * 0.333) {
+		hp->threshold *= 0.666;
+		if (hp->threshold < MIN_HEAP_THRESHOLD)
+			hp->threshold = MIN_HEAP_THRESHOLD;
 	}
-	return symtab_lookup(sym) + GENSYM_PREFIX_LENGTH;
 }
@@ -0,0 +1,62 @@
+#ifndef LARK_ENGINE_PRESSURE_H
+#define LARK_ENGINE_PRESSURE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Heap-pressure policy for collectors which run during reduction.
+ * Pressure is the fraction of the heap's capacity in use; reduction
+ * collects when it exceeds the threshold.  After each collection we
+ * recalibrate: if pressure is still high the threshold rises, so we
+ * don't thrash collecting little garbage, and if pressure is low it
+ * falls, so the next collection comes sooner.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_HEAP_PRESSURE 0.9
+#define MIN_HEAP_THRESHOLD 0.4
+
+struct heap_pressure {
+	float level, threshold;
+};
+
+#define HEAP_PRESSURE_INIT { 0.0, 0.6 }
+
+/*
+ * Called on every allocation and free, so inline.
+ */
+static inline void heap_pressure_update(struct heap_pressure *hp,
+					size_t used, size_t capacity)
+{
+	hp->level = capacity ? (float) used / (float) capacity : 0.0;
+	if (hp->level > MAX_HEAP_PRESSURE)
+		hp->level = MAX_HEAP_PRESSURE;
+}
+
+static inline bool heap_pressure_high(const struct heap_pressure *hp)
+	{ return hp->level > hp->threshold; }
+
+extern void heap_pressure_calibrate(struct heap_pressure *hp);
+
+#endif /* LARK_ENGINE_PRESSURE_H */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "stats.h"
+
+struct stat_entry {
+	const char *group;
+	struct stat_desc desc;
+};
+
+static struct stat_entry *the_stats;
+static size_t the_stats_used, the_stats_size;
+
+static struct stat_entry *stats_find(const char *group, const char *name)
+{
+	for (size_t i = 0; i < the_stats_used; ++i)
+		if (!strcmp(the_stats[i].group, group) &&
+		    !strcmp(the_stats[i].desc.name, name))
+			return &the_stats[i];
+	return NULL;
+}
+
+void stats_register(const char *group,
+		    const struct stat_desc *descs, size_t ndescs)
+{
+	for (size_t i = 0; i < ndescs; ++i) {
+		struct stat_entry *entry = stats_find(group, descs[i].name);
+		if (!entry) {
+			if (the_stats_used == the_stats_size) {
+				the_stats_size = the_stats_size ?
+					the_stats_size * 2 : 64;
+				the_stats = xrealloc(the_stats,
+					the_stats_size * sizeof the_stats[0]);
+			}
+			entry = &the_stats[the_stats_used++];
+		}
+		entry->group = group;
+		entry->desc = descs[i];
+	}
+}
+
+static void stat_print(FILE *fout, const struct stat_desc *desc)
+{
+	switch (desc->type) {
+	case STAT_ULONG:
+		fprintf(fout, "%lu", *(const unsigned long *) desc->value);
+		break;
+	case STAT_SIZE:
+		fprintf(fout, "%zu", *(const size_t *) desc->value);
+		break;
+	case STAT_FLOAT:
+		fprintf(fout, "%g", *(const float *) desc->value);
+		break;
+	case STAT_DOUBLE:
+		fprintf(fout, "%g", *(const double *) desc->value);
+		break;
+	default:
+		panicf("Unknown statistic type %d\n", desc->type);
+	}
+}
+
+/*
+ * Groups come out in order of first registration, so we print each
+ * group's entries when we meet its first entry.  The registry is small
+ * enough that the quadratic scan doesn't matter.
+ */
+void stats_print_json(FILE *fout)
+{
+	fputc('{', fout);
+	for (size_t i = 0, ngroups = 0; i < the_stats_used; ++i) {
+		const char *group = the_stats[i].group;
+		size_t j;
+		for (j = 0; j < i; ++j)
+			if (!strcmp(the_stats[j].group, group))
+				break;
+		if (j < i)
+			continue;	/* already printed */
+
+		fprintf(fout, "%s\n  \"%s\": {", ngroups++ ? "," : "", group);
+		for (j = i; j < the_stats_used; ++j) {
+			if (strcmp(the_stats[j].group, group))
+				continue;
+			fprintf(fout, "%s\n    \"%s\": ", j > i ? "," : "",
+				the_stats[j].desc.name);
+			stat_print(fout, &the_stats[j].desc);
+		}
+		fputs("\n  }", fout);
+	}
+	fputs("\n}\n", fout);
+}
+
+int stats_write_json(const char *pathname)
+{
+	FILE *fout = fopen(pathname, "w");
+	if (!fout)
+		return xperror(pathname);
+	stats_print_json(fout);
+	if (fclose(fout))
+		return xperror(pathname);
+	return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef LARK_ENGINE_STATS_H
+#define LARK_ENGINE_STATS_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A registry of named statistics, so that every engine's counters can
+ * be exported in one machine-readable form.  An engine registers the
+ * addresses of its counters once, in groups such as "eval" or "heap";
+ * values are read when exported, so registration costs nothing during
+ * reduction.  Exporting writes a JSON object with one member object per
+ * group, in order of registration.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+enum stat_type { STAT_ULONG, STAT_SIZE, STAT_FLOAT, STAT_DOUBLE };
+
+struct stat_desc {
+	const char *name;
+	enum stat_type type;
+	const void *value;
+};
+
+/*
+ * Registering a group and name already registered replaces the entry.
+ */
+extern void stats_register(const char *group,
+			   const struct stat_desc *descs, size_t ndescs);
+#define STATS_REGISTER(group, descs) \
+	stats_register(group, descs, sizeof descs / sizeof descs[0])
+extern void stats_print_json(FILE *fout);
+extern int stats_write_json(const char *pathname);
+
+#endif /* LARK_ENGINE_STATS_H */
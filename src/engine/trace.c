@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <util/message.h>
+
+#include "trace.h"
+
+static struct trace_header *the_trace_header;
+static struct trace_record *the_trace_ring;
+static size_t the_trace_length;
+static struct timespec the_trace_epoch;
+
+int trace_sink_open(const char *pathname, size_t capacity,
+		    const char *magic, uint32_t version)
+{
+	assert(!the_trace_header);
+	if (capacity == 0)
+		panic("Trace buffer capacity must be positive\n");
+	the_trace_length = sizeof (struct trace_header) +
+			   capacity * sizeof (struct trace_record);
+
+	int fd = open(pathname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return xperror(pathname);
+	if (ftruncate(fd, the_trace_length)) {
+		close(fd);
+		return xperror(pathname);
+	}
+	void *addr = mmap(NULL, the_trace_length, PROT_READ | PROT_WRITE,
+			  MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return xperror(pathname);
+
+	the_trace_header = addr;
+	memset(the_trace_header->magic, 0, sizeof the_trace_header->magic);
+	memcpy(the_trace_header->magic, magic,
+	       strnlen(magic, sizeof the_trace_header->magic));
+	the_trace_header->version = version;
+	the_trace_header->recsize = sizeof (struct trace_record);
+	the_trace_header->capacity = capacity;
+	the_trace_header->count = 0;
+	the_trace_ring = (struct trace_record *) (the_trace_header + 1);
+	clock_gettime(CLOCK_MONOTONIC, &the_trace_epoch);
+	return 0;
+}
+
+void trace_sink_close(void)
+{
+	if (!the_trace_header)
+		return;
+	munmap(the_trace_header, the_trace_length);
+	the_trace_header = NULL;
+	the_trace_ring = NULL;
+}
+
+void trace_sink_record(unsigned event, unsigned depth,
+		       const void *node, unsigned long aux)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	uint64_t count = the_trace_header->count++;
+	struct trace_record *rec =
+		&the_trace_ring[count % the_trace_header->capacity];
+	rec->nsec = (uint64_t) (now.tv_sec - the_trace_epoch.tv_sec) *
+		    1000000000 + now.tv_nsec - the_trace_epoch.tv_nsec;
+	rec->node = (uint32_t) ((uintptr_t) node >> 4);
+	rec->aux = aux > UINT32_MAX ? UINT32_MAX : aux;
+	rec->depth = depth > UINT16_MAX ? UINT16_MAX : depth;
+	rec->event = event;
+}
@@ -0,0 +1,61 @@
+#ifndef LARK_ENGINE_TRACE_H
+#define LARK_ENGINE_TRACE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Binary trace sink.  Rather than printing at every step, the sink
+ * appends fixed-size records to a ring buffer mmap'd from a file, so
+ * it can be left on for production-sized runs.  When the ring fills we
+ * overwrite the oldest records; the header's count says how many were
+ * ever written.  Since the buffer is a shared file mapping, a trace
+ * survives even if the interpreter panics or is killed.
+ *
+ * The sink doesn't interpret records: event numbers (and their names)
+ * belong to the engine, which also supplies the magic string and version
+ * identifying its trace files.  Node IDs are derived from node addresses,
+ * so they're only meaningful while the node is live.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct trace_record {
+	uint64_t nsec;		/* since trace_sink_open() */
+	uint32_t node, aux;
+	uint16_t depth;
+	uint8_t event, pad [5];
+};
+
+struct trace_header {
+	char magic [8];
+	uint32_t version, recsize;
+	uint64_t capacity, count;
+};
+
+extern int trace_sink_open(const char *pathname, size_t capacity,
+			   const char *magic, uint32_t version);
+extern void trace_sink_close(void);
+extern void trace_sink_record(unsigned event, unsigned depth,
+			      const void *node, unsigned long aux);
+
+#endif /* LARK_ENGINE_TRACE_H */
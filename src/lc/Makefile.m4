@@ -1,7 +1,23 @@
-make_binary(lc, alloc.c env.c heap.c include.c lc.l lc.y main.c
-	    readback.c reduce.c term.c, util)
+make_binary(lc, alloc.c env.c hashcons.c heap.c include.c lc.l lc.y
+	    main.c nbe.c perf.c readback.c reduce.c term.c, engine util)
+make_binary(lcloadbench, alloc.c env.c heap.c include.c lc.l lc.y
+	    lcloadbench.c term.c, engine util)
 
 # lc doesn't have a proper command-line interface and only works when
-# run from its root directory, so we feed it tests on stdin.
-%.runout %.runerr: %.lc $(subdir)lc
-	(cd src/lc; ./lc -q) < $*.lc > $*.runout 2> $*.runerr
+# run from its root directory, so we feed it tests on stdin (and give it
+# an absolute pathname for its costs).
+%.runout %.runerr %.runperf: %.lc $(subdir)lc
+	(cd src/lc; ./lc -q -p $(CURDIR)/$*.runperf) < $*.lc \
+		> $*.runout 2> $*.runerr
+
+# Tests named *-shared run with hash-consing, and should produce the same
+# output as without.
+%-shared.runout %-shared.runerr %-shared.runperf: %-shared.lc $(subdir)lc
+	(cd src/lc; ./lc -q -s -p $(CURDIR)/$*-shared.runperf) \
+		< $*-shared.lc > $*-shared.runout 2> $*-shared.runerr
+
+# Tests named *-nbe run another test's input through the environment-
+# based engine, which must produce the same normal forms.
+%-nbe.runout %-nbe.runerr %-nbe.runperf: %.lc $(subdir)lc
+	(cd src/lc; ./lc -q -e -p $(CURDIR)/$*-nbe.runperf) < $*.lc \
+		> $*-nbe.runout 2> $*-nbe.runerr
@@ -51,8 +51,11 @@ allocator_fini(struct allocator *alloc)
 struct term *
 allocator_push(struct allocator *alloc, struct term *term)
 {
-	if (alloc->used >= alloc->capacity)
-		panicf("Allocator at capacity: %s\n", alloc->name);
+	if (alloc->used >= alloc->capacity) {
+		alloc->capacity *= 2;
+		alloc->base = xrealloc(alloc->base,
+				       sizeof alloc->base[0] * alloc->capacity);
+	}
 	alloc->base[alloc->used++] = term;
 	return term;
 }
@@ -27,7 +27,7 @@
 
 #include <util/circlist.h>
 
-#define ALLOCATOR_DEFAULT_SLOTS 65536	/* should be enough for anyone */
+#define ALLOCATOR_DEFAULT_SLOTS 65536	/* initially; grows as needed */
 
 struct term;
 
@@ -24,12 +24,21 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <util/wordtab.h>
+
 #include "alloc.h"
 #include "env.h"
 #include "heap.h"
 #include "term.h"
 
+/*
+ * Definitions are kept in order on an allocator, which both roots them
+ * for the collector and serves env_dump(), and indexed by name; a
+ * redefinition replaces the index entry, so the latest one shadows the
+ * others.
+ */
 static struct allocator the_global_env = { .name = "Global environment" };
+static struct wordtab the_global_index;
 
 void
 env_dump(void)
@@ -44,21 +53,22 @@ void
 env_init(void)
 {
 	allocator_init(&the_global_env, ALLOCATOR_DEFAULT_SLOTS);
+	wordtab_init(&the_global_index, 0);
 }
 
 void
 env_install(struct term *sym)
 {
 	allocator_push(&the_global_env, sym);
+	wordtab_put(&the_global_index, sym->sym.name, sym);
 }
 
 struct term *
 env_lookup(symbol_mt name)
 {
-	for (size_t i = the_global_env.used; i; /* nada */) {
-		if (name == the_global_env.base[--i]->sym.name)
-			return the_global_env.base[i]->sym.body;
-	}
+	struct term *sym = wordtab_get(&the_global_index, name);
+	if (sym)
+		return sym->sym.body;
 	fprintf(stderr, "unbound symbol: %s\n", symtab_lookup(name));
 	return &the_error_term;
 }
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/memutil.h>
+
+#include "hashcons.h"
+#include "heap.h"
+#include "term.h"
+
+#define CONS_INITIAL 4096	/* power of two */
+#define MEMO_SIZE 16384		/* power of two; direct-mapped */
+
+bool hashcons_enabled;
+
+/*
+ * The cons table is open-addressed with linear probing and holds only
+ * term pointers; a term's own fields are its key.  Dead entries are
+ * dropped by rebuilding the table after each collection's mark phase,
+ * which avoids the need for tombstones.
+ */
+static struct term **the_cons;
+static size_t the_cons_capacity, the_cons_used;
+
+struct memo {
+	const void *kind, *payload;
+	const struct term *term;
+	int depth;
+	struct term *result;
+};
+
+static struct memo the_memo [MEMO_SIZE];
+static struct hashcons_stats the_stats;
+
+static inline size_t
+mix(uintptr_t a, uintptr_t b, uintptr_t c)
+{
+	uint64_t h = a * UINT64_C(0x9e3779b97f4a7c15);
+	h = (h ^ (h >> 29) ^ b) * UINT64_C(0xbf58476d1ce4e5b9);
+	h = (h ^ (h >> 27) ^ c) * UINT64_C(0x94d049bb133111eb);
+	return h ^ (h >> 31);
+}
+
+static inline size_t
+cons_hash(const struct term *term)
+{
+	switch (term->type) {
+	case ABS: return mix(ABS, term->abs.formal,
+			     (uintptr_t) term->abs.body);
+	case APP: return mix(APP, (uintptr_t) term->app.fun,
+			     (uintptr_t) term->app.arg);
+	default:  return mix(VAR, term->var.index, 0);
+	}
+}
+
+static void
+cons_insert(struct term *term)
+{
+	size_t mask = the_cons_capacity - 1;
+	size_t i = cons_hash(term) & mask;
+	while (the_cons[i])
+		i = (i + 1) & mask;
+	the_cons[i] = term;
+	the_cons_used++;
+}
+
+/*
+ * Rebuild the table at the given capacity, keeping only entries the
+ * collector has marked (all of them, outside of collection).
+ */
+static void
+cons_rebuild(size_t capacity)
+{
+	struct term **old = the_cons;
+	size_t oldcap = the_cons_capacity;
+	the_cons = xmalloc(capacity * sizeof the_cons[0]);
+	memset(the_cons, 0, capacity * sizeof the_cons[0]);
+	the_cons_capacity = capacity;
+	the_cons_used = 0;
+	for (size_t i = 0; i < oldcap; ++i)
+		if (old[i] && heap_term_live(old[i]))
+			cons_insert(old[i]);
+	free(old);
+}
+
+static void
+hashcons_weak(void)
+{
+	cons_rebuild(the_cons_capacity);
+	memset(the_memo, 0, sizeof the_memo);
+}
+
+static void
+cons_init(void)
+{
+	the_cons = xmalloc(CONS_INITIAL * sizeof the_cons[0]);
+	memset(the_cons, 0, CONS_INITIAL * sizeof the_cons[0]);
+	the_cons_capacity = CONS_INITIAL;
+	heap_weak_register(hashcons_weak);
+}
+
+/*
+ * Return an existing term equal to 'probe', if there is one.
+ */
+static struct term *
+cons_lookup(const struct term *probe)
+{
+	if (!the_cons)
+		cons_init();
+	size_t mask = the_cons_capacity - 1;
+	for (size_t i = cons_hash(probe) & mask; the_cons[i];
+	     i = (i + 1) & mask) {
+		const struct term *term = the_cons[i];
+		if (term->type != probe->type)
+			continue;
+		switch (term->type) {
+		case ABS:
+			if (term->abs.formal == probe->abs.formal &&
+			    term->abs.body == probe->abs.body)
+				goto found;
+			break;
+		case APP:
+			if (term->app.fun == probe->app.fun &&
+			    term->app.arg == probe->app.arg)
+				goto found;
+			break;
+		default:
+			if (term->var.index == probe->var.index &&
+			    !term->var.name)
+				goto found;
+			break;
+		}
+		continue;
+	found:
+		the_stats.shared++;
+		return the_cons[i];
+	}
+	return NULL;
+}
+
+/*
+ * Enter a newly built term.  Building it may have triggered a
+ * collection, which rebuilds the table, so we can't reuse the slot the
+ * failed lookup ended on.
+ */
+static struct term *
+cons_enter(struct term *term)
+{
+	if (2 * (the_cons_used + 1) > the_cons_capacity)
+		cons_rebuild(2 * the_cons_capacity);
+	cons_insert(term);
+	return term;
+}
+
+struct term *
+hashcons_abs(symbol_mt formal, struct term *body)
+{
+	struct term probe = { .type = ABS };
+	probe.abs.formal = formal;
+	probe.abs.body = body;
+	struct term *term = cons_lookup(&probe);
+	return term ? term : cons_enter(Abs(formal, body));
+}
+
+struct term *
+hashcons_app(struct term *fun, struct term *arg)
+{
+	struct term probe = { .type = APP };
+	probe.app.fun = fun;
+	probe.app.arg = arg;
+	struct term *term = cons_lookup(&probe);
+	return term ? term : cons_enter(App(fun, arg));
+}
+
+struct term *
+hashcons_var(int index)
+{
+	struct term probe = { .type = VAR };
+	probe.var.index = index;
+	probe.var.name = 0;
+	struct term *term = cons_lookup(&probe);
+	return term ? term : cons_enter(VarI(index));
+}
+
+static inline struct memo *
+memo_slot(const void *kind, const void *payload,
+	  const struct term *term, int depth)
+{
+	return &the_memo[mix((uintptr_t) term ^ (uintptr_t) kind,
+			     (uintptr_t) payload, depth) & (MEMO_SIZE - 1)];
+}
+
+struct term *
+hashcons_memo_get(const void *kind, const void *payload,
+		  const struct term *term, int depth)
+{
+	struct memo *memo = memo_slot(kind, payload, term, depth);
+	if (memo->term != term || memo->kind != kind ||
+	    memo->payload != payload || memo->depth != depth)
+		return NULL;
+	the_stats.memo++;
+	return memo->result;
+}
+
+void
+hashcons_memo_put(const void *kind, const void *payload,
+		  const struct term *term, int depth, struct term *result)
+{
+	struct memo *memo = memo_slot(kind, payload, term, depth);
+	memo->kind = kind;
+	memo->payload = payload;
+	memo->term = term;
+	memo->depth = depth;
+	memo->result = result;
+}
+
+struct hashcons_stats
+hashcons_stats(void)
+{
+	the_stats.terms = the_cons_used;
+	return the_stats;
+}
@@ -0,0 +1,65 @@
+#ifndef LARK_LC_HASHCONS_H
+#define LARK_LC_HASHCONS_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+#include <util/symtab.h>
+
+struct term;
+
+/*
+ * Optional hash-consing for terms built during reduction.  With it
+ * enabled, structurally equal terms (same type, children and index)
+ * share a single cell, and the results of shifting and substituting
+ * into a subterm are memoized, so shared subterms are rewritten only
+ * once.  Parsed terms aren't consed: term_index() assigns their de
+ * Bruijn indexes destructively.
+ *
+ * Both tables are weak; the collector drops entries for dead terms,
+ * and the memo table is simply cleared at each collection.
+ */
+extern bool hashcons_enabled;
+
+extern struct term *hashcons_abs(symbol_mt formal, struct term *body);
+extern struct term *hashcons_app(struct term *fun, struct term *arg);
+extern struct term *hashcons_var(int index);
+
+/*
+ * Memoization of traversal results, keyed on the traversal (kind and
+ * payload), the subterm and the abstraction depth at which it occurs.
+ */
+extern struct term *hashcons_memo_get(const void *kind, const void *payload,
+				      const struct term *term, int depth);
+extern void hashcons_memo_put(const void *kind, const void *payload,
+			      const struct term *term, int depth,
+			      struct term *result);
+
+struct hashcons_stats {
+	unsigned long shared, memo;
+	size_t terms;
+};
+
+extern struct hashcons_stats hashcons_stats(void);
+
+#endif /* LARK_LC_HASHCONS_H */
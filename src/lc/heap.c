@@ -21,19 +21,87 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
 
+#include <engine/clock.h>
+#include <engine/stats.h>
+#include <util/memutil.h>
 #include <util/message.h>
 
 #include "alloc.h"
 #include "heap.h"
 #include "term.h"
 
-#define MAXTERM 100000
+/*
+ * The heap is a single reservation of address space into which chunks
+ * of terms are committed as the heap grows, so terms never move and
+ * membership is a range check.  Mark bits live in a side bitmap, which
+ * makes clearing them a memset proportional to the number of chunks
+ * rather than a walk over every term.  Sweeping is lazy: after marking
+ * we only reset a cursor, and allocation sweeps one chunk at a time as
+ * the free list runs dry.
+ *
+ * Collection is generational using sticky mark bits.  Terms are
+ * immutable once built, so surviving a collection makes a term old; a
+ * minor collection leaves the bitmap alone, which stops marking at old
+ * terms and reclaims only the young terms allocated since--mostly the
+ * short-lived copies made by shift and substitution.  Symbols are the
+ * one exception to immutability (their bodies are assigned after
+ * parsing), so old symbols given young bodies are remembered and
+ * treated as roots.  When a minor collection recovers too little we
+ * fall back to a major one, and when a major collection leaves the
+ * heap more than a third full we grow it.
+ *
+ * The mark phase is chosen at build time.  By default it reverses
+ * pointers, needing no memory beyond the terms themselves.  Defining
+ * MARK_STACK uses an explicit mark stack instead, with a small FIFO of
+ * prefetched terms in front of it, which writes each term's mark bit
+ * but not the term; MARK_PARALLEL (which implies MARK_STACK) also
+ * spreads the roots over several threads that share work on demand and
+ * claim terms with atomic updates to the bitmap.
+ */
+#if defined(MARK_PARALLEL) && !defined(MARK_STACK)
+#define MARK_STACK
+#endif
+
+#ifdef MARK_PARALLEL
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define CHUNK_TERMS 65536		/* terms committed at a time */
+#define CHUNK_WORDS (CHUNK_TERMS / 64)	/* mark bitmap words per chunk */
+#define INITIAL_CHUNKS 2
+#define MAX_CHUNKS 4096			/* address space reserved, in chunks */
 
 bool show_gc = true;
-static struct term terms [MAXTERM];
+static struct term *heap_terms;	/* base of the reservation */
+static size_t heap_nterms;	/* terms committed */
+static size_t heap_maxterms;	/* terms reserved */
+static uint64_t *heap_marks;	/* one bit per committed term */
+static size_t sweep_next;	/* first term not yet swept */
 static struct term *termfree;	/* free list */
+static size_t nlive;		/* live at last gc + allocated since */
+static struct heap_stats the_heap_stats;
+
+static const struct stat_desc the_heap_stat_descs [] = {
+	{ "allocs",	STAT_ULONG,	&the_heap_stats.allocs },
+	{ "gcs",	STAT_ULONG,	&the_heap_stats.gcs },
+	{ "majors",	STAT_ULONG,	&the_heap_stats.majors },
+	{ "peak",	STAT_SIZE,	&the_heap_stats.peak },
+	{ "size",	STAT_SIZE,	&the_heap_stats.size },
+	{ "gctime",	STAT_DOUBLE,	&the_heap_stats.seconds },
+};
+
+#define MAXWEAK 4
+static heap_weak_fn *the_weak [MAXWEAK];	/* see heap_weak_register() */
+static size_t nweak;
+
+static struct term **remembered;	/* old symbols with new bodies */
+static size_t nremembered, maxremembered;
 
 static struct circlist the_allocators_sentinel;
 
@@ -46,30 +114,119 @@ heap_mark_allocators(void);
 static void
 term_mark(struct term *term);
 
+static void
+mark_finish(void);
+
+static inline bool
+heap_contains(const struct term *term)
+{
+	return (uintptr_t) term - (uintptr_t) heap_terms <
+		heap_nterms * sizeof *term;
+}
+
+/*
+ * Terms outside the heap (the error term and the reducer's spine
+ * markers) are never collected, so they count as marked.
+ */
+static inline bool
+term_marked(const struct term *term)
+{
+	if (!heap_contains(term))
+		return true;
+	size_t i = term - heap_terms;
+	return heap_marks[i / 64] & (UINT64_C(1) << (i % 64));
+}
+
+static inline void
+term_set_mark(const struct term *term)
+{
+	size_t i = term - heap_terms;
+	heap_marks[i / 64] |= UINT64_C(1) << (i % 64);
+}
+
+/*
+ * Mark a term if it isn't already, returning whether we marked it.
+ */
+static inline bool
+term_claim(const struct term *term)
+{
+	if (!heap_contains(term))
+		return false;
+	size_t i = term - heap_terms;
+	uint64_t bit = UINT64_C(1) << (i % 64);
+#ifdef MARK_PARALLEL
+	if (__atomic_load_n(&heap_marks[i / 64], __ATOMIC_RELAXED) & bit)
+		return false;
+	return !(__atomic_fetch_or(&heap_marks[i / 64], bit,
+				   __ATOMIC_RELAXED) & bit);
+#else
+	if (heap_marks[i / 64] & bit)
+		return false;
+	heap_marks[i / 64] |= bit;
+	return true;
+#endif
+}
+
+/*
+ * Put a chunk's worth of unmarked terms on the free list.
+ */
+static void
+sweep_chunk(void)
+{
+	size_t w = sweep_next / 64, end = w + CHUNK_WORDS;
+	for (/* nada */; w < end; ++w) {
+		for (uint64_t free = ~heap_marks[w]; free; free &= free - 1) {
+			struct term *term =
+				heap_terms + w * 64 + __builtin_ctzll(free);
+			term->type = GBG;
+			term->gbg.nextfree = termfree;
+			termfree = term;
+		}
+	}
+	sweep_next += CHUNK_TERMS;
+}
+
 struct term *
 term_alloc(struct term *root1, struct term *root2)
 {
-	if (!termfree)
-		gc(root1, root2);
+	while (!termfree) {
+		if (sweep_next < heap_nterms)
+			sweep_chunk();
+		else
+			gc(root1, root2);
+	}
 	struct term *tmp = termfree;
 	termfree = termfree->gbg.nextfree;
+	the_heap_stats.allocs++;
+	if (++nlive > the_heap_stats.peak)
+		the_heap_stats.peak = nlive;
 	return tmp;
 }
 
-static void
-gc(struct term *root1, struct term *root2)
+static bool
+heap_grow(void)
 {
-	const ssize_t nterms = sizeof terms / sizeof terms[0];
-	ssize_t i, nc = 0, nf = 0, nu = 0;
-
-	if (show_gc) {
-		fprintf(stderr, "gc: ");
-		fflush(stderr);
-	}
+	if (heap_nterms >= heap_maxterms)
+		return false;
+	if (mprotect(heap_terms + heap_nterms,
+		     CHUNK_TERMS * sizeof heap_terms[0],
+		     PROT_READ | PROT_WRITE))
+		return false;
+	heap_marks = xrealloc(heap_marks, (heap_nterms + CHUNK_TERMS) / 8);
+	memset(heap_marks + heap_nterms / 64, 0, CHUNK_WORDS * 8);
+	heap_nterms += CHUNK_TERMS;
+	return true;
+}
 
-	/* clear marks */
-	for (i = nterms; --i >= 0; /* nada */)
-		terms[i].mark = 0;
+static size_t
+mark(bool major, struct term *root1, struct term *root2)
+{
+	if (major)
+		memset(heap_marks, 0, heap_nterms / 8);
+	else
+		for (size_t i = 0; i < nremembered; ++i)
+			term_mark(remembered[i]->sym.body);
+	nremembered = 0;
 
 	/* mark roots registered via allocators */
 	heap_mark_allocators();
@@ -78,41 +235,125 @@ gc(struct term *root1, struct term *root2)
 	term_mark(root1);
 	term_mark(root2);
 
-	/* sweep */
-	for (i = nterms; --i >= 0; /* nada */) {
-		if (terms[i].mark != 0 && terms[i].mark != 1)
-			panicf("Invalid term mark %u, type %d\n",
-			       terms[i].mark, terms[i].type);
-		if (terms[i].type == GBG)
-			++nf;
-		else if (terms[i].mark)
-			++nu;
-		else {
-			terms[i].type = GBG;
-			terms[i].gbg.nextfree = termfree;
-			termfree = terms + i;
-			++nc;
-		}
+	mark_finish();
+
+	size_t nmarked = 0;
+	for (size_t w = heap_nterms / 64; w--; /* nada */)
+		nmarked += __builtin_popcountll(heap_marks[w]);
+	return nmarked;
+}
+
+/*
+ * Only called once the whole heap has been swept and the free list is
+ * empty, so every unmarked term is garbage or already free.
+ */
+static void
+gc(struct term *root1, struct term *root2)
+{
+	if (show_gc) {
+		fprintf(stderr, "gc: ");
+		fflush(stderr);
+	}
+
+	double t0 = clock_seconds();
+
+	bool major = false;
+	size_t nu = mark(false, root1, root2);
+	if (heap_nterms - nu < heap_nterms / 4) {
+		major = true;
+		nu = mark(true, root1, root2);
+		while (nu > heap_nterms / 3 && heap_grow())
+			/* nada */;
 	}
 
+	for (size_t i = 0; i < nweak; ++i)
+		(*the_weak[i])();
+
+	the_heap_stats.seconds += clock_seconds() - t0;
+
+	sweep_next = 0;
+	nlive = nu;
+	the_heap_stats.gcs++;
+	if (major)
+		the_heap_stats.majors++;
+	if (heap_nterms > the_heap_stats.size)
+		the_heap_stats.size = heap_nterms;
+
 	if (show_gc)
-		fprintf(stderr, "%zu used + %zu collected + %zu free = %zu\n",
-				nu, nc, nf, nu + nc + nf);
-	if (nc + nf == 0)
+		fprintf(stderr, "%s %zu used + %zu free = %zu\n",
+			major ? "major" : "minor",
+			nu, heap_nterms - nu, heap_nterms);
+	if (nu == heap_nterms)
 		panic("Exhausted term heap\n");
 }
 
 void
 heap_init(void)
 {
-	ssize_t i = sizeof terms / sizeof terms[0];
-	while (--i >= 0) {
-		terms[i].type = GBG;
-		terms[i].mark = 0;
-		terms[i].gbg.nextfree = termfree;
-		termfree = terms + i;
+	size_t bytes = MAX_CHUNKS * CHUNK_TERMS * sizeof heap_terms[0];
+	void *base = MAP_FAILED;
+	for (/* nada */; bytes >= INITIAL_CHUNKS * CHUNK_TERMS *
+			sizeof heap_terms[0]; bytes /= 2) {
+		base = mmap(NULL, bytes, PROT_NONE,
+			    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			    -1, 0);
+		if (base != MAP_FAILED)
+			break;
 	}
+	if (base == MAP_FAILED)
+		panic("Can't reserve term heap\n");
+	heap_terms = base;
+	heap_maxterms = bytes / sizeof heap_terms[0];
+	heap_maxterms -= heap_maxterms % CHUNK_TERMS;
+	for (int i = 0; i < INITIAL_CHUNKS; ++i)
+		if (!heap_grow())
+			panic("Can't commit term heap\n");
 	circlist_init(&the_allocators_sentinel);
+	STATS_REGISTER("heap", the_heap_stat_descs);
+}
+
+bool
+heap_term_live(const struct term *term)
+{
+	return term_marked(term);
+}
+
+void
+heap_weak_register(heap_weak_fn *fn)
+{
+	if (nweak == MAXWEAK)
+		panic("Too many weak reference holders\n");
+	the_weak[nweak++] = fn;
+}
+
+void
+heap_write_barrier(struct term *term)
+{
+	if (!heap_contains(term) || !term_marked(term))
+		return;
+	if (nremembered == maxremembered) {
+		maxremembered = maxremembered ? maxremembered * 2 : 64;
+		remembered = xrealloc(remembered,
+				      maxremembered * sizeof remembered[0]);
+	}
+	remembered[nremembered++] = term;
+}
+
+void
+heap_stats_reset(void)
+{
+	the_heap_stats.allocs = 0;
+	the_heap_stats.gcs = 0;
+	the_heap_stats.majors = 0;
+	the_heap_stats.seconds = 0.0;
+	the_heap_stats.peak = nlive;
+	the_heap_stats.size = heap_nterms;
+}
+
+struct heap_stats
+heap_stats(void)
+{
+	return the_heap_stats;
 }
 
 static void
@@ -139,8 +380,12 @@ heap_allocator_deregister(struct allocator *alloc)
 	circlist_remove(&alloc->entry);
 }
 
+#ifndef MARK_STACK
+
 /*
- * Pointer-reversing mark operation.
+ * Pointer-reversing mark operation.  Completion is recorded in the mark
+ * bitmap; the term's own mark field holds only the transient traversal
+ * state (2 or 3 while a term's children are being visited, 0 otherwise).
  */
 static void
 term_mark(struct term *term)
@@ -150,10 +395,20 @@ term_mark(struct term *term)
 	for (last = NULL; term != NULL; last = term, term = next) {
 		switch (term->mark) {
 		case 0:
+			/*
+			 * Term is already marked (or old, during a minor
+			 * collection)--reverse course.
+			 */
+			if (term_marked(term)) {
+				next = last;
+				break;
+			}
+
 			/*
 			 * First encounter with the term; traverse the
 			 * first outgoing link, if one exists.
 			 */
+			term_set_mark(term);
 			switch (term->type) {
 			case ABS:
 				term->mark = 2;
@@ -170,31 +425,22 @@ term_mark(struct term *term)
 					term->mark = 2;
 					next = term->sym.body;
 					term->sym.body = last;
-				} else {
-					term->mark = 1;
+				} else
 					next = last;
-				}
 				break;
 			case ERR:
 			case VAR:
-				term->mark = 1;
 				next = last;
 				break;
 			default:
 				panic("Invalid term while marking\n");
 			}
 			break;
-		case 1:
-			/*
-			 * Term is completely marked--reverse course.
-			 */
-			next = last;
-			break;
 		case 2:
 			/*
 			 * Need to backtrack through this term.
 			 */
-			term->mark--;
+			term->mark = 0;
 			switch (term->type) {
 			case ABS:
 				next = term->abs.body;
@@ -235,3 +481,281 @@ term_mark(struct term *term)
 		}
 	}
 }
+
+static void
+mark_finish(void)
+{
+	/* pointer reversal marks each root as it's found */
+}
+
+#else /* MARK_STACK */
+
+struct mark_stack {
+	struct term **items;
+	size_t used, capacity;
+};
+
+static inline void
+mark_stack_push(struct mark_stack *stack, struct term *term)
+{
+	if (stack->used == stack->capacity) {
+		stack->capacity = stack->capacity ? stack->capacity * 2 : 1024;
+		stack->items = xrealloc(stack->items, stack->capacity *
+					sizeof stack->items[0]);
+	}
+	stack->items[stack->used++] = term;
+}
+
+/*
+ * Claim a term for marking and queue it for scanning.
+ */
+static inline void
+mark_push(struct mark_stack *stack, struct term *term)
+{
+	if (term && term_claim(term))
+		mark_stack_push(stack, term);
+}
+
+#ifdef MARK_PARALLEL
+static void mark_share(struct mark_stack *stack);
+#endif
+
+/*
+ * Scan terms until the stack is empty.  Terms popped from the stack
+ * pass through a short FIFO, prefetched on entry, so that by the time
+ * we read a term's children it's likely to be in cache.
+ */
+#define PREFETCH_DEPTH 8
+
+static void
+mark_drain(struct mark_stack *stack)
+{
+	struct term *fifo [PREFETCH_DEPTH];
+	unsigned head = 0, count = 0;
+
+	for (;;) {
+		while (count < PREFETCH_DEPTH && stack->used) {
+			struct term *term = stack->items[--stack->used];
+			__builtin_prefetch(term);
+			fifo[(head + count++) % PREFETCH_DEPTH] = term;
+		}
+		if (!count)
+			break;
+		struct term *term = fifo[head];
+		head = (head + 1) % PREFETCH_DEPTH;
+		count--;
+
+		switch (term->type) {
+		case ABS:
+			mark_push(stack, term->abs.body);
+			break;
+		case APP:
+			mark_push(stack, term->app.arg);
+			mark_push(stack, term->app.fun);
+			break;
+		case SYM:
+			mark_push(stack, term->sym.body);
+			break;
+		case ERR:
+		case VAR:
+			break;
+		default:
+			panic("Invalid term while marking\n");
+		}
+#ifdef MARK_PARALLEL
+		mark_share(stack);
+#endif
+	}
+}
+
+#ifndef MARK_PARALLEL
+
+static struct mark_stack the_mark_stack;
+
+static void
+term_mark(struct term *term)
+{
+	mark_push(&the_mark_stack, term);
+}
+
+static void
+mark_finish(void)
+{
+	mark_drain(&the_mark_stack);
+}
+
+#else /* MARK_PARALLEL */
+
+/*
+ * Roots are gathered during the usual root scan and then divided among
+ * the marking threads.  A thread that runs out of work waits on a
+ * shared pool; a busy thread with spare work moves half of its stack to
+ * the pool whenever it sees someone waiting.  Marking ends when every
+ * thread is waiting and the pool is empty.
+ */
+#define MAX_MARKERS 8
+#define SHARE_MIN 64	/* don't bother sharing fewer terms */
+
+static struct mark_stack the_roots;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	struct mark_stack work;
+	unsigned nthreads, waiting;
+	bool done;
+} the_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wakeup = PTHREAD_COND_INITIALIZER,
+};
+
+struct marker {
+	pthread_t thread;
+	struct mark_stack stack;
+	size_t first, last;	/* slice of the_roots */
+};
+
+/*
+ * The helper threads are started at the first collection and then wait
+ * between collections for the generation to advance, rather than being
+ * created and joined every time.
+ */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t start, finish;
+	unsigned long generation;
+	unsigned nmarkers, running;
+	struct marker markers [MAX_MARKERS];
+} the_crew = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.finish = PTHREAD_COND_INITIALIZER,
+};
+
+static void
+term_mark(struct term *term)
+{
+	if (term)
+		mark_stack_push(&the_roots, term);
+}
+
+static void
+mark_share(struct mark_stack *stack)
+{
+	if (stack->used < SHARE_MIN ||
+	    !__atomic_load_n(&the_pool.waiting, __ATOMIC_RELAXED))
+		return;
+	pthread_mutex_lock(&the_pool.lock);
+	if (the_pool.waiting && !the_pool.work.used) {
+		size_t half = stack->used / 2;
+		for (size_t i = 0; i < half; ++i)
+			mark_stack_push(&the_pool.work, stack->items[i]);
+		memmove(stack->items, stack->items + half,
+			(stack->used - half) * sizeof stack->items[0]);
+		stack->used -= half;
+		pthread_cond_broadcast(&the_pool.wakeup);
+	}
+	pthread_mutex_unlock(&the_pool.lock);
+}
+
+/*
+ * Wait for shared work; returns false once marking is complete.
+ */
+static bool
+mark_await(struct mark_stack *stack)
+{
+	pthread_mutex_lock(&the_pool.lock);
+	the_pool.waiting++;
+	while (!the_pool.work.used && !the_pool.done) {
+		if (the_pool.waiting == the_pool.nthreads) {
+			the_pool.done = true;
+			pthread_cond_broadcast(&the_pool.wakeup);
+			break;
+		}
+		pthread_cond_wait(&the_pool.wakeup, &the_pool.lock);
+	}
+	bool more = !the_pool.done;
+	if (more) {
+		the_pool.waiting--;
+		while (the_pool.work.used)
+			mark_stack_push(stack, the_pool.work.items
+					[--the_pool.work.used]);
+	}
+	pthread_mutex_unlock(&the_pool.lock);
+	return more;
+}
+
+static void *
+marker_run(void *arg)
+{
+	struct marker *marker = arg;
+	for (size_t i = marker->first; i < marker->last; ++i)
+		mark_push(&marker->stack, the_roots.items[i]);
+	do
+		mark_drain(&marker->stack);
+	while (mark_await(&marker->stack));
+	return NULL;
+}
+
+static void *
+marker_helper(void *arg)
+{
+	struct marker *marker = arg;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&the_crew.lock);
+	for (;;) {
+		while (the_crew.generation == seen)
+			pthread_cond_wait(&the_crew.start, &the_crew.lock);
+		seen = the_crew.generation;
+		pthread_mutex_unlock(&the_crew.lock);
+		marker_run(marker);
+		pthread_mutex_lock(&the_crew.lock);
+		if (--the_crew.running == 0)
+			pthread_cond_signal(&the_crew.finish);
+	}
+	return NULL;
+}
+
+static void
+mark_finish(void)
+{
+	struct marker *markers = the_crew.markers;
+	if (!the_crew.nmarkers) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		unsigned n = ncpus < 1 ? 1 :
+			     ncpus > MAX_MARKERS ? MAX_MARKERS : ncpus;
+		for (unsigned i = 1; i < n; ++i)
+			if (pthread_create(&markers[i].thread, NULL,
+					   marker_helper, &markers[i]))
+				panic("Can't start marking thread\n");
+		the_crew.nmarkers = n;
+	}
+
+	unsigned n = the_crew.nmarkers;
+	the_pool.nthreads = n;
+	the_pool.waiting = 0;
+	the_pool.done = false;
+	for (unsigned i = 0; i < n; ++i) {
+		markers[i].first = the_roots.used * i / n;
+		markers[i].last = the_roots.used * (i + 1) / n;
+	}
+
+	pthread_mutex_lock(&the_crew.lock);
+	the_crew.running = n - 1;
+	the_crew.generation++;
+	pthread_cond_broadcast(&the_crew.start);
+	pthread_mutex_unlock(&the_crew.lock);
+
+	marker_run(&markers[0]);
+
+	pthread_mutex_lock(&the_crew.lock);
+	while (the_crew.running)
+		pthread_cond_wait(&the_crew.finish, &the_crew.lock);
+	pthread_mutex_unlock(&the_crew.lock);
+	the_roots.used = 0;
+}
+
+#endif /* MARK_PARALLEL */
+
+#endif /* MARK_STACK */
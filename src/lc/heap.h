@@ -23,6 +23,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <util/circlist.h>
 
@@ -36,6 +37,38 @@ extern struct term *term_alloc(struct term *root1, struct term *root2);
 
 extern bool show_gc;
 extern void heap_init(void);
+
+/*
+ * Call after storing a pointer into an existing term (only symbol
+ * bodies are assigned after construction), so generational collection
+ * can find young terms referenced from old ones.
+ */
+extern void heap_write_barrier(struct term *term);
+
+/*
+ * Holders of weak references to terms register a function which the
+ * collector calls after marking, before any term is reclaimed; it
+ * should drop references to terms for which heap_term_live() is false.
+ */
+typedef void heap_weak_fn(void);
+extern void heap_weak_register(heap_weak_fn *fn);
+extern bool heap_term_live(const struct term *term);
+
+/*
+ * Collection counts (all and major only), high-water mark of live terms,
+ * heap size in terms and time spent collecting since the last reset.
+ * The peak counts terms allocated since the last collection as live, and
+ * between major collections it includes old terms that have since died,
+ * so it's an upper bound.
+ */
+struct heap_stats {
+	unsigned long allocs, gcs, majors;
+	size_t peak, size;
+	double seconds;		/* spent collecting */
+};
+
+extern void heap_stats_reset(void);
+extern struct heap_stats heap_stats(void);
 extern void heap_allocator_register(struct allocator *alloc);
 extern void heap_allocator_deregister(struct allocator *alloc);
 
@@ -26,6 +26,7 @@
 
 #include "alloc.h"
 #include "env.h"
+#include "heap.h"
 #include "include.h"
 #include "lc.h"
 #include "lc.lex.h"
@@ -57,7 +58,7 @@ static int lc_yyerror(struct allocator *alloc, lc_yyscan_t scanner,
 %%
 
 input	: %empty
-	| stmt input
+	| input stmt
 	;
 
 stmt	: TOKEN_END_OF_LINE
@@ -70,7 +71,7 @@ stmt	: TOKEN_END_OF_LINE
 	| TOKEN_INCLUDE TOKEN_SYMBOL TOKEN_END_OF_LINE
 	{ if (lc_include(symtab_lookup($2->sym.name))) YYERROR; }
 	| TOKEN_SYMBOL TOKEN_ASSIGN term TOKEN_END_OF_LINE
-	{ $1->sym.body = $3; env_install($1); }
+	{ $1->sym.body = $3; heap_write_barrier($1); env_install($1); }
 	;
 
 /*
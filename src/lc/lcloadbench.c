@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Environment load benchmark: generate lc sources with increasing
+ * numbers of definitions, each referring both to the first and to the
+ * preceding definition, load them, and report time per definition.
+ * With an indexed environment this should stay flat as the environment
+ * grows; with a linear one it grows with the number of definitions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <engine/clock.h>
+#include <util/message.h>
+
+#include "env.h"
+#include "heap.h"
+#include "include.h"
+#include "main.h"
+
+#define DEFAULT_DEFS 16384
+#define FIRST_DEFS 1024
+
+/*
+ * The generated sources contain only definitions, so nothing is ever
+ * reduced.
+ */
+void run_reduce(struct term *term)
+{
+	panic("Unexpected term in generated definitions\n");
+}
+
+static void generate(FILE *out, unsigned round, size_t ndefs)
+{
+	fprintf(out, "R%u-D0 := \\x y. x\n", round);
+	for (size_t i = 1; i < ndefs; ++i)
+		fprintf(out, "R%u-D%zu := \\x y. R%u-D0 (R%u-D%zu x) y\n",
+			round, i, round, round, i - 1);
+}
+
+static int bench(unsigned round, size_t ndefs, size_t *total)
+{
+	char pathname [] = "/tmp/lcloadbench.XXXXXX";
+	int fd = mkstemp(pathname);
+	if (fd < 0)
+		return xperror("mkstemp");
+	FILE *out = fdopen(fd, "w");
+	generate(out, round, ndefs);
+	fclose(out);
+
+	double start = clock_cpu_seconds();
+	int status = lc_include(pathname);
+	double elapsed = clock_cpu_seconds() - start;
+	unlink(pathname);
+	if (status)
+		return status;
+
+	*total += ndefs;
+	printf("%6zu defs %7zu in env %8.3f cpu-s %8.0f ns/def\n",
+	       ndefs, *total, elapsed, elapsed * 1e9 / ndefs);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+	if (argc > 2) {
+		fputs("Usage: lcloadbench [<definitions>]\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	size_t max = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_DEFS;
+
+	show_gc = false;
+	heap_init();
+	env_init();
+	size_t total = 0;
+	unsigned round = 0;
+	for (size_t ndefs = FIRST_DEFS; ndefs <= max; ndefs *= 2)
+		if (bench(round++, ndefs, &total))
+			exit(EXIT_FAILURE);
+	return EXIT_SUCCESS;
+}
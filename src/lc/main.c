@@ -24,14 +24,18 @@
 #include <stdlib.h>
 #include <sys/time.h>
 
+#include <engine/stats.h>
 #include <util/message.h>
 
 #include "alloc.h"
 #include "env.h"
+#include "hashcons.h"
 #include "heap.h"
 #include "include.h"
 #include "lc.h"
 #include "lc.lex.h"
+#include "nbe.h"
+#include "perf.h"
 #include "readback.h"
 #include "reduce.h"
 #include "term.h"
@@ -39,6 +43,14 @@
 static bool show_elapsed_time = true,
 	    show_prompt = true;
 
+/*
+ * Heap statistics are reset before each reduction, so the JSON export
+ * describes the last reduction, apart from the running beta count.
+ */
+static const struct stat_desc the_reduce_stat_descs [] = {
+	{ "betas",	STAT_ULONG,	&reduce_betas },
+};
+
 void run_reduce(struct term *term)
 {
 	fputs("term: ", stdout);
@@ -55,10 +67,16 @@ void run_reduce(struct term *term)
 	term_print_indexed(term);
 	putchar('\n');
 
+	unsigned long betas = reduce_betas;
+	struct hashcons_stats cs0 = hashcons_stats();
+	heap_stats_reset();
+	perf_begin_reduction();
 	struct timeval t0, t;
 	gettimeofday(&t0, NULL);
-	term = reduce(term);
+	term = nbe_enabled ? nbe_reduce(term) : reduce(term);
 	gettimeofday(&t, NULL);
+	struct heap_stats hs = heap_stats();
+	perf_end_reduction();
 
 	fputs("norm: ", stdout);
 	term_print_indexed(term);
@@ -69,6 +87,16 @@ void run_reduce(struct term *term)
 		long elapsed = (t.tv_sec - t0.tv_sec) * 1000000 +
 			       (t.tv_usec - t0.tv_usec);
 		printf("dt: %.6fs\n", elapsed / 1000000.0);
+		printf("stats: betas %lu allocs %lu peak %zu gcs %lu "
+		       "majors %lu heap %zu gctime %.6f\n",
+		       reduce_betas - betas, hs.allocs, hs.peak, hs.gcs,
+		       hs.majors, hs.size, hs.seconds);
+		if (hashcons_enabled) {
+			struct hashcons_stats cs = hashcons_stats();
+			printf("hashcons: shared %lu memo %lu terms %zu\n",
+			       cs.shared - cs0.shared, cs.memo - cs0.memo,
+			       cs.terms);
+		}
 	}
 }
 
@@ -103,17 +131,36 @@ int main(int argc, char *argv[])
 	set_execname(argv[0]);
 	heap_init();
 	env_init();
+	STATS_REGISTER("reduce", the_reduce_stat_descs);
+	const char *perf_file = NULL, *stats_file = NULL;
 	int c;
-	while ((c = getopt(argc, argv, "q")) != -1) {
+	while ((c = getopt(argc, argv, "ej:p:qs")) != -1) {
 		switch (c) {
+		case 'e':
+			nbe_enabled = true;
+			break;
+		case 'j':
+			stats_file = optarg;
+			break;
+		case 'p':
+			perf_file = optarg;
+			break;
 		case 'q':
 			show_elapsed_time = false;
 			show_gc = false;
 			show_prompt = false;
 			break;
+		case 's':
+			hashcons_enabled = true;
+			break;
 		}
 	}
 	lc_include("prelude.lc");
 	repl();
-	return 0;
+	int result = 0;
+	if (perf_file && write_perf(perf_file))
+		result = 1;
+	if (stats_file && stats_write_json(stats_file))
+		result = 1;
+	return result;
 }
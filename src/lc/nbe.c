@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "alloc.h"
+#include "nbe.h"
+#include "reduce.h"
+#include "term.h"
+
+bool nbe_enabled;
+
+/*
+ * Values are weak head normal forms: closures pairing an abstraction
+ * with the environment it was evaluated in, and neutral terms, which
+ * are variables (introduced during readback, identified by de Bruijn
+ * level) applied to zero or more arguments.  Environments are linked
+ * lists of thunks indexed by de Bruijn index.  A thunk holds either an
+ * unevaluated term and its environment or, once forced, a value.
+ */
+enum value_type { CLOSURE, NEUTRAL_VAR, NEUTRAL_APP };
+
+struct value {
+	enum value_type type;
+	union {
+		struct { const struct term *abs; struct env *env; } clos;
+		struct { int level; } var;
+		struct { struct value *fun; struct thunk *arg; } app;
+	};
+};
+
+struct thunk {
+	const struct term *term;	/* NULL once forced */
+	struct env *env;
+	struct value *value;
+	bool forcing;
+};
+
+struct env {
+	struct thunk *thunk;
+	struct env *next;
+};
+
+/*
+ * Values, thunks and environments live only as long as a single
+ * reduction, so they're allocated from an arena which is discarded
+ * wholesale afterwards; only the terms built by readback go on the
+ * garbage-collected heap.
+ */
+#define ARENA_BLOCK 65536
+
+struct block {
+	struct block *next;
+	size_t used;
+	char data [ARENA_BLOCK];
+};
+
+static struct block *the_arena;
+
+static void *
+arena_alloc(size_t size)
+{
+	size = (size + 7) & ~(size_t) 7;
+	if (!the_arena || the_arena->used + size > ARENA_BLOCK) {
+		struct block *block = xmalloc(sizeof *block);
+		block->next = the_arena;
+		block->used = 0;
+		the_arena = block;
+	}
+	void *result = the_arena->data + the_arena->used;
+	the_arena->used += size;
+	return result;
+}
+
+static void
+arena_free_all(void)
+{
+	while (the_arena) {
+		struct block *next = the_arena->next;
+		free(the_arena);
+		the_arena = next;
+	}
+}
+
+static struct thunk *
+delay(const struct term *term, struct env *env)
+{
+	struct thunk *thunk = arena_alloc(sizeof *thunk);
+	thunk->term = term;
+	thunk->env = env;
+	thunk->value = NULL;
+	thunk->forcing = false;
+	return thunk;
+}
+
+static struct thunk *
+ready(struct value *value)
+{
+	struct thunk *thunk = arena_alloc(sizeof *thunk);
+	thunk->term = NULL;
+	thunk->env = NULL;
+	thunk->value = value;
+	thunk->forcing = false;
+	return thunk;
+}
+
+static struct env *
+extend(struct thunk *thunk, struct env *env)
+{
+	struct env *result = arena_alloc(sizeof *result);
+	result->thunk = thunk;
+	result->next = env;
+	return result;
+}
+
+static struct value *
+eval(const struct term *term, struct env *env);
+
+static struct value *
+force(struct thunk *thunk)
+{
+	if (thunk->term) {
+		if (thunk->forcing)
+			panic("Reduction diverges (thunk forced recursively)\n");
+		thunk->forcing = true;
+		thunk->value = eval(thunk->term, thunk->env);
+		thunk->term = NULL;
+		thunk->env = NULL;
+	}
+	return thunk->value;
+}
+
+/*
+ * Evaluate to weak head normal form.  Applications of closures are
+ * handled by looping rather than recursing, so the C stack grows only
+ * with the nesting of function positions, not with the length of a
+ * chain of tail calls.
+ */
+static struct value *
+eval(const struct term *term, struct env *env)
+{
+	for (;;) {
+		switch (term->type) {
+		case VAR: {
+			struct env *e = env;
+			for (int i = term->var.index; i; --i)
+				e = e->next;
+			return force(e->thunk);
+		}
+		case ABS: {
+			struct value *value = arena_alloc(sizeof *value);
+			value->type = CLOSURE;
+			value->clos.abs = term;
+			value->clos.env = env;
+			return value;
+		}
+		case APP: {
+			struct value *fun = eval(term->app.fun, env);
+			struct thunk *arg = delay(term->app.arg, env);
+			if (fun->type != CLOSURE) {
+				struct value *value =
+					arena_alloc(sizeof *value);
+				value->type = NEUTRAL_APP;
+				value->app.fun = fun;
+				value->app.arg = arg;
+				return value;
+			}
+			reduce_betas++;
+			term = fun->clos.abs->abs.body;
+			env = extend(arg, fun->clos.env);
+			continue;
+		}
+		default:
+			panicf("Invalid term type %d in evaluation\n",
+			       term->type);
+		}
+	}
+}
+
+static struct value *
+apply(struct value *fun, struct thunk *arg)
+{
+	assert(fun->type == CLOSURE);
+	reduce_betas++;
+	return eval(fun->clos.abs->abs.body, extend(arg, fun->clos.env));
+}
+
+/*
+ * Read a value back into a term in normal form, at the given number of
+ * enclosing abstractions.  Terms under construction are kept on the
+ * 'roots' allocator, since building each one may trigger a collection.
+ */
+static struct term *
+quote(struct allocator *roots, struct value *value, int depth)
+{
+	switch (value->type) {
+	case CLOSURE: {
+		struct value *var = arena_alloc(sizeof *var);
+		var->type = NEUTRAL_VAR;
+		var->var.level = depth;
+		struct term *body =
+			quote(roots, apply(value, ready(var)), depth + 1);
+		return Abs(value->clos.abs->abs.formal, body);
+	}
+	case NEUTRAL_VAR:
+		return VarI(depth - value->var.level - 1);
+	case NEUTRAL_APP: {
+		struct term *fun =
+			allocator_push(roots, quote(roots, value->app.fun,
+						    depth));
+		struct term *arg =
+			quote(roots, force(value->app.arg), depth);
+		allocator_pop(roots);
+		return App(fun, arg);
+	}
+	default:
+		panicf("Invalid value type %d in readback\n", value->type);
+	}
+}
+
+struct term *
+nbe_reduce(struct term *term)
+{
+	struct allocator roots = { .name = "Readback roots" };
+	allocator_init(&roots, ALLOCATOR_DEFAULT_SLOTS);
+	term = quote(&roots, eval(term, NULL), 0);
+	assert(allocator_empty(&roots));
+	allocator_fini(&roots);
+	arena_free_all();
+	return term;
+}
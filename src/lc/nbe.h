@@ -0,0 +1,42 @@
+#ifndef LARK_LC_NBE_H
+#define LARK_LC_NBE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+struct term;
+
+/*
+ * An alternative reduction engine using normalization by evaluation.
+ * Terms are evaluated to weak head normal form by an environment
+ * machine with closures and call-by-need thunks, then read back into
+ * terms, going under abstractions by applying closures to fresh
+ * neutral variables.  Nothing is copied by substitution, and shared
+ * arguments are evaluated at most once, yet the normal forms are the
+ * same as those found by the copying reducer's normal order.
+ */
+extern bool nbe_enabled;
+
+extern struct term *nbe_reduce(struct term *term);
+
+#endif /* LARK_LC_NBE_H */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <util/message.h>
+
+#include "heap.h"
+#include "perf.h"
+#include "reduce.h"
+
+static struct perf_costs {
+	unsigned long reductions, betas, allocs;
+	size_t peak;
+} the_perf_costs;
+
+static unsigned long the_betas_at_begin;
+
+/*
+ * Heap statistics are reset at the start of each reduction, so we
+ * accumulate them here, along with the betas, when it ends.
+ */
+void perf_begin_reduction(void)
+{
+	the_betas_at_begin = reduce_betas;
+}
+
+void perf_end_reduction(void)
+{
+	struct heap_stats hs = heap_stats();
+	the_perf_costs.reductions++;
+	the_perf_costs.betas += reduce_betas - the_betas_at_begin;
+	the_perf_costs.allocs += hs.allocs;
+	if (hs.peak > the_perf_costs.peak)
+		the_perf_costs.peak = hs.peak;
+}
+
+int write_perf(const char *pathname)
+{
+	FILE *fout = fopen(pathname, "w");
+	if (!fout)
+		return xperror(pathname);
+	fprintf(fout,
+		"reductions %lu\n"
+		"betas %lu\n"
+		"allocs %lu\n"
+		"peak %zu\n",
+		the_perf_costs.reductions,
+		the_perf_costs.betas,
+		the_perf_costs.allocs,
+		the_perf_costs.peak);
+	if (fclose(fout))
+		return xperror(pathname);
+	return 0;
+}
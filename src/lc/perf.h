@@ -1,7 +1,7 @@
-#ifndef LARK_SLC_MEMLOC_H
-#define LARK_SLC_MEMLOC_H
+#ifndef LARK_LC_PERF_H
+#define LARK_LC_PERF_H
 /*
- * Copyright (c) 2009-2022 Michael P. Touloumtzis.
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -23,12 +23,13 @@
  */
 
 /*
- * Return a unique (generated) symbol for each distinct memory location.
- * The alternative of printing raw pointer values makes sharing much
- * harder to visually parse.  Right now we're returning the symbol as a
- * C string rather than a symbol_mt since this is just used for printing.
+ * Deterministic reduction costs accumulated across every reduction in
+ * a run, written at exit for the test harness to compare with a
+ * baseline (test/<name>.perf); see make/perfcheck.sh.
  */
 
-extern const char *memloc(const void *addr);
+extern void perf_begin_reduction(void);
+extern void perf_end_reduction(void);
+extern int write_perf(const char *pathname);
 
-#endif /* LARK_SLC_MEMLOC_H */
+#endif /* LARK_LC_PERF_H */
@@ -28,6 +28,7 @@
 #include <util/message.h>
 
 #include "alloc.h"
+#include "hashcons.h"
 #include "heap.h"
 #include "reduce.h"
 #include "term.h"
@@ -127,6 +128,29 @@ union payload {
 	struct term *value;
 };
 
+/*
+ * Constructors for terms built during reduction, which are shared via
+ * hash-consing when it's enabled.
+ */
+static inline struct term *
+make_abs(symbol_mt formal, struct term *body)
+{
+	return hashcons_enabled ? hashcons_abs(formal, body) :
+		Abs(formal, body);
+}
+
+static inline struct term *
+make_app(struct term *fun, struct term *arg)
+{
+	return hashcons_enabled ? hashcons_app(fun, arg) : App(fun, arg);
+}
+
+static inline struct term *
+make_var(int index)
+{
+	return hashcons_enabled ? hashcons_var(index) : VarI(index);
+}
+
 typedef struct term *handler(struct allocator *spine, struct term *term,
 			     int depth, union payload *payload);
 
@@ -150,7 +174,7 @@ doshift(struct allocator *spine, struct term *term,
 {
 	assert(term->type == VAR);
 	return term->var.index < depth ? term :
-		VarI(term->var.index + payload->delta);
+		make_var(term->var.index + payload->delta);
 }
 
 /*
@@ -181,17 +205,20 @@ dosubst(struct allocator *spine, struct term *term,
 	if (tvar == depth)
 		return (depth == 0) ? payload->value :
 			shift(spine, payload->value, depth);
-	return tvar < depth ? term : VarI(tvar - 1);
+	return tvar < depth ? term : make_var(tvar - 1);
 }
 
 /*
  * Apply a function to an argument by substituting the argument in the
  * function abstraction, i.e. perform a beta-reduction.
  */
+unsigned long reduce_betas;
+
 static struct term *
 apply(struct allocator *spine, struct term *fun, struct term *arg)
 {
 	assert(fun->type == ABS);
+	reduce_betas++;
 	union payload payload = { .value = arg };
 	return traverse(spine, fun->abs.body, false, &dosubst, &payload);
 }
@@ -257,7 +284,26 @@ traverse(struct allocator *spine,	/* term's surrounding context */
 	 */
 	int depth = 0;
 
+	/*
+	 * Shifts and substitutions are pure functions of the subterm and
+	 * its depth, so with hash-consing we memoize them per subterm;
+	 * the memo key identifies the traversal by handler and payload.
+	 */
+	bool memoize = hashcons_enabled && !betareduce;
+	const void *memokey = !memoize ? NULL : handler == &doshift ?
+		(const void *) (intptr_t) payload->delta : payload->value;
+
 descend:
+	if (memoize && term->type != VAR) {
+		struct term *memo =
+			hashcons_memo_get(handler, memokey, term, depth);
+		if (memo) {
+			term = memo;
+			goto ascend;
+		}
+	}
+
+
 	/*
 	 * Descend into abstractions and into the left (function) branches
 	 * of applications.  We don't enter the argument branches of
@@ -311,9 +357,11 @@ ascend:
 	switch (top->type) {
 	case ABS:
 		term = (top->abs.body == term) ? top :
-			Abs(top->abs.formal, term);
+			make_abs(top->abs.formal, term);
 		allocator_pop(spine);
 		--depth;
+		if (memoize)
+			hashcons_memo_put(handler, memokey, top, depth, term);
 		goto ascend;
 	case APP:
 		if (betareduce && term->type == ABS)
@@ -336,17 +384,22 @@ ascend:
 		 * We're reducing the RHS (argument position) of a function
 		 * application.  In this case the term above the marker is
 		 * the already-reduced LHS (function) and above that is the
-		 * original application term.
+		 * original application term, which stays on the spine
+		 * until we're done building so it remains a valid memo key.
 		 */
 		assert(top == &rhs_marker);
 		allocator_pop(spine);
 		{
 			struct term *arg = term;
 			struct term *fun = allocator_pop(spine);
-			term = allocator_pop(spine);
-			assert(term->type == APP);
-			if (term->app.fun != fun || term->app.arg != arg)
-				term = App(fun, arg);
+			struct term *app = allocator_top(spine);
+			assert(app->type == APP);
+			term = (app->app.fun != fun || app->app.arg != arg) ?
+				make_app(fun, arg) : app;
+			allocator_pop(spine);
+			if (memoize)
+				hashcons_memo_put(handler, memokey,
+						  app, depth, term);
 		}
 		goto ascend;
 	default:
@@ -26,4 +26,7 @@ struct term;
 
 extern struct term *reduce(struct term *term);
 
+/* Beta-reductions performed, cumulatively; callers take differences. */
+extern unsigned long reduce_betas;
+
 #endif /* LARK_LC_REDUCE_H */
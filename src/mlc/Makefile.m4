@@ -1,10 +1,55 @@
-make_binary(mlc, beta.c env.c flatten.c form.c heap.c interpret.c
-		 memloc.c mlc.c mlc.l mlc.y
-		 node.c num.c parse.c prim.c readback.c reduce.c
-		 resolve.c stmt.c subst.c
-		 term.c unflatten.c, util, readline)
+make_library(libmlc,
+	     beta.c cache.c church.c compile.c elim.c env.c flatten.c fold.c
+	     form.c heap.c inline.c interpret.c libmlc.c mlc.l mlc.y
+	     node.c num.c parse.c perf.c prim.c profile.c readback.c reduce.c
+	     resolve.c stmt.c subst.c
+	     term.c trace.c unflatten.c)
+make_binary(mlc, mlc.c serve.c, mlc engine util, readline)
+make_binary(cachetest, cachetest.c, mlc engine util)
+make_binary(libmlctest, libmlctest.c, mlc engine util)
+make_binary(mlcparsebench, mlcparsebench.c, mlc engine util)
+make_binary(mlctrace, mlctrace.c trace.c, engine util)
 
 export MLC_INCLUDE := lib/mlc
 
-%.runout %.runerr: %.mlc $(subdir)mlc
-	src/mlc/mlc -eq $*.mlc > $*.runout 2> $*.runerr
+# Tests run with the compiled library cache disabled, so that they
+# neither depend on nor write to the user's cache; cachetest covers the
+# cache itself.
+MLC_TEST := MLC_CACHE= src/mlc/mlc
+
+%.runout %.runerr %.runperf: %.mlc $(subdir)mlc
+	$(MLC_TEST) -eq --perf=$*.runperf $*.mlc > $*.runout 2> $*.runerr
+
+%-inline.runout %-inline.runerr %-inline.runperf: %-inline.mlc $(subdir)mlc
+	$(MLC_TEST) -eq --inline --perf=$*-inline.runperf $*-inline.mlc \
+		> $*-inline.runout 2> $*-inline.runerr
+
+%-accel.runout %-accel.runerr %-accel.runperf: %-accel.mlc $(subdir)mlc
+	$(MLC_TEST) -eq --church --perf=$*-accel.runperf $*-accel.mlc \
+		> $*-accel.runout 2> $*-accel.runerr
+
+# Tests named *-compile run with a heap budget well below what they
+# allocate in total, so they fail unless garbage is collected.
+%-compile.runout %-compile.runerr %-compile.runperf: %-compile.mlc $(subdir)mlc
+	$(MLC_TEST) -eq --compile --max-heap=16777216 \
+		--perf=$*-compile.runperf $*-compile.mlc \
+		> $*-compile.runout 2> $*-compile.runerr
+
+# Tests named *-profile run with -F, which implies -p; the folded stacks
+# are sorted, since they're written in hash order, and appended.
+%-profile.runout %-profile.runerr: %-profile.mlc $(subdir)mlc
+	$(MLC_TEST) -eq -F $*-profile.folded $*-profile.mlc \
+		> $*-profile.runout 2> $*-profile.runerr
+	LC_ALL=C sort $*-profile.folded >> $*-profile.runout
+	rm $*-profile.folded
+
+# Tests named *-trace record a reduction trace and append mlctrace's
+# summary of it to their output.
+%-trace.runout %-trace.runerr: %-trace.mlc $(subdir)mlc $(subdir)mlctrace
+	$(MLC_TEST) -eq -T $*-trace.bin --trace-records=64 $*-trace.mlc \
+		> $*-trace.runout 2> $*-trace.runerr
+	src/mlc/mlctrace -q $*-trace.bin >> $*-trace.runout
+	rm $*-trace.bin
+
+$(subdir)test/libmlctest.runout $(subdir)test/libmlctest.runerr: \
+	export MLC_CACHE :=
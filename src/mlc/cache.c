@@ -0,0 +1,694 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+#include <util/sha2.h>
+#include <util/wordbuf.h>
+
+#include "cache.h"
+#include "ctx.h"
+#include "env.h"
+#include "parse.h"
+#include "prim.h"
+#include "stmt.h"
+#include "term.h"
+
+/*
+ * Artifacts are a private cache, so they use host byte order; the
+ * version number changes whenever the format does.  Changes to the
+ * meaning of resolved terms (in the parser, resolve, fold or elim) are
+ * covered by the build identity folded into each key; see build_id().
+ */
+#define CACHE_MAGIC "MLCOBJ\0\0"
+#define CACHE_VERSION 1
+
+struct cache_header {
+	char magic [8];
+	uint32_t version, reserved;
+	unsigned char hash [SHA256_BIN_BYTES];
+};
+
+enum {
+	RECORD_END = 'Z',
+	RECORD_DEFINE = 'D',
+	RECORD_INCLUDE = 'I',
+};
+
+/* a reference to a global, whether defined or free */
+#define TERM_REF 0x80
+
+#define NO_SYMBOL UINT32_MAX
+
+struct record {
+	int kind;
+	symbol_mt name;		/* RECORD_DEFINE */
+	struct term *val;	/* RECORD_DEFINE */
+	char *pathname;		/* RECORD_INCLUDE */
+};
+
+/*
+ * Each include being compiled or replayed has a recorder; includes
+ * nest, so recorders form a stack, and statements are noted only in the
+ * innermost.  A replayed library's recorder never records.
+ */
+struct recorder {
+	struct recorder *outer;
+	bool recording;
+	struct wordbuf records;
+};
+
+static void push_recorder(struct mlc_ctx *ctx, bool recording)
+{
+	struct recorder *r = xmalloc(sizeof *r);
+	r->outer = ctx->recorder;
+	r->recording = recording;
+	wordbuf_init(&r->records);
+	ctx->recorder = r;
+}
+
+static void pop_recorder(struct mlc_ctx *ctx)
+{
+	struct recorder *r = ctx->recorder;
+	assert(r);
+	for (size_t i = 0; i < wordbuf_used(&r->records); ++i) {
+		struct record *rec = (struct record *) wordbuf_at(&r->records, i);
+		xfree(rec->pathname);
+		xfree(rec);
+	}
+	wordbuf_fini(&r->records);
+	ctx->recorder = r->outer;
+	xfree(r);
+}
+
+static void note(struct mlc_ctx *ctx, int kind, symbol_mt name,
+		 struct term *val, const char *pathname)
+{
+	struct recorder *r = ctx->recorder;
+	if (!r || !r->recording)
+		return;
+	struct record *rec = xmalloc(sizeof *rec);
+	rec->kind = kind;
+	rec->name = name;
+	rec->val = val;
+	rec->pathname = pathname ? xstrdup(pathname) : NULL;
+	wordbuf_push(&r->records, (word) rec);
+}
+
+void cache_note_define(struct mlc_ctx *ctx, symbol_mt name,
+		       struct term *val)
+{
+	note(ctx, RECORD_DEFINE, name, val, NULL);
+}
+
+void cache_note_include(struct mlc_ctx *ctx, const char *pathname)
+{
+	note(ctx, RECORD_INCLUDE, 0, NULL, pathname);
+}
+
+void cache_note_uncacheable(struct mlc_ctx *ctx)
+{
+	if (ctx->recorder)
+		ctx->recorder->recording = false;
+}
+
+/*
+ * Cache location and artifact naming.
+ */
+static char *concat(const char *a, const char *b)
+{
+	size_t alen = strlen(a), blen = strlen(b);
+	char *s = xmalloc(alen + blen + 1);
+	memcpy(s, a, alen);
+	memcpy(s + alen, b, blen + 1);
+	return s;
+}
+
+static char *cache_dir(void)
+{
+	const char *dir = getenv("MLC_CACHE");
+	if (dir)
+		return *dir ? xstrdup(dir) : NULL;
+
+	char *parent;
+	if ((dir = getenv("XDG_CACHE_HOME")) && *dir)
+		parent = xstrdup(dir);
+	else if ((dir = getenv("HOME")) && *dir)
+		parent = concat(dir, "/.cache");
+	else
+		return NULL;
+	mkdir(parent, 0777);
+	char *path = concat(parent, "/mlc");
+	xfree(parent);
+	return path;
+}
+
+/*
+ * Identify the running executable by its file identity and modification
+ * time, so that artifacts written by one build are never replayed by
+ * another, even if CACHE_VERSION wasn't bumped.  Without /proc we fall
+ * back to the time at which this file was compiled.
+ */
+static const char *build_id(void)
+{
+	static char id [128];
+	if (*id)
+		return id;
+	struct stat st;
+	if (!stat("/proc/self/exe", &st))
+		snprintf(id, sizeof id, "%d exe %lu %lu %lld %lld.%09ld",
+			 CACHE_VERSION, (unsigned long) st.st_dev,
+			 (unsigned long) st.st_ino, (long long) st.st_size,
+			 (long long) st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+	else
+		snprintf(id, sizeof id, "%d built %s %s",
+			 CACHE_VERSION, __DATE__, __TIME__);
+	return id;
+}
+
+/*
+ * The key hashes the build identity together with the source's hash.
+ */
+static int cache_key_hash(unsigned char *hash, const char *pathname)
+{
+	unsigned char source [SHA256_BIN_BYTES];
+	if (sha256_hash_file(source, pathname))
+		return -1;
+	const char *id = build_id();
+	struct sha256_state state;
+	sha256_stream_start(&state);
+	sha256_stream_hash(&state, id, strlen(id));
+	sha256_stream_hash(&state, source, sizeof source);
+	sha256_stream_finish(&state, hash);
+	return 0;
+}
+
+static char *artifact_path(const unsigned char *hash)
+{
+	char *dir = cache_dir();
+	if (!dir)
+		return NULL;
+	if (mkdir(dir, 0777) && errno != EEXIST) {
+		xfree(dir);
+		return NULL;
+	}
+
+	char name [SHA256_HEX_BYTES + sizeof ".mlo"];
+	sha256_to_ascii(name, hash);
+	strcpy(name + SHA256_HEX_BYTES, ".mlo");
+	char *prefix = concat(dir, "/"), *path = concat(prefix, name);
+	xfree(prefix);
+	xfree(dir);
+	return path;
+}
+
+/*
+ * Serialization.
+ */
+static void put_u8(FILE *out, unsigned x)
+{
+	putc(x, out);
+}
+
+static void put_u32(FILE *out, uint32_t x)
+{
+	fwrite(&x, sizeof x, 1, out);
+}
+
+static void put_str(FILE *out, const char *s)
+{
+	size_t len = strlen(s);
+	put_u32(out, len);
+	fwrite(s, 1, len, out);
+}
+
+static void put_sym(FILE *out, symbol_mt sym)
+{
+	if (sym)
+		put_str(out, symtab_lookup(sym));
+	else
+		put_u32(out, NO_SYMBOL);
+}
+
+static void put_term(FILE *out, struct env *env, const struct term *term,
+		     bool root);
+
+static void put_terms(FILE *out, struct env *env, size_t n,
+		      struct term *const *terms)
+{
+	put_u32(out, n);
+	for (size_t i = 0; i < n; ++i)
+		put_term(out, env, terms[i], false);
+}
+
+static void put_syms(FILE *out, size_t n, const symbol_mt *syms)
+{
+	put_u32(out, n);
+	for (size_t i = 0; i < n; ++i)
+		put_sym(out, syms[i]);
+}
+
+static void put_term(FILE *out, struct env *env, const struct term *term,
+		     bool root)
+{
+	/*
+	 * Resolved terms share the values of the globals they reference;
+	 * we save those references by name.
+	 */
+	const struct env_entry *ee;
+	if (!root && (ee = env_lookup_val(env, term))) {
+		put_u8(out, TERM_REF);
+		put_sym(out, ee->name);
+		return;
+	}
+
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		put_u8(out, term->variety);
+		put_syms(out, term->abs.nformals, term->abs.formals);
+		put_terms(out, env, term->abs.nbodies, term->abs.bodies);
+		break;
+	case TERM_APP:
+		put_u8(out, term->variety);
+		put_term(out, env, term->app.fun, false);
+		put_terms(out, env, term->app.nargs, term->app.args);
+		break;
+	case TERM_BOUND_VAR:
+		put_u8(out, term->variety);
+		put_u32(out, term->bv.up);
+		put_u32(out, term->bv.across);
+		put_sym(out, term->bv.name);
+		break;
+	case TERM_CELL:
+		put_u8(out, term->variety);
+		put_terms(out, env, term->cell.nelts, term->cell.elts);
+		break;
+	case TERM_FREE_VAR:
+		put_u8(out, TERM_REF);
+		put_sym(out, term->fv.name);
+		break;
+	case TERM_LET:
+		put_u8(out, term->variety);
+		put_syms(out, term->let.ndefs, term->let.vars);
+		put_terms(out, env, term->let.ndefs, term->let.vals);
+		put_term(out, env, term->let.body, false);
+		break;
+	case TERM_NUM:
+		put_u8(out, term->variety);
+		fwrite(&term->num, sizeof term->num, 1, out);
+		break;
+	case TERM_PRIM:
+		put_u8(out, term->variety);
+		put_str(out, term->prim->name);
+		break;
+	case TERM_PRUNED:
+		put_u8(out, term->variety);
+		break;
+	case TERM_STRING:
+		put_u8(out, term->variety);
+		put_str(out, term->str);
+		break;
+	case TERM_TEST:
+		put_u8(out, term->variety);
+		put_term(out, env, term->test.pred, false);
+		put_terms(out, env, term->test.ncsqs, term->test.csqs);
+		put_terms(out, env, term->test.nalts, term->test.alts);
+		break;
+	default:
+		panicf("Unhandled term variety %d\n", term->variety);
+	}
+}
+
+static void write_artifact(struct env *env, const struct cache_key *key,
+			   const struct recorder *r)
+{
+	char *path = artifact_path(key->hash);
+	if (!path)
+		return;
+	char *tmp = concat(path, ".XXXXXX");
+	int fd = mkstemp(tmp);
+	FILE *out = fd < 0 ? NULL : fdopen(fd, "w");
+	if (!out) {
+		if (fd >= 0)
+			close(fd);
+		goto done;
+	}
+
+	struct cache_header header = {
+		.magic = CACHE_MAGIC,
+		.version = CACHE_VERSION,
+	};
+	memcpy(header.hash, key->hash, sizeof header.hash);
+	fwrite(&header, sizeof header, 1, out);
+	for (size_t i = 0; i < wordbuf_used(&r->records); ++i) {
+		const struct record *rec =
+			(const struct record *) wordbuf_at(&r->records, i);
+		put_u8(out, rec->kind);
+		if (rec->kind == RECORD_INCLUDE)
+			put_str(out, rec->pathname);
+		else {
+			put_sym(out, rec->name);
+			put_term(out, env, rec->val, true);
+		}
+	}
+	put_u8(out, RECORD_END);
+
+	/* rename atomically so concurrent readers never see partial files */
+	if (fclose(out) || rename(tmp, path))
+		unlink(tmp);
+done:
+	xfree(tmp);
+	xfree(path);
+}
+
+/*
+ * Deserialization.  We read an artifact twice: first to check that it's
+ * well-formed without building terms or touching the environment, so a
+ * damaged artifact is simply recompiled, and then to replay it.
+ */
+struct reader {
+	struct mlc_ctx *ctx;
+	const unsigned char *p, *end;
+	bool ok, build;
+};
+
+static void get_bytes(struct reader *r, void *buf, size_t n)
+{
+	if (!r->ok || (size_t) (r->end - r->p) < n) {
+		r->ok = false;
+		memset(buf, 0, n);
+		return;
+	}
+	memcpy(buf, r->p, n);
+	r->p += n;
+}
+
+static unsigned get_u8(struct reader *r)
+{
+	unsigned char x;
+	get_bytes(r, &x, sizeof x);
+	return x;
+}
+
+static uint32_t get_u32(struct reader *r)
+{
+	uint32_t x;
+	get_bytes(r, &x, sizeof x);
+	return x;
+}
+
+/* an upper bound on lengths and counts, to reject damage early */
+static size_t get_count(struct reader *r)
+{
+	uint32_t n = get_u32(r);
+	if (n > (size_t) (r->end - r->p))
+		r->ok = false;
+	return r->ok ? n : 0;
+}
+
+static char *get_str_len(struct reader *r, size_t len)
+{
+	char *str = xmalloc(len + 1);
+	get_bytes(r, str, len);
+	str[len] = '\0';
+	return str;
+}
+
+static char *get_str(struct reader *r)
+{
+	return get_str_len(r, get_count(r));
+}
+
+static symbol_mt get_sym(struct reader *r)
+{
+	uint32_t len = get_u32(r);
+	if (len == NO_SYMBOL || !r->ok)
+		return 0;
+	if (len > (size_t) (r->end - r->p)) {
+		r->ok = false;
+		return 0;
+	}
+	char *name = get_str_len(r, len);
+	symbol_mt sym = symtab_intern(name);
+	xfree(name);
+	return sym;
+}
+
+static struct term *get_term(struct reader *r);
+
+static struct term **get_terms(struct reader *r, size_t *n)
+{
+	*n = get_count(r);
+	struct term **terms = xmalloc(sizeof *terms * (*n ?: 1));
+	for (size_t i = 0; i < *n; ++i)
+		terms[i] = get_term(r);
+	return terms;
+}
+
+static symbol_mt *get_syms(struct reader *r, size_t *n)
+{
+	*n = get_count(r);
+	symbol_mt *syms = xmalloc(sizeof *syms * (*n ?: 1));
+	for (size_t i = 0; i < *n; ++i)
+		syms[i] = get_sym(r);
+	return syms;
+}
+
+/*
+ * Resolve a global reference as resolve() would now: to its defined
+ * value if there is one (values in the environment are closed, so can
+ * be shared as-is), otherwise to its free variable.
+ */
+static struct term *get_ref(struct env *env, symbol_mt name)
+{
+	struct env_entry ee = env_declare(env, name);
+	return ee.val ?: ee.var;
+}
+
+/*
+ * When only checking (!r->build) we return placeholder terms, which are
+ * never freed since terms never are.
+ */
+static struct term *get_term(struct reader *r)
+{
+	unsigned variety = get_u8(r);
+	struct term *fun, *pred, **terms, **alts;
+	symbol_mt sym, *syms;
+	size_t n, m;
+	int up, across;
+	double num;
+	char *str;
+
+	if (!r->ok)
+		return TermPruned();
+
+	switch (variety) {
+	case TERM_REF:
+		sym = get_sym(r);
+		return r->build && r->ok ? get_ref(r->ctx->env, sym)
+					 : TermPruned();
+	case TERM_ABS:
+	case TERM_FIX:
+		syms = get_syms(r, &n);
+		terms = get_terms(r, &m);
+		if (!n)
+			r->ok = false;
+		return r->ok ? (variety == TERM_ABS ? TermAbs : TermFix)
+				(n, syms, m, terms) : TermPruned();
+	case TERM_APP:
+		fun = get_term(r);
+		terms = get_terms(r, &n);
+		return TermApp(fun, n, terms);
+	case TERM_BOUND_VAR:
+		up = get_u32(r);
+		across = get_u32(r);
+		sym = get_sym(r);
+		return TermBoundVar(up, across, sym);
+	case TERM_CELL:
+		terms = get_terms(r, &n);
+		return TermCell(n, terms);
+	case TERM_LET:
+		syms = get_syms(r, &n);
+		terms = get_terms(r, &m);
+		fun = get_term(r);
+		if (!n || n != m)
+			r->ok = false;
+		return r->ok ? TermLet(n, syms, terms, fun) : TermPruned();
+	case TERM_NUM:
+		get_bytes(r, &num, sizeof num);
+		return TermNum(num);
+	case TERM_PRIM: {
+		str = get_str(r);
+		const struct prim *prim = prim_lookup(str);
+		xfree(str);
+		if (!prim)
+			r->ok = false;
+		return prim ? TermPrim(prim) : TermPruned();
+	}
+	case TERM_PRUNED:
+		return TermPruned();
+	case TERM_STRING:
+		return TermString(get_str(r));
+	case TERM_TEST:
+		pred = get_term(r);
+		terms = get_terms(r, &n);
+		alts = get_terms(r, &m);
+		return TermTest(pred, n, terms, m, alts);
+	default:
+		r->ok = false;
+		return TermPruned();
+	}
+}
+
+/*
+ * Replay (or, if !r->build, check) an artifact's records.  Returns
+ * nonzero if an include fails during replay.
+ */
+static int replay(struct reader *r)
+{
+	while (r->ok) {
+		unsigned kind = get_u8(r);
+		if (kind == RECORD_END) {
+			if (r->p != r->end)
+				r->ok = false;
+			return 0;
+		} else if (kind == RECORD_INCLUDE) {
+			char *pathname = get_str(r);
+			int retval = (r->ok && r->build) ?
+				parse_include(r->ctx, pathname) : 0;
+			xfree(pathname);
+			if (retval)
+				return retval;
+		} else if (kind == RECORD_DEFINE) {
+			symbol_mt name = get_sym(r);
+			struct term *val = get_term(r);
+			if (r->ok && r->build)
+				stmt_define_term(r->ctx, name, val);
+		} else
+			r->ok = false;
+	}
+	return 0;
+}
+
+static const unsigned char *map_artifact(const char *path, size_t *size)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	const unsigned char *base = NULL;
+	if (!fstat(fd, &st) && st.st_size > 0) {
+		*size = st.st_size;
+		base = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (base == MAP_FAILED)
+			base = NULL;
+	}
+	close(fd);
+	return base;
+}
+
+/*
+ * Replay the artifact for the library at 'pathname' if there is a
+ * valid one.  Returns 0 if replayed, nonzero if replay failed, or
+ * positive if the library must be compiled; in that case 'key' is
+ * valid if the result should be saved with cache_compile_end().
+ */
+int cache_load(struct mlc_ctx *ctx, const char *pathname,
+	       struct cache_key *key)
+{
+	key->valid = false;
+	if (ctx->options.inline_size || ctx->options.church)
+		return 1;
+	if (cache_key_hash(key->hash, pathname))
+		return 1;
+	char *path = artifact_path(key->hash);
+	if (!path)
+		return 1;
+	key->valid = true;
+
+	size_t size;
+	const unsigned char *base = map_artifact(path, &size);
+	xfree(path);
+	if (!base)
+		return 1;
+
+	const struct cache_header *header = (const void *) base;
+	struct reader r = {
+		.ctx = ctx,
+		.p = base + sizeof *header,
+		.end = base + size,
+		.ok = size > sizeof *header,
+	};
+	if (r.ok && (memcmp(header->magic, CACHE_MAGIC, sizeof header->magic) ||
+		     header->version != CACHE_VERSION ||
+		     memcmp(header->hash, key->hash, sizeof header->hash)))
+		r.ok = false;
+	if (r.ok)
+		replay(&r);
+	if (!r.ok) {
+		munmap((void *) base, size);
+		return 1;
+	}
+
+	r.p = base + sizeof *header;
+	r.build = true;
+	push_recorder(ctx, false);
+	int retval = replay(&r);
+	pop_recorder(ctx);
+	munmap((void *) base, size);
+	return retval ? -1 : 0;
+}
+
+void cache_compile_begin(struct mlc_ctx *ctx)
+{
+	push_recorder(ctx, true);
+}
+
+void cache_compile_end(struct mlc_ctx *ctx, const struct cache_key *key,
+		       bool ok)
+{
+	if (ok && key->valid && ctx->recorder->recording)
+		write_artifact(ctx->env, key, ctx->recorder);
+	pop_recorder(ctx);
+}
+
+/*
+ * After an internal error (see libmlc.c) includes may be left open;
+ * their recorders are discarded without saving anything.
+ */
+void cache_abandon(struct mlc_ctx *ctx)
+{
+	while (ctx->recorder)
+		pop_recorder(ctx);
+}
@@ -0,0 +1,69 @@
+#ifndef LARK_MLC_CACHE_H
+#define LARK_MLC_CACHE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Compiled library cache.  Included libraries which contain only
+ * definitions and further includes are saved after parsing as compiled
+ * artifacts (.mlo files) holding their resolved terms, keyed by a
+ * SHA-256 hash of the source and of the identity of the mlc build, and
+ * named by that key.  Later includes of the same source replay the
+ * artifact rather than parsing and resolving it again; any change to
+ * the source or any rebuild of mlc changes the key, so the library is
+ * recompiled (and a new artifact written) automatically.
+ *
+ * References to global names are saved by name and resolved when the
+ * artifact is replayed, exactly as resolve() would resolve them then:
+ * to the defined value if there is one, otherwise to a free variable.
+ *
+ * Artifacts live in $MLC_CACHE, or $XDG_CACHE_HOME/mlc, or ~/.cache/mlc;
+ * setting MLC_CACHE to the empty string disables the cache, as does
+ * inlining (since inlined definitions don't track their sources).
+ */
+
+#include <stdbool.h>
+
+#include <util/sha2.h>
+#include <util/symtab.h>
+
+struct mlc_ctx;
+struct term;
+
+struct cache_key {
+	bool valid;
+	unsigned char hash [SHA256_BIN_BYTES];	/* of source and build */
+};
+
+extern int cache_load(struct mlc_ctx *ctx, const char *pathname,
+		      struct cache_key *key);
+extern void cache_compile_begin(struct mlc_ctx *ctx);
+extern void cache_compile_end(struct mlc_ctx *ctx,
+			      const struct cache_key *key, bool ok);
+extern void cache_abandon(struct mlc_ctx *ctx);
+
+extern void cache_note_define(struct mlc_ctx *ctx, symbol_mt name,
+			      struct term *val);
+extern void cache_note_include(struct mlc_ctx *ctx, const char *pathname);
+extern void cache_note_uncacheable(struct mlc_ctx *ctx);
+
+#endif /* LARK_MLC_CACHE_H */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Exercise the compiled library cache: artifacts are written when a
+ * library is first included, replayed when its source is unchanged,
+ * and rewritten when it changes or is damaged.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <util/message.h>
+
+#include "libmlc.h"
+
+static char the_dir [] = "/tmp/mlccachetest.XXXXXX";
+
+static char *path(const char *name)
+{
+	static char buf [sizeof the_dir + 80];
+	snprintf(buf, sizeof buf, "%s/%s", the_dir, name);
+	return buf;
+}
+
+static void write_file(const char *name, const char *text)
+{
+	FILE *out = fopen(path(name), "w");
+	if (!out || fputs(text, out) == EOF || fclose(out))
+		panicf("Couldn't write %s\n", path(name));
+}
+
+/* artifact names are source hashes, so we list them by count only */
+static size_t count_artifacts(const char *damage)
+{
+	DIR *dir = opendir(path("cache"));
+	if (!dir)
+		return 0;
+	size_t count = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		size_t len = strlen(entry->d_name);
+		if (len < 4 || strcmp(entry->d_name + len - 4, ".mlo"))
+			continue;
+		++count;
+		if (damage) {
+			char name [len + sizeof "cache/"];
+			strcpy(name, "cache/");
+			strcat(name, entry->d_name);
+			write_file(name, damage);
+		}
+	}
+	closedir(dir);
+	return count;
+}
+
+static void eval(const char *label, const char *text)
+{
+	struct mlc_options options = { .empty_env = true, .quiet = true };
+	struct mlc_ctx *ctx = mlc_ctx_create(&options);
+	struct mlc_result result;
+	mlc_eval(ctx, text, &result);
+	printf("[%s] status %d, %zu artifacts:\n%s", label, result.status,
+	       count_artifacts(NULL), result.output);
+	mlc_result_fini(&result);
+	mlc_ctx_destroy(ctx);
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+	if (!mkdtemp(the_dir))
+		panic("Couldn't create temporary directory\n");
+	setenv("MLC_INCLUDE", the_dir, 1);
+	setenv("MLC_CACHE", path("cache"), 1);
+	mlc_init();
+
+	write_file("base.mlc", "one := 1. pair := [a, b. [a | b]].\n");
+	write_file("lib.mlc", "#include \"base.mlc\".\n"
+			      "two := one + one.\n"
+			      "swap := [p. pair (#1 p, #0 p)].\n"
+			      "later := [x. free-name (x, one)].\n");
+	const char *use = "#include \"lib.mlc\". swap ([one | two]). "
+			  "later (3).";
+
+	eval("compile", use);
+	eval("replay", use);
+
+	write_file("base.mlc", "one := 10. pair := [a, b. [b | a]].\n");
+	eval("changed base", use);
+
+	count_artifacts("damaged");
+	eval("damaged", use);
+
+	write_file("lib.mlc", "#include \"base.mlc\".\n"
+			      "#echo \"not cacheable\".\n");
+	eval("uncacheable", "#include \"lib.mlc\". one.");
+	eval("uncacheable again", "#include \"lib.mlc\". one.");
+
+	char command [sizeof the_dir + 16];
+	snprintf(command, sizeof command, "rm -rf %s", the_dir);
+	return system(command) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
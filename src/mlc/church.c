@@ -0,0 +1,537 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdarg.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+#include <util/symtab.h>
+#include <util/wordtab.h>
+
+#include "church.h"
+#include "env.h"
+#include "node.h"
+#include "term.h"
+
+/*
+ * Applying a native numeral expands at most this many applications at
+ * once; the rest stays native, to be expanded by later steps, so huge
+ * numerals don't stall reduction between budget checks.
+ */
+#define CHURCH_EXPAND (1UL << 16)
+
+static const size_t the_arities[] = {
+	[CHURCH_SUCC] = 1, [CHURCH_PRED] = 1,
+	[CHURCH_ADD] = 2, [CHURCH_SUB] = 2,
+	[CHURCH_MULT] = 2, [CHURCH_POW] = 2,
+};
+
+static struct {
+	enum church_op op;
+	struct term *pattern;
+} the_patterns[8];
+static size_t the_npatterns;
+
+static struct wordtab the_combinators;	/* env values to operations */
+static struct env *the_env;		/* of the definition being noted */
+
+/*
+ * Patterns are closed terms built with the following helpers; they
+ * contain only abstractions, applications, and bound variables.
+ */
+static struct term *Lam(size_t nparams, struct term *body)
+{
+	symbol_mt *formals = xmalloc((nparams + 1) * sizeof *formals);
+	for (size_t i = 0; i <= nparams; ++i)
+		formals[i] = the_empty_symbol;
+	struct term **bodies = xmalloc(sizeof *bodies);
+	bodies[0] = body;
+	return TermAbs(nparams + 1, formals, 1, bodies);
+}
+
+static struct term *App(struct term *fun, size_t nargs, ...)
+{
+	struct term **args = xmalloc(nargs * sizeof *args);
+	va_list ap;
+	va_start(ap, nargs);
+	for (size_t i = 0; i < nargs; ++i)
+		args[i] = va_arg(ap, struct term *);
+	va_end(ap);
+	return TermApp(fun, nargs, args);
+}
+
+static struct term *Var(int up, int across)
+{
+	return TermBoundVar(up, across, the_empty_symbol);
+}
+
+static void add_pattern(enum church_op op, struct term *pattern)
+{
+	assert(the_npatterns < sizeof the_patterns / sizeof *the_patterns);
+	the_patterns[the_npatterns].op = op;
+	the_patterns[the_npatterns++].pattern = pattern;
+}
+
+static void church_init(void)
+{
+	if (the_npatterns)
+		return;
+	wordtab_init(&the_combinators, 16);
+
+	struct term
+		*id = Lam(1, Var(0, 1)),
+		*truth = Lam(1, Lam(1, Var(1, 1))),
+		*falsity = Lam(1, Lam(1, Var(0, 1))),
+		*zero = falsity,
+		*cons = Lam(2, Lam(1, App(App(Var(0, 1), 1, Var(1, 1)),
+					  1, Var(1, 2)))),
+		*car = Lam(1, App(Var(0, 1), 1, truth)),
+		*cdr = Lam(1, App(Var(0, 1), 1, falsity));
+
+	/* [n. [f. [x. x; n (f); f]]] */
+	struct term *succ =
+		Lam(1, Lam(1, Lam(1, App(Var(1, 1), 1,
+			App(App(Var(2, 1), 1, Var(1, 1)), 1, Var(0, 1))))));
+
+	/* [n. cons (zero, zero); n (phi); car] */
+	struct term *phi =
+		Lam(1, App(cons, 2, App(cdr, 1, Var(0, 1)),
+			   App(succ, 1, App(cdr, 1, Var(0, 1)))));
+	struct term *pred =
+		Lam(1, App(car, 1, App(App(Var(0, 1), 1, phi),
+				       1, App(cons, 2, zero, zero))));
+
+	/* [n. [f. [x. id; ([_. x]; n ([g. [h. f; g; h]]))]]] */
+	struct term *pred_primitive =
+		Lam(1, Lam(1, Lam(1, App(App(App(Var(2, 1), 1,
+			Lam(1, Lam(1, App(Var(0, 1), 1,
+					  App(Var(1, 1), 1, Var(3, 1)))))),
+			1, Lam(1, Var(1, 1))), 1, id))));
+
+	add_pattern(CHURCH_SUCC, succ);
+	add_pattern(CHURCH_PRED, pred);
+	add_pattern(CHURCH_PRED, pred_primitive);
+
+	/* [m, n. [f. [x. x; m (f); n (f)]]] */
+	add_pattern(CHURCH_ADD,
+		Lam(2, Lam(1, Lam(1, App(App(Var(2, 2), 1, Var(1, 1)), 1,
+			App(App(Var(2, 1), 1, Var(1, 1)), 1, Var(0, 1)))))));
+
+	/* [m, n. m; n (pred)] */
+	add_pattern(CHURCH_SUB,
+		Lam(2, App(App(Var(0, 2), 1, pred), 1, Var(0, 1))));
+	add_pattern(CHURCH_SUB,
+		Lam(2, App(App(Var(0, 2), 1, pred_primitive), 1, Var(0, 1))));
+
+	/* [m, n. [f. f; n; m]] */
+	add_pattern(CHURCH_MULT,
+		Lam(2, Lam(1, App(Var(1, 1), 1, App(Var(1, 2), 1, Var(0, 1))))));
+
+	/* [b, e. b; e] */
+	add_pattern(CHURCH_POW, Lam(2, App(Var(0, 2), 1, Var(0, 1))));
+}
+
+/*
+ * Resolve lifts the global definitions a term references through a
+ * redex whose arguments are the definitions' (shared, closed) values.
+ * While walking a term we keep a stack of binders so that a bound
+ * variable naming such a definition can be followed to its value.
+ */
+struct frame {
+	const struct frame *next;
+	const struct term *lift;	/* lifting redex, or NULL */
+};
+
+static bool is_lift(const struct term *term)
+{
+	if (term->variety != TERM_APP)
+		return false;
+	const struct term *fun = term->app.fun;
+	if (fun->variety != TERM_ABS || fun->abs.nbodies != 1 ||
+	    fun->abs.nformals != term->app.nargs + 1)
+		return false;
+	for (size_t i = 0; i < term->app.nargs; ++i)
+		if (!env_lookup_val(the_env, term->app.args[i]))
+			return false;
+	return true;
+}
+
+/*
+ * Look up a bound variable.  If it names a lifted definition, return
+ * the definition's value; otherwise return NULL and set *up to the
+ * variable's index not counting lifting binders.  Returns false if
+ * the variable refers beyond the known binders.
+ */
+static bool lookup(const struct term *var, const struct frame *frames,
+		   const struct term **val, int *up)
+{
+	int nlifts = 0;
+	for (int i = 0; i < var->bv.up; ++i, frames = frames->next) {
+		if (!frames)
+			return false;
+		nlifts += !!frames->lift;
+	}
+	if (!frames)
+		return false;
+	if (frames->lift) {
+		assert(var->bv.across >= 1);
+		*val = frames->lift->app.args[var->bv.across - 1];
+	} else {
+		*val = NULL;
+		*up = var->bv.up - nlifts;
+	}
+	return true;
+}
+
+/*
+ * Follow bound variables naming lifted definitions to their values;
+ * values are closed, so their frames start afresh.
+ */
+static const struct term *deref(const struct term *term,
+				const struct frame **frames)
+{
+	const struct term *val;
+	int up;
+	while (term->variety == TERM_BOUND_VAR &&
+	       lookup(term, *frames, &val, &up) && val) {
+		term = val;
+		*frames = NULL;
+	}
+	return term;
+}
+
+static bool match(const struct term *pattern, const struct term *term,
+		  const struct frame *frames)
+{
+	term = deref(term, &frames);
+	if (is_lift(term)) {
+		struct frame frame = { .next = frames, .lift = term };
+		return match(pattern, term->app.fun->abs.bodies[0], &frame);
+	}
+	if (pattern->variety != term->variety)
+		return false;
+
+	switch (term->variety) {
+	case TERM_ABS: {
+		if (pattern->abs.nformals != term->abs.nformals ||
+		    term->abs.nbodies != 1)
+			return false;
+		struct frame frame = { .next = frames, .lift = NULL };
+		return match(pattern->abs.bodies[0], term->abs.bodies[0],
+			     &frame);
+	}
+	case TERM_APP:
+		if (pattern->app.nargs != term->app.nargs ||
+		    !match(pattern->app.fun, term->app.fun, frames))
+			return false;
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			if (!match(pattern->app.args[i], term->app.args[i],
+				   frames))
+				return false;
+		return true;
+	case TERM_BOUND_VAR: {
+		/* deref() has followed lifted definitions, so val is NULL */
+		const struct term *val;
+		int up = 0;
+		return lookup(term, frames, &val, &up) &&
+		       pattern->bv.up == up &&
+		       pattern->bv.across == term->bv.across;
+	}
+	default:
+		return false;
+	}
+}
+
+enum church_op church_combinator(const struct term *val)
+{
+	if (!the_npatterns)
+		return CHURCH_NONE;
+	return (enum church_op) wordtab_get(&the_combinators, (word) val);
+}
+
+/*
+ * A definition referencing others is a lifting redex, which reduction
+ * turns into a copy of the abstraction within; we note that too, so
+ * flattening marks its node and copies inherit the mark.
+ */
+void church_note_define(struct env *env, struct term *val)
+{
+	church_init();
+	the_env = env;
+	for (size_t i = 0; i < the_npatterns; ++i) {
+		if (!match(the_patterns[i].pattern, val, NULL))
+			continue;
+		void *op = (void *) (word) the_patterns[i].op;
+		wordtab_put(&the_combinators, (word) val, op);
+		for (; is_lift(val); val = val->app.fun->abs.bodies[0])
+			wordtab_put(&the_combinators,
+				    (word) val->app.fun->abs.bodies[0], op);
+		return;
+	}
+}
+
+struct term *church_numeral(unsigned long n)
+{
+	symbol_mt f = symtab_intern("f"), x = symtab_intern("x");
+	struct term *body = TermBoundVar(0, 1, x);
+	while (n--)
+		body = App(TermBoundVar(1, 1, f), 1, body);
+
+	symbol_mt *formals = xmalloc(2 * sizeof *formals);
+	formals[0] = the_empty_symbol;
+	formals[1] = x;
+	struct term **bodies = xmalloc(sizeof *bodies);
+	bodies[0] = body;
+	body = TermAbs(2, formals, 1, bodies);
+
+	formals = xmalloc(2 * sizeof *formals);
+	formals[0] = the_empty_symbol;
+	formals[1] = f;
+	bodies = xmalloc(sizeof *bodies);
+	bodies[0] = body;
+	return TermAbs(2, formals, 1, bodies);
+}
+
+/*
+ * Compute the numeral an operation gives; returns false if it would
+ * overflow.  Note that e (b) is the numeral b^e only for nonzero e;
+ * zero (b) is the identity, so we leave that to reduction.
+ */
+static bool compute(enum church_op op, const unsigned long *a,
+		    unsigned long *n)
+{
+	switch (op) {
+	case CHURCH_SUCC:
+		if (a[0] == ULONG_MAX)
+			return false;
+		*n = a[0] + 1;
+		return true;
+	case CHURCH_PRED:
+		*n = a[0] ? a[0] - 1 : 0;
+		return true;
+	case CHURCH_ADD:
+		if (a[1] > ULONG_MAX - a[0])
+			return false;
+		*n = a[0] + a[1];
+		return true;
+	case CHURCH_SUB:
+		*n = a[0] > a[1] ? a[0] - a[1] : 0;
+		return true;
+	case CHURCH_MULT:
+		if (a[0] && a[1] > ULONG_MAX / a[0])
+			return false;
+		*n = a[0] * a[1];
+		return true;
+	case CHURCH_POW:
+		if (!a[1])
+			return false;
+		*n = 1;
+		for (unsigned long e = a[1]; e--; /* nada */) {
+			if (a[0] > 1 && *n > ULONG_MAX / a[0])
+				return false;
+			*n *= a[0];
+			if (*n <= 1)
+				break;	/* 0 or 1 to any power */
+		}
+		return true;
+	default:
+		assert(0);
+		return false;
+	}
+}
+
+/*
+ * Numerals in the reduction graph are native counts, or abstractions
+ * of the form [f. [x. x; f; ... f]] whose applications may be reached
+ * through substitutions and renames.  A parameter is referenced either
+ * directly, by a bound variable in a node of the body, or through a
+ * variable node which beta-reduction allocated to hold one.
+ */
+static const struct node *chase(const struct node *node)
+{
+	while (node->variety == NODE_VAR &&
+	       node->slots[0].variety == SLOT_SUBST)
+		node = node->slots[0].subst;
+	return node;
+}
+
+/*
+ * Whether 'slot', in a node at 'depth', refers to the first parameter
+ * of the abstraction whose body is at depth 'binder'.
+ */
+static bool is_param(struct slot slot, int depth, int binder)
+{
+	if (slot.variety == SLOT_SUBST) {
+		const struct node *var = chase(slot.subst);
+		if (var->variety != NODE_VAR)
+			return false;
+		slot = var->slots[0];
+		depth = var->depth;
+	}
+	return slot.variety == SLOT_BOUND && slot.bv.across == 1 &&
+	       depth - slot.bv.up == binder;
+}
+
+static bool numeral(const struct node *node, unsigned long *n)
+{
+	node = chase(node);
+	if (node_is_church(node)) {
+		*n = node->slots[0].count;
+		return true;
+	}
+	if (node->variety != NODE_ABS || node->nslots != 2)
+		return false;
+	int f = node->depth + 1;
+	node = chase(node_abs_body(node)->next);
+	if (node->variety != NODE_ABS || node->nslots != 2)
+		return false;
+	int x = node->depth + 1;
+
+	struct slot slot = node_abs_body(node)->slots[0];
+	int depth = x;
+	for (*n = 0; slot.variety == SLOT_SUBST; ++*n) {
+		node = chase(slot.subst);
+		if (node->variety == NODE_VAR)
+			break;
+		if (node->variety != NODE_APP || node->nslots != 2 ||
+		    !is_param(node->slots[0], node->depth, f))
+			return false;
+		slot = node->slots[1];
+		depth = node->depth;
+	}
+	return is_param(slot, depth, x);
+}
+
+bool church_reduce(struct node *redex)
+{
+	assert(redex->variety == NODE_APP);
+	assert(redex->slots[0].variety == SLOT_SUBST);
+	enum church_op op = redex->slots[0].subst->church;
+	size_t nargs = node_app_nargs(redex);
+	if (op == CHURCH_NONE || the_arities[op] != nargs)
+		return false;
+
+	unsigned long a[2], n;
+	for (size_t i = 0; i < nargs; ++i)
+		if (redex->slots[i+1].variety != SLOT_SUBST ||
+		    !numeral(redex->slots[i+1].subst, a + i))
+			return false;
+	if (!compute(op, a, &n))
+		return false;
+
+	/* as for primitives, the redex becomes the result */
+	assert(redex->nref == 1);
+	assert(redex->backref);
+	node_recycle(redex);
+	redex->slots[0].variety = SLOT_CHURCH;
+	redex->slots[0].count = n;
+	redex->variety = NODE_VAL;
+	redex->nslots = 1;
+	return true;
+}
+
+/*
+ * Link 'node' into the chain after 'prev' as the referent of 'slot'.
+ */
+static struct node *link_ref(struct node *prev, struct slot *slot,
+			     struct node *node)
+{
+	prev->next = node;
+	slot->variety = SLOT_SUBST;
+	slot->subst = node;
+	node->backref = slot;
+	node->nref = 1;
+	return node;
+}
+
+/*
+ * Applying the numeral n to f gives [x. x; f; ... f], with n
+ * applications of f.  We build that body directly and turn the redex
+ * into its abstraction, expanding at most CHURCH_EXPAND applications;
+ * beyond that the innermost is x; (n - CHURCH_EXPAND) (f), which is
+ * left for later steps.
+ */
+struct node *church_expand(struct node *redex)
+{
+	assert(redex->variety == NODE_APP);
+	assert(node_is_church(redex->slots[0].subst));
+	if (node_app_nargs(redex) != 1)
+		panic("Arity mismatch applying a Church numeral\n");
+
+	unsigned long n = redex->slots[0].subst->slots[0].count,
+		      k = n < CHURCH_EXPAND ? n : CHURCH_EXPAND;
+	int depth = redex->depth + 1;
+	struct slot f = redex->slots[1];
+	if (f.variety == SLOT_BOUND)
+		f.bv.up++;		/* now referenced from the body */
+	const struct slot x = {
+		.variety = SLOT_BOUND,
+		.bv.up = 0,
+		.bv.across = 1,
+	};
+
+	struct node *first, *last;
+	if (!k) {
+		first = last = NodeBoundVar(NULL, depth, 0, 1);
+	} else {
+		first = last = NULL;
+		for (unsigned long i = 0; i < k; ++i) {
+			struct node *app = NodeApp(last, depth, 1);
+			app->slots[0] = f;
+			app->slots[1] = x;
+			if (f.variety == SLOT_SUBST)
+				f.subst->nref++;
+			if (last)
+				link_ref(last, &last->slots[1], app);
+			else
+				first = app;
+			last = app;
+		}
+	}
+	if (k < n) {
+		/* x; (n - k) (f) */
+		struct node *inner = NodeApp(last, depth, 1),
+			    *rest = NodeApp(inner, depth, 1),
+			    *count = NodeChurch(rest, depth, n - k);
+		link_ref(last, &last->slots[1], inner);
+		link_ref(inner, &inner->slots[0], rest);
+		link_ref(rest, &rest->slots[0], count);
+		inner->slots[1] = x;
+		rest->slots[1] = f;
+		if (f.variety == SLOT_SUBST)
+			f.subst->nref++;
+		last = count;
+	}
+	for (struct node *node = first; node; node = node->next)
+		node->origin = redex->origin;
+	struct node *body = NodeSentinel(first, last, depth);
+
+	node_recycle(redex);
+	redex->variety = NODE_ABS;
+	redex->slots[SLOT_ABS_BODY].variety = SLOT_BODY;
+	redex->slots[SLOT_ABS_BODY].subst = body;
+	redex->slots[1].variety = SLOT_PARAM;
+	redex->slots[1].name = symtab_intern("x");
+	return redex;
+}
@@ -0,0 +1,61 @@
+#ifndef LARK_MLC_CHURCH_H
+#define LARK_MLC_CHURCH_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Church-numeral acceleration.  With --church, definitions are checked
+ * against the canonical Church combinators (successor, addition,
+ * multiplication, exponentiation, predecessor and subtraction, as in
+ * lib/mlc/church.mlc), and flattening marks the abstraction nodes of
+ * recognized definitions.  During reduction, church_reduce() replaces
+ * an application of a marked combinator to numerals by the resulting
+ * numeral, held natively as a count; so numerals computed at run time
+ * (loop counters, say) are accelerated just as literals are.  A native
+ * numeral is turned back into Church form only when it is applied, by
+ * church_expand(), or when the normal form is read back.
+ */
+
+#include <stdbool.h>
+
+struct env;
+struct node;
+struct term;
+
+enum church_op {
+	CHURCH_NONE,
+	CHURCH_SUCC,
+	CHURCH_PRED,
+	CHURCH_ADD,
+	CHURCH_SUB,
+	CHURCH_MULT,
+	CHURCH_POW,
+};
+
+extern enum church_op church_combinator(const struct term *val);
+extern void church_note_define(struct env *env, struct term *val);
+extern struct term *church_numeral(unsigned long n);
+
+extern bool church_reduce(struct node *redex);
+extern struct node *church_expand(struct node *redex);
+
+#endif /* LARK_MLC_CHURCH_H */
@@ -0,0 +1,1012 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+#include <util/symtab.h>
+#include <util/wordtab.h>
+
+#include "compile.h"
+#include "ctx.h"
+#include "env.h"
+#include "form.h"
+#include "prim.h"
+#include "readback.h"
+#include "reduce.h"
+#include "term.h"
+
+/*
+ * Code for the closure machine is a single array of instructions per
+ * compiled statement.  Abstraction bodies are compiled in line and
+ * jumped over; values of global definitions are compiled on demand
+ * after the statement itself, and are evaluated at most once per run.
+ */
+enum op {
+	OP_NUM,		/* push num */
+	OP_STR,		/* push str */
+	OP_VAR,		/* push slot b of the frame a levels up */
+	OP_GLOBAL,	/* push the value of global a */
+	OP_CLOSURE,	/* push closure with a params, code at b */
+	OP_CALL,	/* apply closure to a arguments */
+	OP_TAILCALL,	/* likewise, replacing the current frame */
+	OP_PRIM,	/* apply prim to a arguments */
+	OP_PRIMVAL,	/* push prim as a value */
+	OP_JUMP,	/* jump to a */
+	OP_JUMPF,	/* pop number, jump to a if zero */
+	OP_LET,		/* pop a - 1 values into a new frame */
+	OP_UNLET,	/* leave the innermost frame */
+	OP_CELL,	/* pop a values into a new cell */
+	OP_RETURN,	/* leave the current frame, return to caller */
+};
+
+struct insn {
+	enum op op;
+	unsigned a, b;
+	union {
+		double num;
+		const char *str;
+		const struct prim *prim;
+	};
+};
+
+struct global {
+	const struct term *term;
+	size_t start;
+	bool known;
+	struct value *val;
+};
+
+static struct insn *the_code;
+static size_t the_code_size, the_code_alloc;
+static struct global *the_globals;
+static size_t the_nglobals, the_globals_alloc;
+static struct wordtab the_global_index;	/* env values to index + 1 */
+static const char *the_compile_error;
+static struct mlc_ctx *the_ctx;		/* of the current compile_run() */
+
+static size_t emit(enum op op, unsigned a, unsigned b)
+{
+	if (the_code_size == the_code_alloc) {
+		the_code_alloc = the_code_alloc ? 2 * the_code_alloc : 256;
+		the_code = xrealloc(the_code,
+				    the_code_alloc * sizeof *the_code);
+	}
+	the_code[the_code_size] = (struct insn) { .op = op, .a = a, .b = b };
+	return the_code_size++;
+}
+
+/*
+ * Careful: emit() may move the code, so index the_code after calling.
+ */
+static void emit_num(double num)
+{
+	size_t i = emit(OP_NUM, 0, 0);
+	the_code[i].num = num;
+}
+
+static void emit_str(const char *str)
+{
+	size_t i = emit(OP_STR, 0, 0);
+	the_code[i].str = str;
+}
+
+static void emit_prim(enum op op, const struct prim *prim, size_t nargs)
+{
+	size_t i = emit(op, nargs, 0);
+	the_code[i].prim = prim;
+}
+
+static unsigned global_index(const struct term *term)
+{
+	word index = (word) wordtab_get(&the_global_index, (word) term);
+	if (index)
+		return index - 1;
+	if (the_nglobals == the_globals_alloc) {
+		the_globals_alloc = the_globals_alloc ?
+			2 * the_globals_alloc : 16;
+		the_globals = xrealloc(the_globals, the_globals_alloc *
+				       sizeof *the_globals);
+	}
+	the_globals[the_nglobals] = (struct global) { .term = term };
+	wordtab_put(&the_global_index, (word) term,
+		    (void *) (word) (the_nglobals + 1));
+	return the_nglobals++;
+}
+
+static bool prim_compiles(const struct prim *prim, size_t nargs)
+{
+	if (prim_num_arity(prim))
+		return prim_num_arity(prim) == nargs;
+	if (prim == &prim_car || prim == &prim_cdr ||
+	    prim == &prim_is_cell || prim == &prim_is_nil ||
+	    prim == &prim_is_pair || prim == &prim_nelems)
+		return nargs == 1;
+	if (prim == &prim_at || prim == &prim_cell ||
+	    prim == &prim_concat || prim == &prim_fill)
+		return nargs == 2;
+	return false;
+}
+
+/*
+ * Calls in tail position replace the caller's frame, so loops written
+ * as tail recursion run in constant space; within a let the frame in
+ * hand is the let's rather than the caller's, so we don't bother.
+ */
+static void compile(const struct term *term, bool tail, unsigned nlets)
+{
+	if (the_compile_error)
+		return;
+
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX: {
+		if (term->abs.nbodies != 1) {
+			the_compile_error = "multiple bodies";
+			return;
+		}
+		size_t jump = emit(OP_JUMP, 0, 0), start = the_code_size;
+		compile(term->abs.bodies[0], true, 0);
+		emit(OP_RETURN, 0, 0);
+		the_code[jump].a = the_code_size;
+		emit(OP_CLOSURE, term->abs.nformals - 1, start);
+		return;
+	}
+	case TERM_APP: {
+		const struct term *fun = term->app.fun;
+		size_t nargs = term->app.nargs;
+		for (size_t i = 0; i < nargs; ++i) {
+			const struct term *arg = term->app.args[i];
+			if (env_lookup_val(the_ctx->env, arg))
+				emit(OP_GLOBAL, global_index(arg), 0);
+			else
+				compile(arg, false, nlets);
+		}
+
+		/* direct application, including lifted definitions */
+		if (fun->variety == TERM_ABS && fun->abs.nbodies == 1 &&
+		    fun->abs.nformals == nargs + 1) {
+			emit(OP_LET, nargs + 1, 0);
+			compile(fun->abs.bodies[0], false, nlets + 1);
+			emit(OP_UNLET, 0, 0);
+			return;
+		}
+		if (fun->variety == TERM_PRIM) {
+			if (!prim_compiles(fun->prim, nargs)) {
+				the_compile_error = fun->prim->name;
+				return;
+			}
+			emit_prim(OP_PRIM, fun->prim, nargs);
+			return;
+		}
+		compile(fun, false, nlets);
+		emit(tail && !nlets ? OP_TAILCALL : OP_CALL, nargs, 0);
+		return;
+	}
+	case TERM_BOUND_VAR:
+		emit(OP_VAR, term->bv.up, term->bv.across);
+		return;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			compile(term->cell.elts[i], false, nlets);
+		emit(OP_CELL, term->cell.nelts, 0);
+		return;
+	case TERM_LET:
+		/* slot 0 is a placeholder, see resolve.c */
+		for (size_t i = 1; i < term->let.ndefs; ++i)
+			compile(term->let.vals[i], false, nlets);
+		emit(OP_LET, term->let.ndefs, 0);
+		compile(term->let.body, false, nlets + 1);
+		emit(OP_UNLET, 0, 0);
+		return;
+	case TERM_NUM:
+		emit_num(term->num);
+		return;
+	case TERM_STRING:
+		emit_str(term->str);
+		return;
+	case TERM_TEST: {
+		if (term->test.ncsqs != 1 || term->test.nalts != 1) {
+			the_compile_error = "multiple branches";
+			return;
+		}
+		compile(term->test.pred, false, nlets);
+		size_t jumpf = emit(OP_JUMPF, 0, 0);
+		compile(term->test.csqs[0], tail, nlets);
+		size_t jump = emit(OP_JUMP, 0, 0);
+		the_code[jumpf].a = the_code_size;
+		compile(term->test.alts[0], tail, nlets);
+		the_code[jump].a = the_code_size;
+		return;
+	}
+	case TERM_FREE_VAR:
+		the_compile_error = "free variable";
+		return;
+	case TERM_PRIM:
+		if (!prim_compiles(term->prim, 1) &&
+		    !prim_compiles(term->prim, 2)) {
+			the_compile_error = term->prim->name;
+			return;
+		}
+		emit_prim(OP_PRIMVAL, term->prim, 0);
+		return;
+	default:
+		the_compile_error = "unsupported term";
+		return;
+	}
+}
+
+/*
+ * Run-time values.  Frames hold an abstraction's arguments (slot 0 is
+ * the closure itself, for recursion) or a let's definitions.  Frames
+ * are recycled when their activation ends unless a closure has
+ * captured them.  Frames, closures, and cells are allocated from an
+ * arena which is collected by copying once it grows past a threshold,
+ * so a long run needs only as much memory as it keeps live.
+ */
+enum value_variety {
+	VALUE_UNDEFINED,
+	VALUE_CELL,
+	VALUE_CLOSURE,
+	VALUE_NUM,
+	VALUE_PRIM,
+	VALUE_STRING,
+};
+
+struct value {
+	enum value_variety variety;
+	union {
+		struct cell *cell;
+		struct closure *closure;
+		double num;
+		const struct prim *prim;
+		const char *str;
+	};
+};
+
+/*
+ * Each object in the arena begins with its kind; the collector
+ * overwrites an object it has copied with a forwarding pointer.
+ */
+enum object_kind {
+	OBJECT_FRAME = 1,
+	OBJECT_CLOSURE,
+	OBJECT_CELL,
+	OBJECT_FORWARDED,
+};
+
+struct frame {
+	unsigned char kind;
+	bool captured;
+	unsigned nslots;
+	struct frame *up;
+	struct value slots[];
+};
+
+struct closure {
+	unsigned char kind;
+	unsigned nparams;
+	size_t start;
+	struct frame *env;
+};
+
+struct cell {
+	unsigned char kind;
+	size_t nelts;
+	struct value elts[];
+};
+
+struct forward {
+	unsigned char kind;
+	void *to;
+};
+
+struct block {
+	struct block *next;
+	size_t used, size;
+	char data[] __attribute__ ((aligned (16)));
+};
+
+#define BLOCK_SIZE (1 << 16)
+#define FRAME_FREE_SLOTS 8
+#define COLLECT_BYTES ((size_t) 1 << 22)
+
+static struct block *the_blocks;
+static size_t the_bytes, the_collect_bytes;
+static struct frame *the_free_frames[FRAME_FREE_SLOTS + 1];
+
+static struct {
+	unsigned long calls, frames, closures, cells, prims, collections;
+} the_run_stats;
+
+static void *run_alloc(size_t size)
+{
+	size = (size + 15) & ~(size_t) 15;
+	if (!the_blocks || the_blocks->used + size > the_blocks->size) {
+		size_t bsize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+		struct block *block = xmalloc(sizeof *block + bsize);
+		block->next = the_blocks;
+		block->used = 0;
+		block->size = bsize;
+		the_blocks = block;
+		the_bytes += bsize;
+	}
+	void *p = the_blocks->data + the_blocks->used;
+	the_blocks->used += size;
+	return p;
+}
+
+static void free_blocks(struct block *block)
+{
+	while (block) {
+		struct block *next = block->next;
+		xfree(block);
+		block = next;
+	}
+}
+
+static void run_free_all(void)
+{
+	free_blocks(the_blocks);
+	the_blocks = NULL;
+	the_bytes = 0;
+	memset(the_free_frames, 0, sizeof the_free_frames);
+	for (size_t i = 0; i < the_nglobals; ++i)
+		if (the_globals[i].known)
+			xfree(the_globals[i].val);
+}
+
+static struct frame *frame_alloc(struct frame *up, unsigned nslots)
+{
+	struct frame *frame;
+	if (nslots <= FRAME_FREE_SLOTS && the_free_frames[nslots]) {
+		frame = the_free_frames[nslots];
+		the_free_frames[nslots] = frame->up;
+	} else {
+		frame = run_alloc(sizeof *frame +
+				  nslots * sizeof frame->slots[0]);
+		frame->kind = OBJECT_FRAME;
+		frame->nslots = nslots;
+		the_run_stats.frames++;
+	}
+	frame->up = up;
+	frame->captured = false;
+	return frame;
+}
+
+static void frame_release(struct frame *frame)
+{
+	if (!frame || frame->captured || frame->nslots > FRAME_FREE_SLOTS)
+		return;
+	frame->up = the_free_frames[frame->nslots];
+	the_free_frames[frame->nslots] = frame;
+}
+
+/*
+ * The machine's value and return stacks grow as needed; run() is
+ * reentered for globals and for primitives which apply closures.
+ */
+struct ret {
+	size_t pc;
+	struct frame *frame;
+};
+
+static struct value *the_stack;
+static size_t the_sp, the_stack_alloc;
+static struct ret *the_rets;
+static size_t the_rp, the_rets_alloc;
+static struct frame ***the_frame_roots;	/* each run()'s current frame */
+static size_t the_nframe_roots, the_frame_roots_alloc;
+static const char *the_fault;
+static struct timeval the_run_start;
+
+static inline void push(struct value val)
+{
+	if (the_sp == the_stack_alloc) {
+		the_stack_alloc = the_stack_alloc ? 2 * the_stack_alloc : 256;
+		the_stack = xrealloc(the_stack, the_stack_alloc *
+				     sizeof *the_stack);
+	}
+	the_stack[the_sp++] = val;
+}
+
+static inline void push_ret(size_t pc, struct frame *frame)
+{
+	if (the_rp == the_rets_alloc) {
+		the_rets_alloc = the_rets_alloc ? 2 * the_rets_alloc : 256;
+		the_rets = xrealloc(the_rets, the_rets_alloc *
+				    sizeof *the_rets);
+	}
+	the_rets[the_rp++] = (struct ret) { .pc = pc, .frame = frame };
+}
+
+static void add_frame_root(struct frame **root)
+{
+	if (the_nframe_roots == the_frame_roots_alloc) {
+		the_frame_roots_alloc = the_frame_roots_alloc ?
+			2 * the_frame_roots_alloc : 16;
+		the_frame_roots = xrealloc(the_frame_roots,
+					   the_frame_roots_alloc *
+					   sizeof *the_frame_roots);
+	}
+	the_frame_roots[the_nframe_roots++] = root;
+}
+
+/*
+ * The collector copies everything reachable from the stacks, the
+ * frames of active runs, and the values of globals into fresh blocks,
+ * then frees the old ones.  Copied objects which haven't been scanned
+ * yet are kept on a stack of their own.
+ */
+static void **the_gray;
+static size_t the_ngray, the_gray_alloc;
+
+static size_t object_size(const void *obj)
+{
+	switch (*(const unsigned char *) obj) {
+	case OBJECT_FRAME: {
+		const struct frame *frame = obj;
+		return sizeof *frame + frame->nslots * sizeof frame->slots[0];
+	}
+	case OBJECT_CLOSURE:
+		return sizeof (struct closure);
+	case OBJECT_CELL: {
+		const struct cell *cell = obj;
+		return sizeof *cell + cell->nelts * sizeof cell->elts[0];
+	}
+	default:
+		panicf("Bad object kind %d\n", *(const unsigned char *) obj);
+	}
+}
+
+static void *forward(void *obj)
+{
+	if (!obj)
+		return NULL;
+	struct forward *fwd = obj;
+	if (fwd->kind == OBJECT_FORWARDED)
+		return fwd->to;
+
+	size_t size = object_size(obj);
+	void *copy = run_alloc(size);
+	memcpy(copy, obj, size);
+	fwd->kind = OBJECT_FORWARDED;
+	fwd->to = copy;
+
+	if (the_ngray == the_gray_alloc) {
+		the_gray_alloc = the_gray_alloc ? 2 * the_gray_alloc : 256;
+		the_gray = xrealloc(the_gray, the_gray_alloc *
+				    sizeof *the_gray);
+	}
+	the_gray[the_ngray++] = copy;
+	return copy;
+}
+
+static void forward_value(struct value *val)
+{
+	if (val->variety == VALUE_CELL)
+		val->cell = forward(val->cell);
+	else if (val->variety == VALUE_CLOSURE)
+		val->closure = forward(val->closure);
+}
+
+static void scan(void *obj)
+{
+	switch (*(unsigned char *) obj) {
+	case OBJECT_FRAME: {
+		struct frame *frame = obj;
+		frame->up = forward(frame->up);
+		for (unsigned i = 0; i < frame->nslots; ++i)
+			forward_value(&frame->slots[i]);
+		break;
+	}
+	case OBJECT_CLOSURE: {
+		struct closure *closure = obj;
+		closure->env = forward(closure->env);
+		break;
+	}
+	case OBJECT_CELL: {
+		struct cell *cell = obj;
+		for (size_t i = 0; i < cell->nelts; ++i)
+			forward_value(&cell->elts[i]);
+		break;
+	}
+	}
+}
+
+/*
+ * Collect when the arena has doubled since the last collection, but
+ * no later than the heap budget, which then limits live data.
+ */
+static void set_collect_bytes(void)
+{
+	size_t bytes = 2 * the_bytes, limit = the_ctx->budget.heap_bytes;
+	if (bytes < COLLECT_BYTES)
+		bytes = COLLECT_BYTES;
+	if (limit && the_bytes < limit && bytes > limit)
+		bytes = limit;
+	the_collect_bytes = bytes;
+}
+
+static void collect(void)
+{
+	struct block *old = the_blocks;
+	the_blocks = NULL;
+	the_bytes = 0;
+	/* recycled frames are garbage too */
+	memset(the_free_frames, 0, sizeof the_free_frames);
+
+	for (size_t i = 0; i < the_sp; ++i)
+		forward_value(&the_stack[i]);
+	for (size_t i = 0; i < the_rp; ++i)
+		the_rets[i].frame = forward(the_rets[i].frame);
+	for (size_t i = 0; i < the_nframe_roots; ++i)
+		*the_frame_roots[i] = forward(*the_frame_roots[i]);
+	for (size_t i = 0; i < the_nglobals; ++i)
+		if (the_globals[i].known)
+			forward_value(the_globals[i].val);
+	while (the_ngray)
+		scan(the_gray[--the_ngray]);
+
+	free_blocks(old);
+	the_run_stats.collections++;
+	set_collect_bytes();
+}
+
+static bool check_budget(void)
+{
+	if (the_ctx->budget.steps &&
+	    the_run_stats.calls > the_ctx->budget.steps) {
+		the_reduce_status = REDUCE_STEP_LIMIT;
+		return false;
+	}
+	if (the_ctx->budget.heap_bytes &&
+	    the_bytes > the_ctx->budget.heap_bytes) {
+		the_reduce_status = REDUCE_HEAP_LIMIT;
+		return false;
+	}
+	if (the_ctx->budget.seconds > 0.0) {
+		struct timeval t;
+		gettimeofday(&t, NULL);
+		if ((t.tv_sec - the_run_start.tv_sec) +
+		    (t.tv_usec - the_run_start.tv_usec) / 1e6 >
+		    the_ctx->budget.seconds) {
+			the_reduce_status = REDUCE_TIME_LIMIT;
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool run(size_t pc, struct frame *frame);
+static bool prim(const struct prim *prim, size_t nargs);
+
+/*
+ * Primitives passed as values are applied like closures, taking their
+ * arguments from the stack.
+ */
+static bool prim_value(const struct prim *p, size_t nargs)
+{
+	if (!prim_compiles(p, nargs)) {
+		the_fault = "wrong number of arguments";
+		return false;
+	}
+	return prim(p, nargs);
+}
+
+static bool apply(struct value fun, size_t nargs, struct value *args)
+{
+	if (fun.variety == VALUE_PRIM) {
+		for (size_t i = 0; i < nargs; ++i)
+			push(args[i]);
+		return prim_value(fun.prim, nargs);
+	}
+	if (fun.variety != VALUE_CLOSURE) {
+		the_fault = "application of a non-abstraction";
+		return false;
+	}
+	if (fun.closure->nparams != nargs) {
+		the_fault = "wrong number of arguments";
+		return false;
+	}
+	struct frame *frame = frame_alloc(fun.closure->env, nargs + 1);
+	frame->slots[0] = fun;
+	memcpy(frame->slots + 1, args, nargs * sizeof *args);
+	the_run_stats.calls++;
+	return run(fun.closure->start, frame);
+}
+
+static bool global(unsigned index)
+{
+	struct global *g = &the_globals[index];
+	if (!g->known) {
+		if (!run(g->start, NULL))
+			return false;
+		g->val = xmalloc(sizeof *g->val);
+		*g->val = the_stack[--the_sp];
+		g->known = true;
+	}
+	push(*g->val);
+	return true;
+}
+
+static bool prim(const struct prim *prim, size_t nargs)
+{
+	struct value *args = the_stack + the_sp - nargs, val;
+	size_t arity = prim_num_arity(prim);
+	the_run_stats.prims++;
+
+	if (arity) {
+		double nums[2];
+		for (size_t i = 0; i < arity; ++i) {
+			if (args[i].variety != VALUE_NUM) {
+				the_fault = "non-numeric argument";
+				return false;
+			}
+			nums[i] = args[i].num;
+		}
+		val.variety = VALUE_NUM;
+		val.num = prim_apply_num(prim, nums);
+	} else if (prim == &prim_concat) {
+		if (args[0].variety != VALUE_STRING ||
+		    args[1].variety != VALUE_STRING) {
+			the_fault = "non-string argument";
+			return false;
+		}
+		char *str = xmalloc(strlen(args[0].str) +
+				    strlen(args[1].str) + 1);
+		strcpy(stpcpy(str, args[0].str), args[1].str);
+		val.variety = VALUE_STRING;
+		val.str = str;
+	} else if (prim == &prim_is_cell || prim == &prim_is_nil ||
+		   prim == &prim_is_pair) {
+		val.variety = VALUE_NUM;
+		val.num = args[0].variety == VALUE_CELL &&
+			  (prim == &prim_is_cell ||
+			   args[0].cell->nelts == (prim == &prim_is_pair ? 2 : 0));
+	} else if (prim == &prim_car || prim == &prim_cdr) {
+		if (args[0].variety != VALUE_CELL ||
+		    args[0].cell->nelts != 2) {
+			the_fault = "non-pair argument";
+			return false;
+		}
+		val = args[0].cell->elts[prim == &prim_cdr];
+	} else if (prim == &prim_nelems) {
+		if (args[0].variety != VALUE_CELL) {
+			the_fault = "non-cell argument";
+			return false;
+		}
+		val.variety = VALUE_NUM;
+		val.num = args[0].cell->nelts;
+	} else if (prim == &prim_at) {
+		if (args[0].variety != VALUE_NUM ||
+		    args[1].variety != VALUE_CELL) {
+			the_fault = "bad arguments to $at";
+			return false;
+		}
+		double i = args[0].num;
+		if (i < 0 || i >= args[1].cell->nelts || i != (size_t) i) {
+			the_fault = "index out of range";
+			return false;
+		}
+		val = args[1].cell->elts[(size_t) i];
+	} else {
+		assert(prim == &prim_cell || prim == &prim_fill);
+		if (args[0].variety != VALUE_NUM || args[0].num < 0) {
+			the_fault = "bad cell size";
+			return false;
+		}
+		size_t nelts = args[0].num;
+		struct cell *cell = run_alloc(sizeof *cell +
+					      nelts * sizeof cell->elts[0]);
+		cell->kind = OBJECT_CELL;
+		cell->nelts = nelts;
+		the_run_stats.cells++;
+		val.variety = VALUE_CELL;
+		val.cell = cell;
+		if (prim == &prim_cell) {
+			for (size_t i = 0; i < nelts; ++i)
+				cell->elts[i] = args[1];
+		} else {
+			/*
+			 * Applying the function may collect, moving the
+			 * cell, so keep it on the stack meanwhile.
+			 */
+			for (size_t i = 0; i < nelts; ++i)
+				cell->elts[i].variety = VALUE_UNDEFINED;
+			push(val);
+			for (size_t i = 0; i < nelts; ++i) {
+				struct value index = { .variety = VALUE_NUM,
+						       .num = i };
+				if (!apply(the_stack[the_sp - 2], 1, &index))
+					return false;
+				struct value elt = the_stack[--the_sp];
+				the_stack[the_sp - 1].cell->elts[i] = elt;
+			}
+			val = the_stack[--the_sp];
+		}
+	}
+	the_sp -= nargs;
+	push(val);
+	return true;
+}
+
+/*
+ * Run code from 'pc' in 'frame' until it returns, leaving its value
+ * on the stack; returns false on a fault or exhausted budget.
+ */
+static bool run_code(size_t pc, struct frame *frame)
+{
+	const size_t base = the_rp;
+	struct frame *f;
+	struct value val;
+
+	add_frame_root(&frame);
+	for (;;) {
+		const struct insn *insn = &the_code[pc++];
+		switch (insn->op) {
+		case OP_NUM:
+			val.variety = VALUE_NUM;
+			val.num = insn->num;
+			push(val);
+			break;
+		case OP_STR:
+			val.variety = VALUE_STRING;
+			val.str = insn->str;
+			push(val);
+			break;
+		case OP_VAR:
+			f = frame;
+			for (unsigned up = insn->a; up; --up)
+				f = f->up;
+			assert(insn->b < f->nslots);
+			push(f->slots[insn->b]);
+			break;
+		case OP_GLOBAL:
+			if (!global(insn->a))
+				return false;
+			break;
+		case OP_CLOSURE:
+			val.variety = VALUE_CLOSURE;
+			val.closure = run_alloc(sizeof *val.closure);
+			val.closure->kind = OBJECT_CLOSURE;
+			val.closure->nparams = insn->a;
+			val.closure->start = insn->b;
+			val.closure->env = frame;
+			for (f = frame; f && !f->captured; f = f->up)
+				f->captured = true;
+			the_run_stats.closures++;
+			push(val);
+			break;
+		case OP_CALL:
+		case OP_TAILCALL:
+			if (the_bytes > the_collect_bytes)
+				collect();
+			val = the_stack[--the_sp];
+			if (val.variety == VALUE_PRIM) {
+				if (!prim_value(val.prim, insn->a))
+					return false;
+				break;
+			}
+			if (val.variety != VALUE_CLOSURE) {
+				the_fault = "application of a non-abstraction";
+				return false;
+			}
+			if (val.closure->nparams != insn->a) {
+				the_fault = "wrong number of arguments";
+				return false;
+			}
+			if ((++the_run_stats.calls & 0xFFF) == 0 &&
+			    !check_budget())
+				return false;
+			f = frame_alloc(val.closure->env, insn->a + 1);
+			f->slots[0] = val;
+			the_sp -= insn->a;
+			memcpy(f->slots + 1, the_stack + the_sp,
+			       insn->a * sizeof *the_stack);
+			if (insn->op == OP_CALL)
+				push_ret(pc, frame);
+			else
+				frame_release(frame);
+			frame = f;
+			pc = val.closure->start;
+			break;
+		case OP_PRIM:
+			if (!prim(insn->prim, insn->a))
+				return false;
+			break;
+		case OP_PRIMVAL:
+			val.variety = VALUE_PRIM;
+			val.prim = insn->prim;
+			push(val);
+			break;
+		case OP_JUMP:
+			pc = insn->a;
+			break;
+		case OP_JUMPF:
+			val = the_stack[--the_sp];
+			if (val.variety != VALUE_NUM) {
+				the_fault = "non-numeric test";
+				return false;
+			}
+			if (!val.num)
+				pc = insn->a;
+			break;
+		case OP_LET:
+			f = frame_alloc(frame, insn->a);
+			f->slots[0].variety = VALUE_UNDEFINED;
+			the_sp -= insn->a - 1;
+			memcpy(f->slots + 1, the_stack + the_sp,
+			       (insn->a - 1) * sizeof *the_stack);
+			frame = f;
+			break;
+		case OP_UNLET:
+			f = frame, frame = frame->up;
+			frame_release(f);
+			break;
+		case OP_CELL: {
+			struct cell *cell = run_alloc(sizeof *cell +
+				insn->a * sizeof cell->elts[0]);
+			cell->kind = OBJECT_CELL;
+			cell->nelts = insn->a;
+			the_sp -= insn->a;
+			memcpy(cell->elts, the_stack + the_sp,
+			       insn->a * sizeof *the_stack);
+			the_run_stats.cells++;
+			val.variety = VALUE_CELL;
+			val.cell = cell;
+			push(val);
+			break;
+		}
+		case OP_RETURN:
+			frame_release(frame);
+			if (the_rp == base)
+				return true;
+			--the_rp;
+			pc = the_rets[the_rp].pc;
+			frame = the_rets[the_rp].frame;
+			break;
+		}
+	}
+}
+
+static bool run(size_t pc, struct frame *frame)
+{
+	size_t nframe_roots = the_nframe_roots;
+	bool ok = run_code(pc, frame);
+	the_nframe_roots = nframe_roots;
+	return ok;
+}
+
+static struct term *value_term(struct value val)
+{
+	switch (val.variety) {
+	case VALUE_CELL: {
+		struct term **elts = xmalloc(val.cell->nelts * sizeof *elts);
+		for (size_t i = 0; i < val.cell->nelts; ++i)
+			elts[i] = value_term(val.cell->elts[i]);
+		return TermCell(val.cell->nelts, elts);
+	}
+	case VALUE_NUM:
+		return TermNum(val.num);
+	case VALUE_PRIM:
+		return TermPrim(val.prim);
+	case VALUE_STRING:
+		return TermString(val.str);
+	case VALUE_CLOSURE:
+		return TermFreeVar(symtab_intern("<closure>"));
+	default:
+		return TermPrim(&prim_undefined);
+	}
+}
+
+static void compile_reset(void)
+{
+	the_code_size = 0;
+	the_nglobals = 0;
+	the_compile_error = NULL;
+	the_sp = the_rp = 0;
+	the_fault = NULL;
+	memset(&the_run_stats, 0, sizeof the_run_stats);
+}
+
+bool compile_run(struct mlc_ctx *ctx, const struct form *form,
+		 const struct term *term)
+{
+	the_ctx = ctx;
+	wordtab_init(&the_global_index, 16);
+	compile_reset();
+
+	compile(term, false, 0);
+	emit(OP_RETURN, 0, 0);
+	for (size_t i = 0; i < the_nglobals && !the_compile_error; ++i) {
+		the_globals[i].start = the_code_size;
+		compile(the_globals[i].term, false, 0);
+		emit(OP_RETURN, 0, 0);
+	}
+	if (the_compile_error) {
+		fprintf(ctx->err, "Not compiled (%s); reducing instead\n",
+			the_compile_error);
+		wordtab_fini(&the_global_index);
+		compile_reset();
+		return false;
+	}
+
+	struct timeval t;
+	gettimeofday(&the_run_start, NULL);
+	the_reduce_status = REDUCE_DONE;
+	set_collect_bytes();
+	bool ok = run(0, NULL);
+	gettimeofday(&t, NULL);
+
+	struct form *value = NULL;
+	if (ok) {
+		value = readback(ctx->env, value_term(the_stack[--the_sp]));
+		fputs("value: ", ctx->out);
+		form_print(ctx->out, value);
+		putc('\n', ctx->out);
+	} else if (the_fault) {
+		/* e.g. a stuck application, which reduction leaves be */
+		fflush(ctx->out);
+		fprintf(ctx->err, "Not evaluated (%s); reducing instead\n",
+			the_fault);
+		run_free_all();
+		wordtab_fini(&the_global_index);
+		compile_reset();
+		return false;
+	} else {
+		fflush(ctx->out);
+		fprintf(ctx->err, "Reduction aborted: %s\n",
+			reduce_status_message(the_reduce_status));
+	}
+
+	long elapsed = (t.tv_sec - the_run_start.tv_sec) * 1000000 +
+		       (t.tv_usec - the_run_start.tv_usec);
+	if (!ctx->options.quiet) {
+		fprintf(ctx->out, "dt: %.6fs\n", elapsed / 1000000.0);
+		fprintf(ctx->out, "code: insns %zu globals %zu\n",
+			the_code_size, the_nglobals);
+		fprintf(ctx->out, "stats: calls %lu prims %lu frames %lu "
+			"closures %lu cells %lu bytes %zu collections %lu\n",
+			the_run_stats.calls, the_run_stats.prims,
+			the_run_stats.frames, the_run_stats.closures,
+			the_run_stats.cells, the_bytes,
+			the_run_stats.collections);
+	}
+	struct mlc_stats stats = {
+		.seconds = elapsed / 1000000.0,
+		.steps = the_run_stats.calls,
+		.betas = the_run_stats.calls,
+		.prims = the_run_stats.prims,
+		.allocs = the_run_stats.frames + the_run_stats.closures +
+			  the_run_stats.cells,
+	};
+	ctx_note_reduction(ctx, form, value, the_reduce_status, &stats);
+	run_free_all();
+	wordtab_fini(&the_global_index);
+	compile_reset();
+	return true;
+}
@@ -0,0 +1,51 @@
+#ifndef LARK_MLC_COMPILE_H
+#define LARK_MLC_COMPILE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Compiled execution.  When enabled, reductions are not performed by
+ * the graph reducer; instead each closed term is compiled to code for
+ * a closure machine and evaluated under weak call-by-value, so bodies
+ * of abstractions aren't reduced and arguments are evaluated before
+ * application.  Numbers, strings, and cells built from them print as
+ * they would after reduction; abstractions print as <closure>.
+ * Run-time data is garbage collected, so --max-heap bounds the data a
+ * compiled run keeps live rather than all it has allocated.
+ *
+ * compile_run() prints the statement's value to the context's output,
+ * notes the reduction of form and returns true, or returns false
+ * (noting why on the context's error sink) if the term uses features
+ * the compiler doesn't support, in which case the caller should reduce
+ * the term instead.  Compilation is selected by the context's options.
+ */
+
+#include <stdbool.h>
+
+struct form;
+struct mlc_ctx;
+struct term;
+
+extern bool compile_run(struct mlc_ctx *ctx, const struct form *form,
+			const struct term *term);
+
+#endif /* LARK_MLC_COMPILE_H */
@@ -0,0 +1,57 @@
+#ifndef LARK_MLC_CTX_H
+#define LARK_MLC_CTX_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The state of a libmlc context (see libmlc.h).  A context is passed
+ * from the parser to each statement and on to the passes which consult
+ * it, so every setting, the environment, and the output sinks belong to
+ * the context rather than to the process.  The symbol table, the node
+ * heap, and instrumentation (profiling, tracing, evaluation statistics,
+ * and --perf) are still process-wide.
+ */
+
+#include <stdio.h>
+
+#include "libmlc.h"
+#include "reduce.h"
+
+struct env;
+struct form;
+struct recorder;
+
+struct mlc_ctx {
+	struct env *env;
+	struct mlc_options options;
+	struct reduce_budget budget;	/* from the options */
+	FILE *out, *err;		/* the options' sinks, or a capture */
+	struct recorder *recorder;	/* includes being compiled (cache.c) */
+	struct mlc_result *result;	/* if non-NULL, notes reductions */
+};
+
+extern void ctx_note_reduction(struct mlc_ctx *ctx, const struct form *form,
+			       const struct form *norm,
+			       enum reduce_status status,
+			       const struct mlc_stats *stats);
+
+#endif /* LARK_MLC_CTX_H */
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "elim.h"
+#include "env.h"
+#include "term.h"
+
+/*
+ * Values shared from the environment of the current call to elim()
+ * are closed and were eliminated when defined, so we never walk them.
+ */
+static struct env *elim_env;
+
+static bool is_shared(const struct term *term)
+{
+	return env_lookup_val(elim_env, term);
+}
+
+/*
+ * Count references to each of the 'nbinders' variables bound by the
+ * binder 'up' levels above 'term'.
+ */
+static void count_uses(const struct term *term, int up,
+		       size_t nbinders, unsigned *uses)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			count_uses(term->abs.bodies[i], up + 1,
+				   nbinders, uses);
+		break;
+	case TERM_APP:
+		count_uses(term->app.fun, up, nbinders, uses);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			if (!is_shared(term->app.args[i]))
+				count_uses(term->app.args[i], up,
+					   nbinders, uses);
+		break;
+	case TERM_BOUND_VAR:
+		if (term->bv.up == up) {
+			assert(term->bv.across < nbinders);
+			uses[term->bv.across]++;
+		}
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			count_uses(term->cell.elts[i], up, nbinders, uses);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			count_uses(term->let.vals[i], up, nbinders, uses);
+		count_uses(term->let.body, up + 1, nbinders, uses);
+		break;
+	case TERM_TEST:
+		count_uses(term->test.pred, up, nbinders, uses);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			count_uses(term->test.csqs[i], up, nbinders, uses);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			count_uses(term->test.alts[i], up, nbinders, uses);
+		break;
+	default:
+		/* nada */;
+	}
+}
+
+/*
+ * Rewrite references to the binder 'up' levels above 'term', either
+ * renumbering them with 'remap' (when 'remap' is non-NULL) or, when the
+ * binder has been removed, decrementing 'up' for references to it and
+ * all binders outside it.  References to binders within 'term' are
+ * left alone, as are shared values from the environment.
+ */
+static void rebind(struct term *term, int up, const unsigned *remap)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			rebind(term->abs.bodies[i], up + 1, remap);
+		break;
+	case TERM_APP:
+		rebind(term->app.fun, up, remap);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			if (!is_shared(term->app.args[i]))
+				rebind(term->app.args[i], up, remap);
+		break;
+	case TERM_BOUND_VAR:
+		if (remap && term->bv.up == up)
+			term->bv.across = remap[term->bv.across];
+		else if (!remap && term->bv.up >= up) {
+			assert(term->bv.up > up);
+			term->bv.up--;
+		}
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			rebind(term->cell.elts[i], up, remap);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			rebind(term->let.vals[i], up, remap);
+		rebind(term->let.body, up + 1, remap);
+		break;
+	case TERM_TEST:
+		rebind(term->test.pred, up, remap);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			rebind(term->test.csqs[i], up, remap);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			rebind(term->test.alts[i], up, remap);
+		break;
+	default:
+		/* nada */;
+	}
+}
+
+/*
+ * Remove unused bindings from parallel arrays of names and values,
+ * where binding 0 is the binder's self-reference (or placeholder) and
+ * has no value.  Returns the number of bindings remaining.
+ */
+static size_t elim_bindings(struct term *body, size_t nbinders,
+			    symbol_mt *names, struct term **vals)
+{
+	unsigned *uses = xmalloc(sizeof *uses * nbinders),
+		 *remap = xmalloc(sizeof *remap * nbinders);
+	for (size_t i = 0; i < nbinders; ++i)
+		uses[i] = 0;
+	count_uses(body, 0, nbinders, uses);
+
+	size_t j = 1;
+	remap[0] = 0;
+	for (size_t i = 1; i < nbinders; ++i) {
+		if (!uses[i])
+			continue;
+		remap[i] = j;
+		names[j] = names[i];
+		vals[j-1] = vals[i-1];
+		++j;
+	}
+	if (j < nbinders)
+		rebind(body, 0, remap);
+
+	xfree(remap);
+	xfree(uses);
+	return j;
+}
+
+static struct term *elim_let(struct term *term)
+{
+	/* let values are offset by one so binding 0 has no value */
+	term->let.ndefs = elim_bindings(term->let.body, term->let.ndefs,
+					term->let.vars, term->let.vals + 1);
+	if (term->let.ndefs > 1)
+		return term;
+	rebind(term->let.body, 0, NULL);
+	return term->let.body;
+}
+
+static struct term *elim_redex(struct term *term)
+{
+	/*
+	 * A recursive abstraction passes its own arguments again when it
+	 * calls itself, possibly through aliases we can't see, so we only
+	 * remove formals of non-recursive ones.
+	 */
+	struct term *abs = term->app.fun;
+	if (abs->variety != TERM_ABS)
+		return term;
+	if (abs->abs.nbodies != 1 || abs->abs.nformals != term->app.nargs + 1)
+		return term;
+
+	size_t nformals = elim_bindings(abs->abs.bodies[0],
+					abs->abs.nformals, abs->abs.formals,
+					term->app.args);
+	if (nformals > 1) {
+		abs->abs.nformals = nformals;
+		term->app.nargs = nformals - 1;
+		return term;
+	}
+	rebind(abs->abs.bodies[0], 0, NULL);
+	return abs->abs.bodies[0];
+}
+
+static struct term *elim_term(struct term *term);
+
+static void elim_all(size_t n, struct term **terms)
+{
+	for (size_t i = 0; i < n; ++i)
+		terms[i] = elim_term(terms[i]);
+}
+
+static struct term *elim_term(struct term *term)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		elim_all(term->abs.nbodies, term->abs.bodies);
+		return term;
+	case TERM_APP:
+		term->app.fun = elim_term(term->app.fun);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			if (!is_shared(term->app.args[i]))
+				term->app.args[i] =
+					elim_term(term->app.args[i]);
+		return elim_redex(term);
+	case TERM_CELL:
+		elim_all(term->cell.nelts, term->cell.elts);
+		return term;
+	case TERM_LET:
+		elim_all(term->let.ndefs, term->let.vals);
+		term->let.body = elim_term(term->let.body);
+		return elim_let(term);
+	case TERM_TEST:
+		term->test.pred = elim_term(term->test.pred);
+		elim_all(term->test.ncsqs, term->test.csqs);
+		elim_all(term->test.nalts, term->test.alts);
+		return term;
+	case TERM_BOUND_VAR:
+	case TERM_FREE_VAR:
+	case TERM_NUM:
+	case TERM_PRIM:
+	case TERM_PRUNED:
+	case TERM_STRING:
+		return term;
+	default:
+		panicf("Unhandled term variety %d\n", term->variety);
+	}
+}
+
+struct term *elim(struct env *env, struct term *term)
+{
+	elim_env = env;
+	return elim_term(term);
+}
@@ -0,0 +1,42 @@
+#ifndef LARK_MLC_ELIM_H
+#define LARK_MLC_ELIM_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Dead-binding elimination on resolved terms, before flattening.  Let
+ * bindings which the let body never references are removed, as are
+ * arguments of direct redexes (applications of literal, non-recursive
+ * abstractions) whose formal parameters are never referenced; when no
+ * bindings remain, the binder itself is removed.  This saves
+ * allocating, flattening, and possibly evaluating values which the
+ * reducer would only discard.  Like fold(), this works in place,
+ * leaves values shared from the environment 'env' alone, and returns
+ * the (possibly new) root term.
+ */
+
+struct env;
+struct term;
+
+extern struct term *elim(struct env *env, struct term *term);
+
+#endif /* LARK_MLC_ELIM_H */
@@ -36,8 +36,11 @@
 
 symbol_mt the_placeholder_symbol;
 
-static struct wordtab the_global_env;
-static unsigned the_last_index;
+struct env {
+	struct wordtab table;
+	struct wordtab vals;	/* defined values to entries */
+	unsigned last_index;
+};
 
 int env_entry_cmp(const void *a, const void *b)
 {
@@ -47,22 +50,37 @@ int env_entry_cmp(const void *a, const void *b)
 		(ea->index < eb->index) ? -1 : 0;
 }
 
-void env_init(void)
+struct env *env_create(void)
 {
-	wordtab_init(&the_global_env, ENV_SIZE_HINT);
+	struct env *env = xmalloc(sizeof *env);
+	wordtab_init(&env->table, ENV_SIZE_HINT);
+	wordtab_init(&env->vals, ENV_SIZE_HINT);
+	env->last_index = 0;
+	return env;
+}
+
+/*
+ * Terms are never freed once resolved, so we only free the entries.
+ */
+void env_destroy(struct env *env)
+{
+	wordtab_free_all_data(&env->table);
+	wordtab_fini(&env->table);
+	wordtab_fini(&env->vals);
+	xfree(env);
 }
 
 /*
  * Environment dumping.  Sort the environment by entry index before
  * dumping since we maintain it in a hash table.
  */
-void env_dump(const char *substr)
+void env_dump(struct env *env, FILE *out, const char *substr)
 {
 	struct wordbuf defs;
 	wordbuf_init(&defs);
 
 	struct wordtab_iter iter;
-	wordtab_iter_init(&the_global_env, &iter);
+	wordtab_iter_init(&env->table, &iter);
 	struct wordtab_entry *entry;
 	while ((entry = wordtab_iter_next(&iter))) {
 		const struct env_entry *ee = entry->data;
@@ -78,49 +96,59 @@ void env_dump(const char *substr)
 			(const struct env_entry *) wordbuf_at(&defs, i);
 		assert(ee->var->variety == TERM_FREE_VAR);
 		assert(ee->name == ee->var->fv.name);
-		printf("#%u\t%s", ee->index, symtab_lookup(ee->name));
+		fprintf(out, "#%u\t%s", ee->index, symtab_lookup(ee->name));
 		if (ee->val) {
-			fputs(" := ", stdout);
-			term_print(ee->val);
+			fputs(" := ", out);
+			term_print(out, ee->val);
 		}
-		putchar('\n');
+		fputc('\n', out);
 	}
 
 	wordbuf_fini(&defs);
 }
 
-static inline struct env_entry *env_get(symbol_mt name)
+static inline struct env_entry *env_get(struct env *env, symbol_mt name)
 {
-	return wordtab_get(&the_global_env, name);
+	return wordtab_get(&env->table, name);
 }
 
-static struct env_entry *env_put(symbol_mt name, struct term *val)
+static struct env_entry *env_put(struct env *env, symbol_mt name,
+				 struct term *val)
 {
 	struct env_entry *pe = xmalloc(sizeof *pe);
 	pe->name = name;
-	pe->index = ++the_last_index;
+	pe->index = ++env->last_index;
 	pe->var = TermFreeVar(name);
 	pe->val = val;
-	wordtab_put(&the_global_env, name, pe);
+	wordtab_put(&env->table, name, pe);
+	if (val)
+		wordtab_put(&env->vals, (word) val, pe);
 	return pe;
 }
 
-struct env_entry env_declare(symbol_mt name)
+struct env_entry env_declare(struct env *env, symbol_mt name)
 {
-	struct env_entry *pe = env_get(name);
-	return pe ? *pe : *env_put(name, NULL);
+	struct env_entry *pe = env_get(env, name);
+	return pe ? *pe : *env_put(env, name, NULL);
 }
 
-struct env_entry env_define(symbol_mt name, struct term *val)
+struct env_entry env_define(struct env *env, symbol_mt name,
+			    struct term *val)
 {
 	/* fail if name already present in environment */
-	if (env_get(name))
+	if (env_get(env, name))
 		return (struct env_entry) { .name = name, .index = 0,
 					    .var = NULL, .val = NULL };
-	return *env_put(name, val);
+	return *env_put(env, name, val);
+}
+
+const struct env_entry *env_lookup_val(struct env *env,
+				       const struct term *val)
+{
+	return wordtab_get(&env->vals, (word) val);
 }
 
-bool env_test(symbol_mt name)
+bool env_test(struct env *env, symbol_mt name)
 {
-	return !!env_get(name);
+	return !!env_get(env, name);
 }
@@ -43,6 +43,7 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #include <util/symtab.h>
 
@@ -57,10 +58,19 @@ struct env_entry {
 };
 extern int env_entry_cmp(const void *a, const void *b);	/* for qsort */
 
-extern void env_init(void);
-extern void env_dump(const char *substr);
-extern struct env_entry env_declare(symbol_mt name);
-extern struct env_entry env_define(symbol_mt name, struct term *val);
-extern bool env_test(symbol_mt name);
+/*
+ * Each libmlc context (see ctx.h) has its own environment, so every
+ * operation names the environment it applies to.
+ */
+struct env;
+extern struct env *env_create(void);
+extern void env_destroy(struct env *env);
+extern void env_dump(struct env *env, FILE *out, const char *substr);
+extern struct env_entry env_declare(struct env *env, symbol_mt name);
+extern struct env_entry env_define(struct env *env, symbol_mt name,
+				   struct term *val);
+extern bool env_test(struct env *env, symbol_mt name);
+extern const struct env_entry *env_lookup_val(struct env *env,
+					      const struct term *val);
 
 #endif /* LARK_MLC_ENV_H */
@@ -25,6 +25,7 @@
 
 #include <util/message.h>
 
+#include "church.h"
 #include "flatten.h"
 #include "node.h"
 #include "term.h"
@@ -128,6 +129,8 @@ flatten_term(struct term *term, struct node *prev, unsigned depth)
 			NodeAbs(prev, depth,
 				flatten_chain(term->abs.bodies[0], depth + 1),
 				term->abs.nformals, term->abs.formals);
+		/* only definitions noted under --church are marked */
+		retval.next->church = church_combinator(term);
 		break;
 	case TERM_APP: {
 		/*
@@ -290,6 +293,7 @@ flatten_term(struct term *term, struct node *prev, unsigned depth)
 	default:
 		panicf("Unhandled term variety %d\n", term->variety);
 	}
+	retval.next->origin = term->origin;
 	return retval;
 }
 
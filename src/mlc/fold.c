@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+
+#include <util/message.h>
+
+#include "env.h"
+#include "fold.h"
+#include "prim.h"
+#include "term.h"
+
+static struct env *fold_env;	/* of the current call to fold() */
+
+static struct term *fold_term(struct term *term);
+
+static struct term *fold_app(struct term *term)
+{
+	struct term *fun = term->app.fun;
+	if (fun->variety != TERM_PRIM || !fun->prim->fold)
+		return term;
+	struct term *val = fun->prim->fold(fun->prim->variety,
+					   term->app.nargs, term->app.args);
+	if (!val)
+		return term;
+	val->origin = term->origin;
+	return val;
+}
+
+static struct term *fold_test(struct term *term)
+{
+	struct term *pred = term->test.pred;
+	if (pred->variety != TERM_NUM)
+		return term;
+	assert(term->test.ncsqs == 1);
+	assert(term->test.nalts == 1);
+	return pred->num ? term->test.csqs[0] : term->test.alts[0];
+}
+
+static void fold_all(size_t n, struct term **terms)
+{
+	for (size_t i = 0; i < n; ++i)
+		terms[i] = fold_term(terms[i]);
+}
+
+static struct term *fold_term(struct term *term)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		fold_all(term->abs.nbodies, term->abs.bodies);
+		return term;
+	case TERM_APP:
+		term->app.fun = fold_term(term->app.fun);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			/* shared definitions were folded when defined */
+			if (!env_lookup_val(fold_env, term->app.args[i]))
+				term->app.args[i] =
+					fold_term(term->app.args[i]);
+		return fold_app(term);
+	case TERM_CELL:
+		fold_all(term->cell.nelts, term->cell.elts);
+		return term;
+	case TERM_LET:
+		fold_all(term->let.ndefs, term->let.vals);
+		term->let.body = fold_term(term->let.body);
+		return term;
+	case TERM_TEST:
+		term->test.pred = fold_term(term->test.pred);
+		fold_all(term->test.ncsqs, term->test.csqs);
+		fold_all(term->test.nalts, term->test.alts);
+		return fold_test(term);
+	case TERM_BOUND_VAR:
+	case TERM_FREE_VAR:
+	case TERM_NUM:
+	case TERM_PRIM:
+	case TERM_PRUNED:
+	case TERM_STRING:
+		return term;
+	default:
+		panicf("Unhandled term variety %d\n", term->variety);
+	}
+}
+
+struct term *fold(struct env *env, struct term *term)
+{
+	fold_env = env;
+	return fold_term(term);
+}
@@ -0,0 +1,40 @@
+#ifndef LARK_MLC_FOLD_H
+#define LARK_MLC_FOLD_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Constant folding on resolved terms, before flattening: applications
+ * of primitives to literal numbers and strings are replaced by their
+ * results, and tests with literal predicates by the chosen branch.
+ * Neither rewrite removes a binder, so bound-variable indices are
+ * unaffected.  Folding works in place; the (possibly new) root term is
+ * returned.  Values shared from the environment 'env' were folded when
+ * they were defined, so they are left alone.
+ */
+
+struct env;
+struct term;
+
+extern struct term *fold(struct env *env, struct term *term);
+
+#endif /* LARK_MLC_FOLD_H */
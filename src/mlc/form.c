@@ -221,15 +221,15 @@ void form_free(struct form *form)
 /*
  * Use a pointer-reversing traversal, printing on the way back.
  */
-void form_print_lr(struct form *form, const char *sep)
+void form_print_lr(FILE *out, struct form *form, const char *sep)
 {
 	struct form *rev, *tmp;
 	for (rev = NULL; form;
 	     tmp = form->prev, form->prev = rev, rev = form, form = tmp);
 	for (bool first = true; rev; first = false,
 	     tmp = rev->prev, rev->prev = form, form = rev, rev = tmp) {
-		if (!first) fputs(sep, stdout);
-		form_print(rev);
+		if (!first) fputs(sep, out);
+		form_print(out, rev);
 	}
 	assert(rev == NULL);
 }
@@ -239,33 +239,34 @@ void form_print_lr(struct form *form, const char *sep)
  * 1 (or is 0, in which case we print empty parens), or if 'next' is
  * true which indicates we need to nest the current form in parens.
  */
-static void form_print_args(struct form *args, bool nest)
+static void form_print_args(FILE *out, struct form *args, bool nest)
 {
 	if (!args) {
-		fputs("()", stdout);
+		fputs("()", out);
 		return;
 	}
 	bool wrap = nest || !!args->prev;
-	if (wrap) putchar('(');
-	form_print_lr(args, ", ");
-	if (wrap) putchar(')');
+	if (wrap) fputc('(', out);
+	form_print_lr(out, args, ", ");
+	if (wrap) fputc(')', out);
 }
 
 /*
  * 'spine': Are we on the application spine?
  * 'nest': Should we nest an application in parens?
  */
-static void form_print_helper(const struct form *form, bool spine, bool nest)
+static void form_print_helper(FILE *out, const struct form *form, bool spine,
+			      bool nest)
 {
 	switch (form->variety) {
 	case FORM_ABS:
 		assert(form->abs.self == NULL);
-		putchar('[');
-		form_print_lr(form->abs.params, ", ");
-		putchar('.');
-		putchar(' ');
-		form_print_lr(form->abs.bodies, ", ");
-		putchar(']');
+		fputc('[', out);
+		form_print_lr(out, form->abs.params, ", ");
+		fputc('.', out);
+		fputc(' ', out);
+		form_print_lr(out, form->abs.bodies, ", ");
+		fputc(']', out);
 		break;
 	case FORM_APP:
 		/*
@@ -318,91 +319,91 @@ static void form_print_helper(const struct form *form, bool spine, bool nest)
 		 * is low.
 		 */
 	app_print_prefix:
-		form_print_helper(form->app.fun, true, true);
-		putchar(' ');
-		form_print_args(form->app.args, true);
+		form_print_helper(out, form->app.fun, true, true);
+		fputc(' ', out);
+		form_print_args(out, form->app.args, true);
 		break;
 	app_print_postfix_abs:
-		form_print_args(form->app.args, false);
-		putchar(' ');
-		form_print_helper(form->app.fun, true, true);
+		form_print_args(out, form->app.args, false);
+		fputc(' ', out);
+		form_print_helper(out, form->app.fun, true, true);
 		break;
 	app_print_postfix:
-		if (nest) putchar('(');
-		form_print_args(form->app.args, false);
-		putchar(';');
-		putchar(' ');
-		form_print_helper(form->app.fun, false, false);
-		if (nest) putchar(')');
+		if (nest) fputc('(', out);
+		form_print_args(out, form->app.args, false);
+		fputc(';', out);
+		fputc(' ', out);
+		form_print_helper(out, form->app.fun, false, false);
+		if (nest) fputc(')', out);
 		break;
 	case FORM_CELL:
-		putchar('[');
-		form_print_lr(form->cell.elts, " | ");
-		putchar(']');
+		fputc('[', out);
+		form_print_lr(out, form->cell.elts, " | ");
+		fputc(']', out);
 		break;
 	case FORM_DEF:
-		form_print(form->def.var);
-		fputs(" := ", stdout);
-		form_print(form->def.val);
+		form_print(out, form->def.var);
+		fputs(" := ", out);
+		form_print(out, form->def.val);
 		break;
 	case FORM_FIX:
-		putchar('[');
-		form_print(form->abs.self);
-		putchar('!');
-		putchar(' ');
-		form_print_lr(form->abs.params, ", ");
-		putchar('.');
-		putchar(' ');
-		form_print_lr(form->abs.bodies, ", ");
-		putchar(']');
+		fputc('[', out);
+		form_print(out, form->abs.self);
+		fputc('!', out);
+		fputc(' ', out);
+		form_print_lr(out, form->abs.params, ", ");
+		fputc('.', out);
+		fputc(' ', out);
+		form_print_lr(out, form->abs.bodies, ", ");
+		fputc(']', out);
 		break;
 	case FORM_LET:
-		fputs("let {", stdout);
-		form_print_lr(form->let.defs, ". ");
-		fputs("} ", stdout);
-		form_print(form->let.body);
+		fputs("let {", out);
+		form_print_lr(out, form->let.defs, ". ");
+		fputs("} ", out);
+		form_print(out, form->let.body);
 		break;
 	case FORM_NUM:
-		num_print(form->num);
+		num_print(out, form->num);
 		break;
 	case FORM_OP1:
-		printf("%s ", form->op1.prim->name);
-		form_print_helper(form->op1.arg, false, false);
+		fprintf(out, "%s ", form->op1.prim->name);
+		form_print_helper(out, form->op1.arg, false, false);
 		break;
 	case FORM_OP2:
-		form_print_helper(form->op2.lhs, false, false);
-		printf(" %s ", form->op2.prim->name);
-		form_print_helper(form->op2.rhs, false, false);
+		form_print_helper(out, form->op2.lhs, false, false);
+		fprintf(out, " %s ", form->op2.prim->name);
+		form_print_helper(out, form->op2.rhs, false, false);
 		break;
 	case FORM_PRIM:
-		fputs(form->prim->name, stdout);
+		fputs(form->prim->name, out);
 		break;
 	case FORM_SECTION:
-		printf("section #%s.\n", form->huid);
+		fprintf(out, "section #%s.\n", form->huid);
 		break;
 	case FORM_STRING:
-		printf("\"%s\"", form->str);
+		fprintf(out, "\"%s\"", form->str);
 		break;
 	case FORM_TEST:
-		putchar('[');
-		form_print(form->test.pred);
-		fputs("? ", stdout);
-		form_print_lr(form->test.csq, ", ");
-		fputs(" | ", stdout);
-		form_print_lr(form->test.alt, ", ");
-		putchar(']');
+		fputc('[', out);
+		form_print(out, form->test.pred);
+		fputs("? ", out);
+		form_print_lr(out, form->test.csq, ", ");
+		fputs(" | ", out);
+		form_print_lr(out, form->test.alt, ", ");
+		fputc(']', out);
 		break;
 	case FORM_VAR:
-		fputs(symtab_lookup(form->var.name), stdout);
+		fputs(symtab_lookup(form->var.name), out);
 		break;
 	default:
 		panicf("Unhandled form variety %d\n", form->variety);
 	}
 }
 
-void form_print(const struct form *form)
+void form_print(FILE *out, const struct form *form)
 {
-	form_print_helper(form, true, false);
+	form_print_helper(out, form, true, false);
 }
 
 struct form *form_splice(struct form *a, struct form *b)
@@ -29,6 +29,8 @@
  * by the parser.
  */
 
+#include <stdio.h>
+
 #include <util/symtab.h>
 
 enum form_variety {
@@ -109,7 +111,7 @@ static inline struct form *FormVarS(const char *name)
 extern void form_free(struct form *form);
 static inline size_t form_length(const struct form *form)
 	{ size_t n; for (n = 0; form; ++n, form = form->prev); return n; }
-extern void form_print(const struct form *form);
+extern void form_print(FILE *out, const struct form *form);
 extern struct form *form_splice(struct form *a, struct form *b);
 
 #endif /* LARK_MLC_FORM_H */
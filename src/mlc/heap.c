@@ -23,7 +23,9 @@
 #include <assert.h>
 #include <stdio.h>
 
-#include <util/memutil.h>
+#include <engine/pool.h>
+#include <engine/pressure.h>
+#include <engine/stats.h>
 #include <util/message.h>
 
 #include "heap.h"
@@ -32,48 +34,51 @@
 /*
  * Nodes in MLC are variable-sized and we have reference-counted
  * garbage collection, so rather than a GC'd heap or preallocated
- * array, I'm going to make libc malloc/free work for a living.
+ * array we allocate each node from the engine's size-class pool.
  */
 #define MAX_NODES 1000000
 
 struct heap_stats {
-	unsigned long node_allocs, node_frees, nodes_in_use;
+	unsigned long node_allocs, node_frees, nodes_in_use, nodes_peak;
+	unsigned long collections;
+	size_t bytes_in_use;
 };
 
-#define MAX_HEAP_PRESSURE 0.9
-#define MIN_HEAP_THRESHOLD 0.4
-
-float the_heap_pressure, the_heap_threshold = 0.6;
+struct heap_pressure the_heap_pressure = HEAP_PRESSURE_INIT;
 
 static struct heap_stats the_heap_stats;
 
+static const struct stat_desc the_heap_stat_descs [] = {
+	{ "allocs",	STAT_ULONG,	&the_heap_stats.node_allocs },
+	{ "frees",	STAT_ULONG,	&the_heap_stats.node_frees },
+	{ "in_use",	STAT_ULONG,	&the_heap_stats.nodes_in_use },
+	{ "peak",	STAT_ULONG,	&the_heap_stats.nodes_peak },
+	{ "bytes",	STAT_SIZE,	&the_heap_stats.bytes_in_use },
+	{ "pressure",	STAT_FLOAT,	&the_heap_pressure.level },
+	{ "threshold",	STAT_FLOAT,	&the_heap_pressure.threshold },
+	{ "gcs",	STAT_ULONG,	&the_heap_stats.collections },
+};
+
 static inline void update_heap_pressure(void)
 {
-	the_heap_pressure = (float) the_heap_stats.nodes_in_use /
-			    (float) MAX_NODES;
-	if (the_heap_pressure > MAX_HEAP_PRESSURE)
-		the_heap_pressure = MAX_HEAP_PRESSURE;
+	heap_pressure_update(&the_heap_pressure,
+			     the_heap_stats.nodes_in_use, MAX_NODES);
 }
 
 void node_heap_init(void)
 {
 	update_heap_pressure();
+	STATS_REGISTER("heap", the_heap_stat_descs);
 }
 
+/*
+ * Called once after each garbage collection, so it also counts them.
+ */
 void node_heap_calibrate(void)
 {
+	the_heap_stats.collections++;
 	update_heap_pressure();
-	assert(the_heap_pressure >= 0.0);
-	assert(the_heap_pressure <  1.0);
-	assert(the_heap_threshold >= MIN_HEAP_THRESHOLD);
-	assert(the_heap_threshold <  1.0);
-	if (the_heap_pressure > the_heap_threshold * 0.666)
-		the_heap_threshold += (1.0 - the_heap_threshold) / 2.0;
-	else if (the_heap_pressure < the_heap_threshold * 0.333) {
-		the_heap_threshold *= 0.666;
-		if (the_heap_threshold < MIN_HEAP_THRESHOLD)
-			the_heap_threshold = MIN_HEAP_THRESHOLD;
-	}
+	heap_pressure_calibrate(&the_heap_pressure);
 }
 
 struct node *node_heap_alloc(size_t nslots)
@@ -81,21 +86,50 @@ struct node *node_heap_alloc(size_t nslots)
 	if (the_heap_stats.nodes_in_use >= MAX_NODES)
 		panic("Node heap exhausted!\n");
 	the_heap_stats.node_allocs++;
-	the_heap_stats.nodes_in_use++;
+	if (++the_heap_stats.nodes_in_use > the_heap_stats.nodes_peak)
+		the_heap_stats.nodes_peak = the_heap_stats.nodes_in_use;
 	update_heap_pressure();
-#ifdef SLOT_COUNTS_SORTED
-	struct node *node = xmalloc(sizeof *node +
-				    nslots * sizeof node->slots[0]);
-#else
-	struct node *node = xmalloc(sizeof *node +
-				    (nslots < 2 ? 2 : nslots) *
-				    sizeof node->slots[0]);
-#endif
+	struct node *node = pool_alloc(node_heap_bytes(nslots));
+	the_heap_stats.bytes_in_use += pool_block_size(node);
 	node->nslots = nslots;
 	node->prev = NULL;	/* for safety */
 	return node;
 }
 
+size_t node_heap_bytes(size_t nslots)
+{
+#ifdef SLOT_COUNTS_SORTED
+	return sizeof (struct node) + nslots * sizeof (struct slot);
+#else
+	return sizeof (struct node) +
+	       (nslots < 2 ? 2 : nslots) * sizeof (struct slot);
+#endif
+}
+
+size_t node_heap_in_use(void)
+{
+	return the_heap_stats.nodes_in_use;
+}
+
+/*
+ * Primitives can shrink nodes in place, so we account for bytes using
+ * the pool's notion of block size rather than slot counts.
+ */
+size_t node_heap_bytes_in_use(void)
+{
+	return the_heap_stats.bytes_in_use;
+}
+
+unsigned long node_heap_allocs(void)
+{
+	return the_heap_stats.node_allocs;
+}
+
+unsigned long node_heap_peak(void)
+{
+	return the_heap_stats.nodes_peak;
+}
+
 void node_heap_free(struct node *node)
 {
 	if (the_heap_stats.nodes_in_use == 0)
@@ -104,23 +138,26 @@ void node_heap_free(struct node *node)
 	the_heap_stats.nodes_in_use--;
 	update_heap_pressure();
 	assert(node);
-	xfree(node);
+	the_heap_stats.bytes_in_use -= pool_block_size(node);
+	pool_free(node);
 }
 
-void print_heap_stats(void)
+void print_heap_stats(FILE *out)
 {
-	fprintf(stderr,
+	fprintf(out,
 	"\t\t\tHEAP STATISTICS\n"
 	"\t\t\t===============\n"
-	"Nodes:\t%12s %-10lu %12s %-10lu\n"
+	"Nodes:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
 	      "\t%12s %-10lu %12s %-10lu\n"
-	"Usage:\t%12s %-10g %12s %-10g\n",
+	"Usage:\t%12s %-10g %12s %-10g %12s %-10lu\n",
 	"total",	(unsigned long) MAX_NODES,
 	"in_use",	the_heap_stats.nodes_in_use,
+	"peak",		the_heap_stats.nodes_peak,
 	"allocs",	the_heap_stats.node_allocs,
 	"frees",	the_heap_stats.node_frees,
-	"pressure",	the_heap_pressure,
-	"threshold",	the_heap_threshold);
+	"pressure",	the_heap_pressure.level,
+	"threshold",	the_heap_pressure.threshold,
+	"gcs",		the_heap_stats.collections);
 }
 
 void reset_heap_stats(void)
@@ -129,4 +166,6 @@ void reset_heap_stats(void)
 	assert(the_heap_stats.node_allocs >= the_heap_stats.node_frees);
 	the_heap_stats.node_allocs -= the_heap_stats.node_frees;
 	the_heap_stats.node_frees = 0;
+	the_heap_stats.nodes_peak = the_heap_stats.nodes_in_use;
+	the_heap_stats.collections = 0;
 }
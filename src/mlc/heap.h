@@ -23,16 +23,24 @@
  */
 
 #include <stddef.h>
+#include <stdio.h>
 
-extern float the_heap_pressure, the_heap_threshold;
+#include <engine/pressure.h>
+
+extern struct heap_pressure the_heap_pressure;
 
 struct node;
 
 void node_heap_init(void);
 void node_heap_calibrate(void);		/* set threshold after gc */
 struct node *node_heap_alloc(size_t nslots);
+size_t node_heap_bytes(size_t nslots);
+size_t node_heap_in_use(void);
+size_t node_heap_bytes_in_use(void);
+unsigned long node_heap_allocs(void);
+unsigned long node_heap_peak(void);	/* in use, since last reset */
 void node_heap_free(struct node *node);
-void print_heap_stats(void);
+void print_heap_stats(FILE *out);
 void reset_heap_stats(void);
 
 #endif /* LARK_MLC_HEAP_H */
@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "env.h"
+#include "inline.h"
+#include "term.h"
+
+/*
+ * Inlining can duplicate redexes (e.g. a small self-applying value
+ * applied to itself), so we bound the number of beta-reductions per
+ * call to inline_term().  The environment and size limit are also
+ * those of the current call.
+ */
+#define INLINE_FUEL 1000
+static unsigned inline_fuel;
+static struct env *inline_env;
+static size_t inline_size;
+
+static size_t term_size(const struct term *term, size_t limit)
+{
+	size_t size = 1;
+
+#define ADD_SIZE(t) do {					\
+	if ((size += term_size((t), limit - size)) > limit)	\
+		return size;					\
+} while (0)
+
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			ADD_SIZE(term->abs.bodies[i]);
+		break;
+	case TERM_APP:
+		ADD_SIZE(term->app.fun);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			ADD_SIZE(term->app.args[i]);
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			ADD_SIZE(term->cell.elts[i]);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			ADD_SIZE(term->let.vals[i]);
+		ADD_SIZE(term->let.body);
+		break;
+	case TERM_TEST:
+		ADD_SIZE(term->test.pred);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			ADD_SIZE(term->test.csqs[i]);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			ADD_SIZE(term->test.alts[i]);
+		break;
+	default:
+		/* nada */;
+	}
+	return size;
+
+#undef ADD_SIZE
+}
+
+/*
+ * Whether 'term' has no references to binders 'up' or more levels
+ * above it.
+ */
+static bool is_closed(const struct term *term, int up)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			if (!is_closed(term->abs.bodies[i], up + 1))
+				return false;
+		return true;
+	case TERM_APP:
+		if (!is_closed(term->app.fun, up))
+			return false;
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			if (!is_closed(term->app.args[i], up))
+				return false;
+		return true;
+	case TERM_BOUND_VAR:
+		return term->bv.up < up;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			if (!is_closed(term->cell.elts[i], up))
+				return false;
+		return true;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			if (!is_closed(term->let.vals[i], up))
+				return false;
+		return is_closed(term->let.body, up + 1);
+	case TERM_TEST:
+		if (!is_closed(term->test.pred, up))
+			return false;
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			if (!is_closed(term->test.csqs[i], up))
+				return false;
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			if (!is_closed(term->test.alts[i], up))
+				return false;
+		return true;
+	default:
+		return true;
+	}
+}
+
+static struct term *copy_shift(const struct term *term, int up, int delta);
+
+static struct term **copy_terms(size_t n, struct term *const *terms,
+				int up, int delta)
+{
+	struct term **copies = xmalloc(sizeof *copies * n);
+	for (size_t i = 0; i < n; ++i)
+		copies[i] = copy_shift(terms[i], up, delta);
+	return copies;
+}
+
+static symbol_mt *copy_names(size_t n, const symbol_mt *names)
+{
+	symbol_mt *copies = xmalloc(sizeof *copies * n);
+	for (size_t i = 0; i < n; ++i)
+		copies[i] = names[i];
+	return copies;
+}
+
+/*
+ * Copy 'term' (which we'll go on to modify in place, so it mustn't be
+ * shared), adding 'delta' to references to binders 'up' or more levels
+ * above it.
+ */
+static struct term *copy_shift(const struct term *term, int up, int delta)
+{
+	struct term *copy;
+
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		copy = (term->variety == TERM_ABS ? TermAbs : TermFix)
+			(term->abs.nformals,
+			 copy_names(term->abs.nformals, term->abs.formals),
+			 term->abs.nbodies,
+			 copy_terms(term->abs.nbodies, term->abs.bodies,
+				    up + 1, delta));
+		break;
+	case TERM_APP:
+		copy = TermApp(copy_shift(term->app.fun, up, delta),
+			       term->app.nargs,
+			       copy_terms(term->app.nargs, term->app.args,
+					  up, delta));
+		break;
+	case TERM_BOUND_VAR:
+		copy = TermBoundVar(term->bv.up +
+				    (term->bv.up >= up ? delta : 0),
+				    term->bv.across, term->bv.name);
+		break;
+	case TERM_CELL:
+		copy = TermCell(term->cell.nelts,
+				copy_terms(term->cell.nelts, term->cell.elts,
+					   up, delta));
+		break;
+	case TERM_LET:
+		copy = TermLet(term->let.ndefs,
+			       copy_names(term->let.ndefs, term->let.vars),
+			       copy_terms(term->let.ndefs, term->let.vals,
+					  up, delta),
+			       copy_shift(term->let.body, up + 1, delta));
+		break;
+	case TERM_TEST:
+		copy = TermTest(copy_shift(term->test.pred, up, delta),
+				term->test.ncsqs,
+				copy_terms(term->test.ncsqs, term->test.csqs,
+					   up, delta),
+				term->test.nalts,
+				copy_terms(term->test.nalts, term->test.alts,
+					   up, delta));
+		break;
+	case TERM_FREE_VAR:
+	case TERM_NUM:
+	case TERM_PRIM:
+	case TERM_PRUNED:
+	case TERM_STRING:
+		/* atoms aren't modified in place, so may be shared */
+		return (struct term *) term;
+	default:
+		panicf("Unhandled term variety %d\n", term->variety);
+	}
+	copy->origin = term->origin;
+	return copy;
+}
+
+struct binding {
+	struct term *val;	/* replacement, or NULL if kept */
+	unsigned uses;
+	bool under_abs;		/* some use is within an abstraction */
+	int across;		/* index if kept */
+};
+
+static void count_uses(const struct term *term, int up, bool under_abs,
+		       struct binding *bindings)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			count_uses(term->abs.bodies[i], up + 1,
+				   true, bindings);
+		break;
+	case TERM_APP:
+		count_uses(term->app.fun, up, under_abs, bindings);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			count_uses(term->app.args[i], up, under_abs, bindings);
+		break;
+	case TERM_BOUND_VAR:
+		if (term->bv.up == up) {
+			struct binding *b = &bindings[term->bv.across];
+			b->uses++;
+			b->under_abs |= under_abs;
+		}
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			count_uses(term->cell.elts[i], up, under_abs, bindings);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			count_uses(term->let.vals[i], up, under_abs, bindings);
+		count_uses(term->let.body, up + 1, under_abs, bindings);
+		break;
+	case TERM_TEST:
+		count_uses(term->test.pred, up, under_abs, bindings);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			count_uses(term->test.csqs[i], up, under_abs, bindings);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			count_uses(term->test.alts[i], up, under_abs, bindings);
+		break;
+	default:
+		/* nada */;
+	}
+}
+
+/*
+ * Substitute for references to the binder 'up' levels above 'term',
+ * which is removed from the term if 'removed' is true.
+ */
+static struct term *subst(struct term *term, int up,
+			  const struct binding *bindings, bool removed)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			term->abs.bodies[i] = subst(term->abs.bodies[i], up + 1,
+						    bindings, removed);
+		break;
+	case TERM_APP:
+		term->app.fun = subst(term->app.fun, up, bindings, removed);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			term->app.args[i] = subst(term->app.args[i], up,
+						  bindings, removed);
+		break;
+	case TERM_BOUND_VAR:
+		if (term->bv.up == up) {
+			const struct binding *b = &bindings[term->bv.across];
+			if (b->val)
+				return copy_shift(b->val, 0, up + !removed);
+			assert(!removed);
+			term->bv.across = b->across;
+		} else if (term->bv.up > up && removed)
+			term->bv.up--;
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			term->cell.elts[i] = subst(term->cell.elts[i], up,
+						   bindings, removed);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			term->let.vals[i] = subst(term->let.vals[i], up,
+						  bindings, removed);
+		term->let.body = subst(term->let.body, up + 1,
+				       bindings, removed);
+		break;
+	case TERM_TEST:
+		term->test.pred = subst(term->test.pred, up, bindings, removed);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			term->test.csqs[i] = subst(term->test.csqs[i], up,
+						   bindings, removed);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			term->test.alts[i] = subst(term->test.alts[i], up,
+						   bindings, removed);
+		break;
+	default:
+		/* nada */;
+	}
+	return term;
+}
+
+static struct term *simplify(struct term *term);
+
+static bool is_trivial(const struct term *term)
+{
+	switch (term->variety) {
+	case TERM_BOUND_VAR:
+	case TERM_FREE_VAR:
+	case TERM_NUM:
+	case TERM_PRIM:
+	case TERM_STRING:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Substituting an argument used once, outside any abstraction, can't
+ * duplicate work; substituting a trivial argument or a small closed
+ * value (typically an inlined global) duplicates little code.
+ */
+static bool is_inlinable(const struct term *arg, const struct binding *b)
+{
+	return !b->uses || is_trivial(arg) || (b->uses == 1 && !b->under_abs) ||
+	       (term_size(arg, inline_size) <= inline_size &&
+		is_closed(arg, 0));
+}
+
+/*
+ * Shared definitions lifted in from the environment only ever appear
+ * as arguments here; beta() may reorder them but substitutes copies,
+ * so the stored values are never modified.
+ */
+static struct term *beta(struct term *term)
+{
+	struct term *abs = term->app.fun;
+	if (abs->variety != TERM_ABS || abs->abs.nbodies != 1 ||
+	    abs->abs.nformals != term->app.nargs + 1 || !inline_fuel)
+		return term;
+
+	size_t nformals = abs->abs.nformals;
+	struct binding *bindings = xmalloc(sizeof *bindings * nformals);
+	for (size_t i = 0; i < nformals; ++i)
+		bindings[i] = (struct binding) { .val = NULL };
+	count_uses(abs->abs.bodies[0], 0, false, bindings);
+
+	size_t nkept = 1;
+	for (size_t i = 1; i < nformals; ++i) {
+		struct term *arg = term->app.args[i-1];
+		struct binding *b = &bindings[i];
+		if (is_inlinable(arg, b)) {
+			b->val = arg;
+			continue;
+		}
+		b->across = nkept;
+		abs->abs.formals[nkept] = abs->abs.formals[i];
+		term->app.args[nkept-1] = arg;
+		++nkept;
+	}
+	if (nkept == nformals) {
+		xfree(bindings);
+		return term;
+	}
+
+	--inline_fuel;
+	bool removed = nkept == 1;
+	struct term *body = subst(abs->abs.bodies[0], 0, bindings, removed);
+	xfree(bindings);
+	if (removed)
+		return simplify(body);
+	abs->abs.nformals = nkept;
+	term->app.nargs = nkept - 1;
+	abs->abs.bodies[0] = simplify(body);
+	return term;
+}
+
+static struct term *simplify(struct term *term)
+{
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			term->abs.bodies[i] = simplify(term->abs.bodies[i]);
+		return term;
+	case TERM_APP:
+		term->app.fun = simplify(term->app.fun);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			/* don't rewrite shared definitions */
+			if (!env_lookup_val(inline_env, term->app.args[i]))
+				term->app.args[i] =
+					simplify(term->app.args[i]);
+		return beta(term);
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			term->cell.elts[i] = simplify(term->cell.elts[i]);
+		return term;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			term->let.vals[i] = simplify(term->let.vals[i]);
+		term->let.body = simplify(term->let.body);
+		return term;
+	case TERM_TEST:
+		term->test.pred = simplify(term->test.pred);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			term->test.csqs[i] = simplify(term->test.csqs[i]);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			term->test.alts[i] = simplify(term->test.alts[i]);
+		return term;
+	case TERM_BOUND_VAR:
+	case TERM_FREE_VAR:
+	case TERM_NUM:
+	case TERM_PRIM:
+	case TERM_PRUNED:
+	case TERM_STRING:
+		return term;
+	default:
+		panicf("Unhandled term variety %d\n", term->variety);
+	}
+}
+
+struct term *inline_term(struct env *env, struct term *term, size_t size)
+{
+	inline_fuel = INLINE_FUEL;
+	inline_env = env;
+	inline_size = size;
+	return simplify(term);
+}
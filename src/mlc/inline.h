@@ -0,0 +1,46 @@
+#ifndef LARK_MLC_INLINE_H
+#define LARK_MLC_INLINE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Definition-time simplification.  When enabled, inline_term() beta-
+ * reduces redexes whose arguments are trivial (variables and atoms),
+ * used at most once outside any abstraction, or small closed values;
+ * since resolve lifts global definitions through a redex, the last
+ * case inlines small global combinators, and the redexes their
+ * inlining creates are in turn reduced.  Like fold(), this works in
+ * place and returns the (possibly new) root term.
+ */
+
+#include <stddef.h>
+
+struct env;
+struct term;
+
+#define INLINE_DEFAULT_SIZE 32
+
+/* 'size' is the maximum size of an inlined value, in terms */
+extern struct term *inline_term(struct env *env, struct term *term,
+				size_t size);
+
+#endif /* LARK_MLC_INLINE_H */
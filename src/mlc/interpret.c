@@ -26,7 +26,7 @@
 #include "interpret.h"
 #include "term.h"
 
-static void interpret_bool(const struct term *term)
+static void interpret_bool(FILE *out, const struct term *term)
 {
 	if (term->variety != TERM_ABS ||
 	    term->abs.nbodies != 1 ||
@@ -36,10 +36,10 @@ static void interpret_bool(const struct term *term)
 		return;
 	/* we expect the term to be closed */
 	assert(term->bv.up == 0 || term->bv.up == 1);
-	printf("read: %s\n", term->bv.up ? "True" : "False");
+	fprintf(out, "read: %s\n", term->bv.up ? "True" : "False");
 }
 
-static void interpret_int(const struct term *term)
+static void interpret_int(FILE *out, const struct term *term)
 {
 	/* Integers start with three abstractions */
 	if (term->variety != TERM_ABS ||
@@ -67,7 +67,7 @@ static void interpret_int(const struct term *term)
 	int n;
 	for (n = 0; 1; term = term->app.args[0], ++n) {
 		if (term->variety == TERM_BOUND_VAR && term->bv.up == 0) {
-			printf("read: %c%d\n", sign > 0 ? '+' : '-', n);
+			fprintf(out, "read: %c%d\n", sign > 0 ? '+' : '-', n);
 			return;
 		}
 		if (term->variety != TERM_APP ||
@@ -78,7 +78,7 @@ static void interpret_int(const struct term *term)
 	}
 }
 
-static void interpret_nat(const struct term *term)
+static void interpret_nat(FILE *out, const struct term *term)
 {
 	/* Church numerals start with two unary abstractions */
 	if (term->variety != TERM_ABS ||
@@ -94,7 +94,7 @@ static void interpret_nat(const struct term *term)
 	unsigned n;
 	for (n = 0; 1; term = term->app.args[0], ++n) {
 		if (term->variety == TERM_BOUND_VAR && term->bv.up == 0) {
-			printf("read: %u\n", n);
+			fprintf(out, "read: %u\n", n);
 			return;
 		}
 		if (term->variety != TERM_APP ||
@@ -105,9 +105,9 @@ static void interpret_nat(const struct term *term)
 	}
 }
 
-void interpret(const struct term *term)
+void interpret(FILE *out, const struct term *term)
 {
-	interpret_bool(term);
-	interpret_nat(term);
-	interpret_int(term);
+	interpret_bool(out, term);
+	interpret_nat(out, term);
+	interpret_int(out, term);
 }
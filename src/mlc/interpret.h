@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdio.h>
+
 struct term;
 
 /*
@@ -29,6 +31,6 @@ struct term;
  * Boolean, natural number (Church-encoded), etc.  Note interpretations
  * are merely conventions not types, so are not mutually exclusive.
  */
-extern void interpret(const struct term *term);
+extern void interpret(FILE *out, const struct term *term);
 
 #endif /* LARK_MLC_INTERPRET_H */
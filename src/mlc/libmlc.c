@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "cache.h"
+#include "ctx.h"
+#include "env.h"
+#include "form.h"
+#include "heap.h"
+#include "libmlc.h"
+#include "parse.h"
+#include "reduce.h"
+
+/*
+ * Process-wide state, shared by all contexts.
+ */
+void mlc_init(void)
+{
+	static bool initialized = false;
+	if (initialized)
+		return;
+	the_placeholder_symbol = symtab_intern("_");
+	node_heap_init();
+	register_eval_stats();
+	initialized = true;
+}
+
+/*
+ * A panic within a call returns to that call (see call()), which
+ * reports an internal error instead of exiting.
+ */
+static jmp_buf *the_recovery;
+static struct mlc_ctx *the_panicking;
+
+static void recover(const char *message)
+{
+	fprintf(the_panicking->err, "Internal error: %s", message);
+	longjmp(*the_recovery, 1);
+}
+
+/*
+ * Run 'parse' with the context's sinks in place, capturing output in
+ * the result where the context has no sink of its own.
+ */
+static enum mlc_status call(struct mlc_ctx *ctx,
+			    int (*parse)(struct mlc_ctx *ctx, const char *arg),
+			    const char *arg, struct mlc_result *result)
+{
+	*result = (struct mlc_result) { .status = MLC_OK };
+	FILE *capture = NULL;
+	if (!ctx->options.out || !ctx->options.err) {
+		capture = open_memstream(&result->output, &result->length);
+		if (!capture) {
+			xperror("open_memstream");
+			return result->status = MLC_ERROR_INTERNAL;
+		}
+	}
+	ctx->out = ctx->options.out ?: capture;
+	ctx->err = ctx->options.err ?: capture;
+	ctx->result = result;
+
+	jmp_buf recovery, *outer_recovery = the_recovery;
+	struct mlc_ctx *outer_panicking = the_panicking;
+	void (*outer_hook)(const char *message) = panic_hook;
+	the_recovery = &recovery;
+	the_panicking = ctx;
+	panic_hook = recover;
+	if (setjmp(recovery)) {
+		cache_abandon(ctx);
+		result->status = MLC_ERROR_INTERNAL;
+	} else {
+		int retval = parse(ctx, arg);
+		result->status = retval < 0 ? MLC_ERROR_INPUT :
+				 retval ? MLC_ERROR_PARSE : MLC_OK;
+	}
+	panic_hook = outer_hook;
+	the_panicking = outer_panicking;
+	the_recovery = outer_recovery;
+
+	fflush(ctx->out);
+	fflush(ctx->err);
+	ctx->out = ctx->options.out;
+	ctx->err = ctx->options.err;
+	ctx->result = NULL;
+	if (capture)
+		fclose(capture);	/* updates output & length */
+	return result->status;
+}
+
+struct mlc_ctx *mlc_ctx_create(const struct mlc_options *options)
+{
+	mlc_init();
+	struct mlc_ctx *ctx = xmalloc(sizeof *ctx);
+	*ctx = (struct mlc_ctx) {
+		.env = env_create(),
+		.options = options ? *options : (struct mlc_options) { 0 },
+	};
+	ctx->out = ctx->options.out;
+	ctx->err = ctx->options.err;
+	ctx->budget = (struct reduce_budget) {
+		.steps = ctx->options.max_steps,
+		.heap_bytes = ctx->options.max_heap,
+		.seconds = ctx->options.max_time,
+	};
+
+	if (!ctx->options.empty_env) {
+		struct mlc_result result;
+		enum mlc_status status = call(ctx, parse_include,
+					      "prelude.mlc", &result);
+		mlc_result_fini(&result);
+		if (status) {
+			mlc_ctx_destroy(ctx);
+			return NULL;
+		}
+	}
+	return ctx;
+}
+
+void mlc_ctx_destroy(struct mlc_ctx *ctx)
+{
+	env_destroy(ctx->env);
+	xfree(ctx);
+}
+
+enum mlc_status mlc_eval(struct mlc_ctx *ctx, const char *text,
+			 struct mlc_result *result)
+{
+	return call(ctx, parse_string, text, result);
+}
+
+enum mlc_status mlc_load(struct mlc_ctx *ctx, const char *pathname,
+			 struct mlc_result *result)
+{
+	return call(ctx, parse_file, pathname, result);
+}
+
+static char *form_text(const struct form *form)
+{
+	char *text;
+	size_t length;
+	FILE *out = open_memstream(&text, &length);
+	if (!out)
+		ppanic("open_memstream");
+	form_print(out, form);
+	fclose(out);
+	return text;
+}
+
+void ctx_note_reduction(struct mlc_ctx *ctx, const struct form *form,
+			const struct form *norm, enum reduce_status status,
+			const struct mlc_stats *stats)
+{
+	struct mlc_result *result = ctx->result;
+	if (!result)
+		return;
+	result->reductions = xrealloc(result->reductions,
+				      (result->nreductions + 1) *
+				      sizeof *result->reductions);
+	result->reductions[result->nreductions++] = (struct mlc_reduction) {
+		.form = form_text(form),
+		.norm = norm ? form_text(norm) : NULL,
+		.aborted = status == REDUCE_DONE ? NULL :
+			   reduce_status_message(status),
+		.stats = *stats,
+	};
+}
+
+void mlc_result_fini(struct mlc_result *result)
+{
+	for (size_t i = 0; i < result->nreductions; ++i) {
+		free(result->reductions[i].form);  /* open_memstream() */
+		free(result->reductions[i].norm);
+	}
+	xfree(result->reductions);
+	free(result->output);	/* allocated by open_memstream() */
+	result->reductions = NULL;
+	result->nreductions = 0;
+	result->output = NULL;
+	result->length = 0;
+}
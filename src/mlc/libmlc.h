@@ -0,0 +1,104 @@
+#ifndef LARK_MLC_LIBMLC_H
+#define LARK_MLC_LIBMLC_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Embedding interface to the MLC interpreter (libmlc.a).
+ *
+ * Each context has its own global environment, settings (quiet,
+ * listing, inlining, reduction budgets), and output sinks, and is
+ * passed explicitly through the interpreter, so a process may keep
+ * several.  Contexts share the symbol table and node heap, so calls
+ * into libmlc must not run concurrently; profiling and tracing are
+ * process-wide, enabled by the mlc front end.
+ *
+ * Each reduction is returned as structured data: its normal form as
+ * printed, whether a budget stopped it, and its costs.  Whatever the
+ * interpreter prints goes to the context's sinks, or if none were
+ * given is returned in the result.  Errors, including internal errors
+ * which would make mlc panic, are reported in the result's status and
+ * never exit the process; after an internal error the context remains
+ * usable, but memory the failed statement held isn't reclaimed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct mlc_ctx;
+
+struct mlc_options {
+	bool empty_env;		/* don't load prelude.mlc */
+	bool quiet, listing;
+	size_t inline_size;	/* see --inline; 0 disables */
+	bool church;		/* see --church */
+	bool compile;		/* see --compile */
+	unsigned long max_steps;
+	size_t max_heap;	/* bytes */
+	double max_time;	/* seconds */
+	FILE *out, *err;	/* sinks; NULL captures in the result */
+};
+
+enum mlc_status {
+	MLC_OK,
+	MLC_ERROR_INPUT,	/* couldn't read the input */
+	MLC_ERROR_PARSE,	/* syntax error or failed include */
+	MLC_ERROR_INTERNAL,	/* interpreter error; see the output */
+};
+
+/*
+ * Costs of a reduction.  For compiled evaluation (see --compile),
+ * steps and betas count calls, allocs counts run-time objects, and
+ * peak isn't tracked.
+ */
+struct mlc_stats {
+	double seconds;
+	unsigned long steps, betas, prims;
+	unsigned long allocs, peak;	/* nodes */
+};
+
+struct mlc_reduction {
+	char *form;		/* the statement, as printed */
+	char *norm;		/* its normal form, or NULL if aborted */
+	const char *aborted;	/* the exhausted budget, or NULL */
+	struct mlc_stats stats;
+};
+
+struct mlc_result {
+	enum mlc_status status;
+	struct mlc_reduction *reductions;	/* in statement order */
+	size_t nreductions;
+	char *output;		/* NUL-terminated; see mlc_result_fini() */
+	size_t length;
+};
+
+extern void mlc_init(void);
+extern struct mlc_ctx *mlc_ctx_create(const struct mlc_options *options);
+extern void mlc_ctx_destroy(struct mlc_ctx *ctx);
+extern enum mlc_status mlc_eval(struct mlc_ctx *ctx, const char *text,
+				struct mlc_result *result);
+extern enum mlc_status mlc_load(struct mlc_ctx *ctx, const char *pathname,
+				struct mlc_result *result);
+extern void mlc_result_fini(struct mlc_result *result);
+
+#endif /* LARK_MLC_LIBMLC_H */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Exercise the embedding interface: independent environments, per-
+ * context budgets, structured results, and captured or direct output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/message.h>
+
+#include "libmlc.h"
+
+static void eval(struct mlc_ctx *ctx, const char *label, const char *text)
+{
+	struct mlc_result result;
+	mlc_eval(ctx, text, &result);
+	printf("[%s] status %d, %zu reductions\n",
+	       label, result.status, result.nreductions);
+	for (size_t i = 0; i < result.nreductions; ++i) {
+		const struct mlc_reduction *r = &result.reductions[i];
+		printf("  %s => %s (betas %lu)\n", r->form,
+		       r->norm ? r->norm : r->aborted, r->stats.betas);
+	}
+	if (result.output)
+		printf("%zu bytes:\n%s", result.length, result.output);
+	mlc_result_fini(&result);
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+
+	struct mlc_options options = { .quiet = true };
+	struct mlc_ctx *a = mlc_ctx_create(&options);
+	options.max_steps = 1000;
+	struct mlc_ctx *b = mlc_ctx_create(&options);
+	options.max_steps = 0;
+	options.out = options.err = stdout;
+	struct mlc_ctx *c = mlc_ctx_create(&options);
+	if (!a || !b || !c)
+		panic("Couldn't create contexts\n");
+
+	eval(a, "a", "x := 3. x + 4.");
+	eval(b, "b", "x + 4.");
+	eval(b, "b", "x := 10. x * x.");
+	eval(a, "a", "x * x.");
+	eval(a, "a", "nonsense ).");
+
+	const char *loop = "grow := [grow! n. grow ([n | n])]. grow (1).";
+	eval(b, "b", loop);
+
+	eval(c, "c", "x := 5. x - 1. x ).");
+
+	mlc_ctx_destroy(a);
+	mlc_ctx_destroy(b);
+	mlc_ctx_destroy(c);
+	return EXIT_SUCCESS;
+}
@@ -20,47 +20,135 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
 #include <glob.h>
 #include <stdio.h>
 #include <readline/history.h>
 #include <readline/readline.h>	/* must follow stdio.h */
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/random.h>
 #include <unistd.h>
 
+#include <engine/stats.h>
 #include <util/base64.h>
+#include <util/bytebuf.h>
 #include <util/huidrand.h>
 #include <util/memutil.h>
 #include <util/message.h>
 
-#include "env.h"
-#include "form.h"
-#include "heap.h"
+#include "ctx.h"
+#include "inline.h"
+#include "libmlc.h"
 #include "mlc.h"
 #include "mlc.lex.h"
 #include "parse.h"
+#include "perf.h"
+#include "profile.h"
+#include "reduce.h"
+#include "serve.h"
 #include "term.h"
+#include "trace.h"
 
-int listing_setting = 0;
-int quiet_setting = 0;
+/*
+ * Whether buffered REPL input could end a statement: outside any string
+ * or comment, with all brackets closed, and ending with '.'.  The REPL
+ * keeps reading lines until this holds, so statements and strings may
+ * span lines; an empty line submits whatever is buffered regardless.
+ */
+static bool input_complete(const char *text, size_t size)
+{
+	const char *p = text, *end = text + size;
+	int depth = 0;
+	char last = '\0';
 
-static void parse_line(const char *line)
+	while (p < end) {
+		char c = *p++;
+		switch (c) {
+		case '"':
+			while (p < end && *p != '"')
+				p += (*p == '\\') ? 2 : 1;
+			if (p >= end)
+				return false;
+			++p;
+			break;
+		case '|':
+			if (p < end && *p == '*') {
+				while (++p < end && *p != '\n')
+					if (*p == '*' && p + 1 < end &&
+					    p[1] == '|') {
+						++p;
+						break;
+					}
+				++p;
+				continue;
+			}
+			break;
+		case '(': case '[': case '{': ++depth; break;
+		case ')': case ']': case '}': --depth; break;
+		}
+		if (!isspace((unsigned char) c))
+			last = c;
+	}
+	return depth <= 0 && last == '.';
+}
+
+/*
+ * The REPL reuses one scanner for all input, scanning each complete
+ * chunk of buffered lines in place.
+ */
+static void repl(struct mlc_ctx *ctx)
 {
-	/*
-	 * XXX we should avoid creating and destroying a scanner for
-	 * each line... it's probably fast enough to not worry about,
-	 * but makes multiline tokens impossible.
-	 */
 	struct scanner_state scanner;
-	mlc_scan_init(&scanner);
-	mlc_scan_string(line, &scanner);
-	mlc_yyparse(scanner.flexstate);
+	mlc_scan_init(&scanner, ctx->err);
+	struct bytebuf pending;
+	bytebuf_init(&pending);
+
+	char *input;
+	while ((input = readline(bytebuf_used(&pending) ? "| " : "> "))) {
+		size_t len = strlen(input);
+		if (len)
+			add_history(input);
+		bytebuf_append_string(&pending, input, len);
+		bytebuf_append_char(&pending, '\n');
+		xfree(input);
+
+		if (len && !input_complete((char *) pending.data,
+					   bytebuf_used(&pending)))
+			continue;
+		bytebuf_append_string(&pending, "\0\0", 2);
+		mlc_scan_buffer((char *) pending.data, bytebuf_used(&pending),
+				&scanner);
+		mlc_yyparse(scanner.flexstate, ctx);
+		bytebuf_complete(&pending);
+	}
+
+	bytebuf_fini(&pending);
 	mlc_scan_fini(&scanner);
 }
 
 static void usage(void) __attribute__ ((noreturn));
 
+#define TRACE_DEFAULT_RECORDS (1 << 20)
+
+/* long-only options */
+enum {
+	OPT_CHURCH = 256,
+	OPT_COMPILE,
+	OPT_FORK,
+	OPT_INLINE,
+	OPT_MAX_HEAP,
+	OPT_MAX_STEPS,
+	OPT_MAX_TIME,
+	OPT_PERF,
+	OPT_SERVE,
+	OPT_STATS,
+	OPT_TRACE_RECORDS,
+};
+
 #define NONCE_BYTES 36
 
 static void init(void)
@@ -73,10 +161,41 @@ static void init(void)
 	const char *attestor = "mlc interpreter " __FILE__ " " __DATE__;
 	huid_init(text_bytes, attestor);
 
-	the_placeholder_symbol = symtab_intern("_");
+	mlc_init();
+}
+
+/*
+ * The server evaluates requests in a libmlc context configured from our
+ * command-line options, capturing its output; files given on the
+ * command line are loaded into that context before we start listening.
+ */
+static int start_server(const char *pathname, struct mlc_options options,
+			bool use_prelude, const char *load_file,
+			const char *input_file, bool fork_workers)
+{
+	options.empty_env = !use_prelude;
+	options.out = options.err = NULL;
+	struct mlc_ctx *ctx = mlc_ctx_create(&options);
+	if (!ctx) {
+		fputs("Error: Couldn't load prelude\n", stderr);
+		return -1;
+	}
 
-	node_heap_init();
-	env_init();
+	int retval = 0;
+	const char *files [] = { load_file, input_file };
+	for (size_t i = 0; i < 2 && !retval; ++i) {
+		if (!files[i])
+			continue;
+		struct mlc_result result;
+		retval = mlc_load(ctx, files[i], &result) != MLC_OK;
+		if (result.output)
+			fwrite(result.output, 1, result.length, stdout);
+		mlc_result_fini(&result);
+	}
+	if (!retval)
+		retval = serve(ctx, pathname, fork_workers);
+	mlc_ctx_destroy(ctx);
+	return retval;
 }
 
 static void usage(void)
@@ -88,14 +207,72 @@ static void usage(void)
 	"        => read from standard input, otherwise.\n"
 	"Options:\n"
 	"	 -d		 Debug parser\n"
+	"        --church        Compute Church numeral arithmetic natively\n"
+	"        --compile       Evaluate compiled code, call-by-value\n"
 	"        -e              Empty environment (don't load prelude)\n"
+	"        --fork          Fork a worker per connection when serving\n"
+	"        --inline[=<size>]\n"
+	"                        Inline small definitions (default size %d)\n"
 	"        -l <pathname>   Load the given file before entering REPL\n"
 	"        -L              Verbose multi-line listings\n"
+	"        --max-heap=<bytes>\n"
+	"                        Abort reductions using more heap\n"
+	"        --max-steps=<n> Abort reductions taking more steps\n"
+	"        --max-time=<seconds>\n"
+	"                        Abort reductions taking more time\n"
+	"        --perf=<pathname>\n"
+	"                        Write deterministic reduction costs at exit\n"
+	"        -p, --profile   Print per-definition reduction costs\n"
+	"        -F, --folded=<pathname>\n"
+	"                        Write folded profile stacks at exit\n"
 	"        -q              Quieter output\n"
+	"        --serve=<pathname>\n"
+	"                        Serve evaluation requests on a socket\n"
+	"        --stats=<pathname>\n"
+	"                        Write statistics as JSON at exit\n"
+	"        -T, --trace=<pathname>\n"
+	"                        Record a binary reduction trace\n"
+	"        --trace-records=<n>\n"
+	"                        Size of trace ring buffer (default %d)\n",
+	INLINE_DEFAULT_SIZE, TRACE_DEFAULT_RECORDS
 	);
 	exit(EXIT_FAILURE);
 }
 
+/*
+ * Numeric option values must be entirely numeric and non-negative;
+ * otherwise strtoul() and strtod() would quietly turn a typo into 0,
+ * which for the budgets means no limit at all.
+ */
+static unsigned long parse_count(const char *option, const char *arg)
+{
+	const char *digits = arg;
+	while (isspace((unsigned char) *digits))
+		++digits;
+	char *end;
+	errno = 0;
+	unsigned long value = strtoul(digits, &end, 0);
+	if (errno || end == digits || *end || *digits == '-') {
+		fprintf(stderr, "Invalid count for --%s: '%s'\n",
+			option, arg);
+		usage();
+	}
+	return value;
+}
+
+static double parse_seconds(const char *option, const char *arg)
+{
+	char *end;
+	errno = 0;
+	double value = strtod(arg, &end);
+	if (errno || end == arg || *end || !(value >= 0.0)) {
+		fprintf(stderr, "Invalid seconds for --%s: '%s'\n",
+			option, arg);
+		usage();
+	}
+	return value;
+}
+
 int main(int argc, char *argv[])
 {
 	set_execname(argv[0]);
@@ -103,26 +280,100 @@ int main(int argc, char *argv[])
 
 	int c;
 	bool use_prelude = true;
-	const char *load_file = NULL;
-	while ((c = getopt(argc, argv, "del:Lq")) != -1) {
+	const char *load_file = NULL, *folded_file = NULL, *perf_file = NULL,
+		   *stats_file = NULL, *trace_file = NULL,
+		   *serve_socket = NULL;
+	bool fork_workers = false;
+	size_t trace_records = TRACE_DEFAULT_RECORDS;
+	struct mlc_options options = {
+		.empty_env = true,	/* the prelude is included below */
+		.out = stdout,
+		.err = stderr,
+	};
+	static const struct option long_options [] = {
+		{ "church",	no_argument,		NULL, OPT_CHURCH },
+		{ "compile",	no_argument,		NULL, OPT_COMPILE },
+		{ "folded",	required_argument,	NULL, 'F' },
+		{ "fork",	no_argument,		NULL, OPT_FORK },
+		{ "inline",	optional_argument,	NULL, OPT_INLINE },
+		{ "max-heap",	required_argument,	NULL, OPT_MAX_HEAP },
+		{ "max-steps",	required_argument,	NULL, OPT_MAX_STEPS },
+		{ "max-time",	required_argument,	NULL, OPT_MAX_TIME },
+		{ "perf",	required_argument,	NULL, OPT_PERF },
+		{ "profile",	no_argument,		NULL, 'p' },
+		{ "serve",	required_argument,	NULL, OPT_SERVE },
+		{ "stats",	required_argument,	NULL, OPT_STATS },
+		{ "trace",	required_argument,	NULL, 'T' },
+		{ "trace-records", required_argument,	NULL, OPT_TRACE_RECORDS },
+		{ NULL,		0,			NULL, 0 },
+	};
+	while ((c = getopt_long(argc, argv, "deF:l:LpqT:",
+				long_options, NULL)) != -1) {
 		switch (c) {
 		case 'd': mlc_yydebug = 1; break;
 		case 'e': use_prelude = false; break;
+		case 'F': folded_file = optarg;	/* -F implies -p */
+			/* fall through */
+		case 'p': profile_setting = true; break;
 		case 'l': load_file = optarg; break;
-		case 'L': listing_setting = 1; break;
-		case 'q': quiet_setting = 1; break;
+		case 'L': options.listing = true; break;
+		case 'q': options.quiet = true; break;
+		case 'T': trace_file = optarg; break;
+		case OPT_CHURCH: options.church = true; break;
+		case OPT_COMPILE: options.compile = true; break;
+		case OPT_FORK: fork_workers = true; break;
+		case OPT_SERVE: serve_socket = optarg; break;
+		case OPT_INLINE:
+			options.inline_size =
+				optarg ? parse_count("inline", optarg)
+				       : INLINE_DEFAULT_SIZE;
+			break;
+		case OPT_MAX_HEAP:
+			options.max_heap = parse_count("max-heap", optarg);
+			break;
+		case OPT_MAX_STEPS:
+			options.max_steps = parse_count("max-steps", optarg);
+			break;
+		case OPT_MAX_TIME:
+			options.max_time = parse_seconds("max-time", optarg);
+			break;
+		case OPT_PERF: perf_file = optarg; break;
+		case OPT_STATS: stats_file = optarg; break;
+		case OPT_TRACE_RECORDS:
+			trace_records = parse_count("trace-records", optarg);
+			if (!trace_records) {
+				fputs("--trace-records must be positive\n",
+				      stderr);
+				usage();
+			}
+			break;
 		default: usage();
 		}
 	}
 	if (optind + 1 < argc)
 		usage();
+	if (trace_file && trace_open(trace_file, trace_records))
+		exit(EXIT_FAILURE);
 
+	int result = 0;
+	if (serve_socket) {
+		result = start_server(serve_socket, options, use_prelude,
+				      load_file,
+				      optind < argc ? argv[optind] : NULL,
+				      fork_workers);
+		goto done;
+	}
+
+	/*
+	 * The command line drives the parser directly rather than through
+	 * mlc_eval(), so internal errors still panic.
+	 */
+	struct mlc_ctx *ctx = mlc_ctx_create(&options);
 	if (use_prelude)
-		parse_include("prelude.mlc");
+		parse_include(ctx, "prelude.mlc");
 
-	int result = 0;
 	if (optind < argc) {
-		result = parse_file(argv[optind]);
+		result = parse_file(ctx, argv[optind]);
 
 	} else if (isatty(fileno(stdin))) {
 		/*
@@ -137,25 +388,26 @@ int main(int argc, char *argv[])
 		}
 
 		if (load_file)
-			if (parse_file(load_file))
+			if (parse_file(ctx, load_file))
 				goto done;
 
-		char *input;
-		while ((input = readline("> "))) {
-			if (*input)
-				add_history(input);
-			parse_line(input);
-			xfree(input);
-		}
+		repl(ctx);
 		if (histfile) {
 			write_history(histfile);
 			globfree(&globbuf);
 		}
 
 	} else {
-		result = parse_stdin();
+		result = parse_stdin(ctx);
 	}
 
 done:
+	if (folded_file && write_profile_folded(folded_file))
+		result = 1;
+	if (perf_file && write_perf(perf_file))
+		result = 1;
+	if (stats_file && stats_write_json(stats_file))
+		result = 1;
+	trace_close();
 	return result;
 }
@@ -22,9 +22,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-extern int listing_setting;
-extern int quiet_setting;
+struct mlc_ctx;
+
 extern int mlc_yydebug;
-extern int mlc_yyparse(void *scanner);
+extern int mlc_yyparse(void *scanner, struct mlc_ctx *ctx);
 
 #endif /* LARK_MLC_MLC_H */
@@ -29,14 +29,19 @@
 struct scanner_state {
 	void *flexstate;
 	struct bytebuf strbuf;
+	void *buffer;		/* current flex input buffer */
+	FILE *err;		/* for scan errors */
 };
 
 /* signatures of wrapper/helper functions (not autogenerated) */
-extern void mlc_scan_init(struct scanner_state *scanner);
+extern void mlc_scan_init(struct scanner_state *scanner, FILE *err);
 extern void mlc_scan_fini(struct scanner_state *scanner);
 extern void mlc_scan_string(const char *s, struct scanner_state *scanner);
+extern void mlc_scan_buffer(char *base, size_t size,
+			    struct scanner_state *scanner);
 
 typedef void *mlc_yyscan_t;	/* same as flex's yyscan_t */
+struct mlc_ctx;			/* the parser's other parameter */
 
 /* signatures of flex-generated functions (arg is 'flexstate') */
 extern void mlc_yyrestart(FILE *fin, mlc_yyscan_t scanner);
@@ -23,6 +23,8 @@
 
 #include <stdlib.h>
 
+#include "cache.h"
+#include "ctx.h"
 #include "env.h"
 #include "form.h"
 #include "mlc.lex.h"
@@ -43,14 +45,15 @@
 
 %{
 extern int mlc_yylex(YYSTYPE *valp, YYLTYPE *locp, void *scanner);
-static int mlc_yyerror(YYLTYPE *locp, mlc_yyscan_t scanner, const char *s);
+static int mlc_yyerror(YYLTYPE *locp, mlc_yyscan_t scanner,
+		       struct mlc_ctx *ctx, const char *s);
 %}
 
 %define api.pure
 %define parse.error verbose
 %locations
 %lex-param {void *scanner}
-%parse-param {mlc_yyscan_t scanner}
+%parse-param {mlc_yyscan_t scanner} {struct mlc_ctx *ctx}
 
 %token CMD_ECHO
 %token DEF
@@ -87,15 +90,20 @@ stmts	: '.'
 	| stmts stmt '.'
 	;
 
-stmt	: term 			{ stmt_reduce($1); form_free($1); }
-	| CMD_ECHO		{ putchar('\n'); }
-	| CMD_ECHO STRING	{ fputs($2->str, stdout); putchar('\n'); }
-	| ENV_DUMP		{ env_dump(NULL); }
-	| ENV_DUMP STRING	{ env_dump($2->str); }
-	| INCLUDE STRING	{ if (parse_include($2->str)) YYERROR; }
-	| LIST term 		{ stmt_list($2); }
-	| SECTION HUID		{ printf("section: #%s.\n", $2); }
-	| var DEF term 		{ stmt_define($1->var.name, $3); }
+stmt	: term 			{ stmt_reduce(ctx, $1); form_free($1); }
+	| CMD_ECHO		{ cache_note_uncacheable(ctx);
+				  fputc('\n', ctx->out); }
+	| CMD_ECHO STRING	{ cache_note_uncacheable(ctx);
+				  fprintf(ctx->out, "%s\n", $2->str); }
+	| ENV_DUMP		{ cache_note_uncacheable(ctx);
+				  env_dump(ctx->env, ctx->out, NULL); }
+	| ENV_DUMP STRING	{ cache_note_uncacheable(ctx);
+				  env_dump(ctx->env, ctx->out, $2->str); }
+	| INCLUDE STRING	{ if (parse_include(ctx, $2->str)) YYERROR; }
+	| LIST term 		{ stmt_list(ctx, $2); }
+	| SECTION HUID		{ cache_note_uncacheable(ctx);
+				  fprintf(ctx->out, "section: #%s.\n", $2); }
+	| var DEF term 		{ stmt_define(ctx, $1->var.name, $3); }
 	;
 
 /*
@@ -183,12 +191,14 @@ blank	: '_'			{ $$ = FormVar(the_placeholder_symbol); };
 %%
 /* Additional C code section */
 
-static int mlc_yyerror(YYLTYPE *locp, void *scanner, const char *s)
+static int mlc_yyerror(YYLTYPE *locp, void *scanner, struct mlc_ctx *ctx,
+		       const char *s)
 {
 	if (locp->first_line == locp->last_line)
-		fprintf(stderr, "Parse error: %d: %s\n", locp->first_line, s);
+		fprintf(ctx->err, "Parse error: %d: %s\n",
+			locp->first_line, s);
 	else
-		fprintf(stderr, "Parse error: %d-%d: %s\n",
+		fprintf(ctx->err, "Parse error: %d-%d: %s\n",
 			locp->first_line, locp->last_line, s);
 	return 0;
 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Library load benchmark: generate .mlc sources of increasing size (up
+ * to the given number of megabytes), load each into a fresh context,
+ * and report throughput.  Load time should scale linearly with size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <engine/clock.h>
+#include <util/message.h>
+
+#include "libmlc.h"
+
+#define DEFAULT_MEGABYTES 8
+
+static size_t generate(FILE *out, size_t bytes)
+{
+	size_t ndefs = 0;
+	for (long pos = 0; pos < (long) bytes; pos = ftell(out), ++ndefs) {
+		fprintf(out,
+			"|* definition %zu\n"
+			"d%zu := [x, y. let {z := x * %zu} "
+			"[z < y? [x | \"d%zu\"] | [y | z + %zu.5]]].\n",
+			ndefs, ndefs, ndefs, ndefs, ndefs);
+	}
+	return ndefs;
+}
+
+static int bench(size_t megabytes)
+{
+	char pathname [] = "/tmp/mlcparsebench.XXXXXX";
+	int fd = mkstemp(pathname);
+	if (fd < 0)
+		return xperror("mkstemp");
+	FILE *out = fdopen(fd, "w");
+	size_t ndefs = generate(out, megabytes << 20);
+	fclose(out);
+
+	struct mlc_options options = { .empty_env = true, .quiet = true };
+	struct mlc_ctx *ctx = mlc_ctx_create(&options);
+	struct mlc_result result;
+	double start = clock_cpu_seconds();
+	int status = mlc_load(ctx, pathname, &result);
+	double elapsed = clock_cpu_seconds() - start;
+	if (status)
+		fprintf(stderr, "%s", result.output);
+	mlc_result_fini(&result);
+	mlc_ctx_destroy(ctx);
+	unlink(pathname);
+	if (status)
+		return status;
+
+	printf("%4zu MB %9zu defs %8.3f cpu-s %8.2f MB/s %8.0f ns/def\n",
+	       megabytes, ndefs, elapsed, megabytes / elapsed,
+	       elapsed * 1e9 / ndefs);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+	if (argc > 2) {
+		fputs("Usage: mlcparsebench [<megabytes>]\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	size_t max = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_MEGABYTES;
+
+	mlc_init();
+	for (size_t megabytes = 1; megabytes <= max; megabytes *= 2)
+		if (bench(megabytes))
+			exit(EXIT_FAILURE);
+	return EXIT_SUCCESS;
+}
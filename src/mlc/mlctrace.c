@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Offline analyzer for binary reduction traces written by 'mlc -T'.
+ * See trace.h for the format.
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "trace.h"
+
+static void usage(void) __attribute__ ((noreturn));
+
+/*
+ * Times and node identities vary from run to run; quiet output leaves
+ * them out so that a trace of a deterministic run can be checked
+ * against a reference.
+ */
+static bool quiet_setting = false;
+
+static void usage(void)
+{
+	fprintf(stderr,
+	"Usage: mlctrace <options> <pathname>\n"
+	"Options:\n"
+	"        -n <count>      Number of longest copies to show (10)\n"
+	"        -q              Omit times and node identities\n"
+	);
+	exit(EXIT_FAILURE);
+}
+
+static const struct trace_header *map_trace(const char *pathname)
+{
+	int fd = open(pathname, O_RDONLY);
+	if (fd < 0) {
+		xperror(pathname);
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st)) {
+		xperror(pathname);
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size < (off_t) sizeof (struct trace_header)) {
+		fprintf(stderr, "%s: Trace file is truncated\n", pathname);
+		close(fd);
+		return NULL;
+	}
+	void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		xperror(pathname);
+		return NULL;
+	}
+
+	const struct trace_header *header = addr;
+	if (memcmp(header->magic, TRACE_MAGIC, sizeof header->magic) ||
+	    header->version != TRACE_VERSION ||
+	    header->recsize != sizeof (struct trace_record)) {
+		fprintf(stderr, "%s: Not a version %d reduction trace\n",
+			pathname, TRACE_VERSION);
+		return NULL;
+	}
+	if (sizeof *header + header->capacity * header->recsize >
+	    (uint64_t) st.st_size) {
+		fprintf(stderr, "%s: Trace file is truncated\n", pathname);
+		return NULL;
+	}
+	return header;
+}
+
+static int compare_aux_desc(const void *a, const void *b)
+{
+	const struct trace_record *x = *(const struct trace_record **) a,
+				  *y = *(const struct trace_record **) b;
+	return (x->aux < y->aux) - (x->aux > y->aux);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static void print_histogram(const unsigned long *counts, uint64_t total)
+{
+	printf("\t\t\tRULE HISTOGRAM\n"
+	       "\t\t\t==============\n");
+	for (unsigned i = 0; i < TRACE_NEVENTS; ++i) {
+		if (!counts[i])
+			continue;
+		printf("%-16s %12lu %6.2f%%\n", trace_event_name(i),
+		       counts[i], 100.0 * counts[i] / total);
+	}
+}
+
+static void print_copies(const struct trace_record **copies,
+			 size_t ncopies, size_t top)
+{
+	unsigned long nodes = 0;
+	for (size_t i = 0; i < ncopies; ++i)
+		nodes += copies[i]->aux;
+	printf("\t\t\tLONGEST COPIES\n"
+	       "\t\t\t==============\n"
+	       "%lu copies, %lu nodes copied\n",
+	       (unsigned long) ncopies, nodes);
+	if (!ncopies)
+		return;
+
+	qsort(copies, ncopies, sizeof *copies, compare_aux_desc);
+	if (quiet_setting) {
+		printf("%12s %8s\n", "nodes", "depth");
+		for (size_t i = 0; i < ncopies && i < top; ++i)
+			printf("%12lu %8u\n", (unsigned long) copies[i]->aux,
+			       (unsigned) copies[i]->depth);
+		return;
+	}
+	printf("%12s %8s %10s %14s\n", "nodes", "depth", "node", "time (s)");
+	for (size_t i = 0; i < ncopies && i < top; ++i)
+		printf("%12lu %8u %10x %14.6f\n",
+		       (unsigned long) copies[i]->aux,
+		       (unsigned) copies[i]->depth,
+		       (unsigned) copies[i]->node,
+		       copies[i]->nsec / 1e9);
+}
+
+static void print_pauses(uint64_t *pauses, size_t npauses,
+			 unsigned long freed)
+{
+	printf("\t\t\tGC PAUSES\n"
+	       "\t\t\t=========\n"
+	       "%lu collections, %lu nodes freed\n",
+	       (unsigned long) npauses, freed);
+	if (!npauses || quiet_setting)
+		return;
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < npauses; ++i)
+		total += pauses[i];
+	qsort(pauses, npauses, sizeof *pauses, compare_u64);
+	printf("%12s %12s %12s %12s %12s\n",
+	       "min (ms)", "median", "p90", "max", "total");
+	printf("%12.3f %12.3f %12.3f %12.3f %12.3f\n",
+	       pauses[0] / 1e6, pauses[npauses / 2] / 1e6,
+	       pauses[npauses * 9 / 10] / 1e6, pauses[npauses - 1] / 1e6,
+	       total / 1e6);
+}
+
+static int analyze(const struct trace_header *header, size_t top)
+{
+	const struct trace_record *ring =
+		(const struct trace_record *) (header + 1);
+	uint64_t count = header->count, capacity = header->capacity,
+		 nrecs = count < capacity ? count : capacity,
+		 start = count < capacity ? 0 : count % capacity;
+
+	printf("%lu records (%lu written, %lu lost to wraparound)\n",
+	       (unsigned long) nrecs, (unsigned long) count,
+	       (unsigned long) (count - nrecs));
+	if (!nrecs)
+		return 0;
+
+	unsigned long counts [TRACE_NEVENTS] = { 0 }, freed = 0;
+	const struct trace_record **copies =
+		xmalloc(nrecs * sizeof *copies);
+	uint64_t *pauses = xmalloc(nrecs * sizeof *pauses), gc_start = 0;
+	size_t ncopies = 0, npauses = 0;
+	bool in_gc = false;
+
+	for (uint64_t i = 0; i < nrecs; ++i) {
+		const struct trace_record *rec =
+			&ring[(start + i) % capacity];
+		if (rec->event < TRACE_NEVENTS)
+			counts[rec->event]++;
+		switch (rec->event) {
+		case TRACE_COPY:
+			copies[ncopies++] = rec;
+			break;
+		case TRACE_GC_START:
+			gc_start = rec->nsec, in_gc = true;
+			break;
+		case TRACE_GC_END:
+			if (in_gc)
+				pauses[npauses++] = rec->nsec - gc_start;
+			freed += rec->aux, in_gc = false;
+			break;
+		}
+	}
+
+	uint64_t span = ring[(start + nrecs - 1) % capacity].nsec -
+			ring[start].nsec;
+	if (!quiet_setting)
+		printf("%.6fs elapsed\n", span / 1e9);
+	print_histogram(counts, nrecs);
+	print_copies(copies, ncopies, top);
+	print_pauses(pauses, npauses, freed);
+
+	xfree(pauses);
+	xfree(copies);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	set_execname(argv[0]);
+
+	int c;
+	size_t top = 10;
+	while ((c = getopt(argc, argv, "n:q")) != -1) {
+		switch (c) {
+		case 'n': top = strtoul(optarg, NULL, 0); break;
+		case 'q': quiet_setting = true; break;
+		default: usage();
+		}
+	}
+	if (optind + 1 != argc)
+		usage();
+
+	const struct trace_header *header = map_trace(argv[optind]);
+	if (!header)
+		return EXIT_FAILURE;
+	return analyze(header, top);
+}
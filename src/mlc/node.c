@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <engine/memloc.h>
 #include <util/base64.h>
 #include <util/memutil.h>
 #include <util/message.h>
@@ -30,7 +31,6 @@
 #include "heap.h"
 #include "node.h"
 #include "num.h"
-#include "memloc.h"
 #include "prim.h"
 #include "term.h"
 
@@ -40,8 +40,10 @@ static struct node *node_alloc(enum node_variety variety, struct node *prev,
 	struct node *node = node_heap_alloc(nslots);
 	node->variety = variety;
 	node->isfresh = false;
+	node->church = 0;
 	node->depth = depth;
 	node->nref = 0;
+	node->origin = 0;
 	node->prev = prev;
 	node->next = NULL;
 	node->forward = NULL;
@@ -91,6 +93,14 @@ struct node *NodeCell(struct node *prev, int depth, size_t n)
 	return node_alloc(NODE_CELL, prev, depth, n);
 }
 
+struct node *NodeChurch(struct node *prev, int depth, unsigned long count)
+{
+	struct node *node = node_alloc(NODE_VAL, prev, depth, 1);
+	node->slots[0].variety = SLOT_CHURCH;
+	node->slots[0].count = count;
+	return node;
+}
+
 struct node *NodeFreeVar(struct node *prev, int depth, struct term *var)
 {
 	struct node *node = node_alloc(NODE_VAR, prev, depth, 1);
@@ -177,49 +187,63 @@ void node_deref(struct node *node)
 	}
 }
 
-static void node_free_body(struct node *node)
+/*
+ * Freeing a binder doesn't free its body recursively.  Instead we push
+ * the body's sentinel on a stack of dead bodies (linked through
+ * 'forward', which a dead body has no other use for) and release them
+ * node by node in node_free_pending(), so releasing a deeply nested
+ * dead closure costs no C stack proportional to its nesting.
+ *
+ * node_free() drains the stack fully before returning.  A dead body
+ * may refer to nodes in any body enclosing it, live or dead, so its
+ * references can't outlive the call: deferred, they would keep nodes
+ * of an enclosing body referenced after that body was freed, and would
+ * drop live nodes to no references behind the reducer's back.  Bodies
+ * found while draining are nested in the one being drained, so we
+ * always drain the most recently pushed body first, just as the
+ * recursion did.
+ */
+static struct node *the_dead_bodies;
+static bool the_free_draining;
+
+static void node_push_body(struct node *node)
 {
+	if (!node)
+		return;
 	assert(node->variety == NODE_SENTINEL);
-	if (node->next == node) return;		/* already pinched */
+	assert(!node->nref);
 
 	/* if the body is intact, first dereference next... */
-	assert(node->nslots);
-	assert(node->slots[0].variety == SLOT_SUBST);
-	assert(node->slots[0].subst == node->next);
-	node->slots[0].subst = NULL, node->next->nref--;
-
-	/* then decrement references as we go */
-	node = node->next;
-	while (!done(node)) {
-		struct node *tmp = node->next;
-		node_deref(node);
-		node_free(node);
-		node = tmp;
+	if (node->next != node) {
+		assert(node->nslots);
+		assert(node->slots[0].variety == SLOT_SUBST);
+		assert(node->slots[0].subst == node->next);
+		node->slots[0].subst = NULL, node->next->nref--;
 	}
+	node->forward = the_dead_bodies;
+	the_dead_bodies = node;
 }
 
-void node_free(struct node *node)
+static void node_release(struct node *node)
 {
-	if (!node)
-		return;
 	assert(!node->nref);
 
 	switch (node->variety) {
 	case NODE_SENTINEL:
-		node_free_body(node);
-		break;
+		node_push_body(node);
+		return;			/* freed once drained */
 	case NODE_ABS:
 	case NODE_FIX:
-		node_free(node_abs_body(node));
+		node_push_body(node_abs_body(node));
 		break;
 	case NODE_LET:
 		/* let bodies aren't connected to chains; free here */
 		assert(node->slots[0].variety == SLOT_BODY);
-		node_free(node->slots[0].subst);
+		node_push_body(node->slots[0].subst);
 		break;
 	case NODE_TEST:
-		node_free(node->slots[SLOT_TEST_CSQ].subst);
-		node_free(node->slots[SLOT_TEST_ALT].subst);
+		node_push_body(node->slots[SLOT_TEST_CSQ].subst);
+		node_push_body(node->slots[SLOT_TEST_ALT].subst);
 		break;
 	case NODE_VAL:
 		if (node->slots[0].variety == SLOT_STRING)
@@ -231,6 +255,34 @@ void node_free(struct node *node)
 	node_heap_free(node);
 }
 
+static void node_free_pending(void)
+{
+	the_free_draining = true;
+	while (the_dead_bodies) {
+		struct node *sentinel = the_dead_bodies, *node = sentinel->next;
+		if (done(node)) {
+			the_dead_bodies = sentinel->forward;
+			node_heap_free(sentinel);
+			continue;
+		}
+
+		/* decrement references as we go */
+		node_remove(node);
+		node_deref(node);
+		node_release(node);
+	}
+	the_free_draining = false;
+}
+
+void node_free(struct node *node)
+{
+	if (!node)
+		return;
+	node_release(node);
+	if (!the_free_draining)
+		node_free_pending();
+}
+
 int node_abs_depth(const struct node *node)
 {
 	int depth;
@@ -288,9 +340,10 @@ void node_wipe_body(struct node *abs)
 	abs->slots[SLOT_ABS_BODY].subst = NULL;		/* wipe body */
 }
 
-static void node_list(const struct node *node, uintptr_t base,
+static void node_list(FILE *out, const struct node *node, uintptr_t base,
 		      unsigned depth, bool star);
-static void node_list_helper(struct node *node, uintptr_t base, unsigned depth);
+static void node_list_helper(FILE *out, struct node *node, uintptr_t base,
+			     unsigned depth);
 
 static void node_list_addr(const struct node *node, intptr_t base,
 			   unsigned char *dst, size_t dstsize)
@@ -302,7 +355,8 @@ static void node_list_addr(const struct node *node, intptr_t base,
 }
 
 static void
-node_list_header(const struct node *node, intptr_t base, unsigned depth)
+node_list_header(FILE *out, const struct node *node, intptr_t base,
+		 unsigned depth)
 {
 	assert(depth >= node->depth);	/* we indent non-abstraction depth */
 	/*
@@ -314,65 +368,68 @@ node_list_header(const struct node *node, intptr_t base, unsigned depth)
 	if (1 || node->nref) {
 		unsigned char buf [BASE64_CONVERT_BUFSIZE];
 		node_list_addr(node, base, buf, sizeof buf);
-		printf("%12s: ", buf);
+		fprintf(out, "%12s: ", buf);
 	} else
-		fputs("              ", stdout);
+		fputs("              ", out);
 	for (unsigned i = 0; i < depth; ++i)
-		fputs("____", stdout);
+		fputs("____", out);
 }
 
-static void node_list_indent(unsigned depth)
+static void node_list_indent(FILE *out, unsigned depth)
 {
-	fputs("              ", stdout);
+	fputs("              ", out);
 	for (unsigned i = 0; i < depth; ++i)
-		fputs("    ", stdout);
+		fputs("    ", out);
 }
 
-static void node_list_slot(struct slot slot, intptr_t base)
+static void node_list_slot(FILE *out, struct slot slot, intptr_t base)
 {
 	unsigned char buf [BASE64_CONVERT_BUFSIZE];
 	switch (slot.variety) {
-	case SLOT_BOUND:	printf("bound[%d.%d]",
-				       slot.bv.up, slot.bv.across);
+	case SLOT_BOUND:	fprintf(out, "bound[%d.%d]",
+					slot.bv.up, slot.bv.across);
+				break;
+	case SLOT_CHURCH:	fprintf(out, "church[%lu]", slot.count); break;
+	case SLOT_FREE:		fputs("free[", out);
+				term_print(out, slot.term);
+				fputs("]", out);
 				break;
-	case SLOT_FREE:		fputs("free[", stdout);
-				term_print(slot.term);
-				fputs("]", stdout);
+	case SLOT_NUM:		fputs("num[", out);
+				num_print(out, slot.num);
+				fputs("]", out);
 				break;
-	case SLOT_NUM:		fputs("num[", stdout);
-				num_print(slot.num);
-				fputs("]", stdout);
+	case SLOT_PRIM:		fprintf(out, "prim[%s]", slot.prim->name);
 				break;
-	case SLOT_PRIM:		printf("prim[%s]", slot.prim->name); break;
-	case SLOT_STRING:	printf("str[%s]", slot.str); break;
+	case SLOT_STRING:	fprintf(out, "str[%s]", slot.str); break;
 	case SLOT_SUBST:	node_list_addr(slot.subst, base,
 					       buf, sizeof buf);
-				printf("^%s", buf);
+				fprintf(out, "^%s", buf);
 				break;
 	default:	panicf("Unhandled slot variety %d\n", slot.variety);
 	}
 }
 
 static void
-node_list_contents(const struct node *node, uintptr_t base, unsigned depth)
+node_list_contents(FILE *out, const struct node *node, uintptr_t base,
+		   unsigned depth)
 {
 	switch (node->variety) {
 	case NODE_CELL:
 		for (size_t i = 0; i < node->nslots; ++i) {
-			fputs(i == 0 ? "[" : " | ", stdout);
-			node_list_slot(node->slots[i], base);
+			fputs(i == 0 ? "[" : " | ", out);
+			node_list_slot(out, node->slots[i], base);
 		}
-		fputs("]\n", stdout);
+		fputs("]\n", out);
 		return;
 	case NODE_TEST:
 		assert(node->nslots == 5);
-		putchar('[');
-		node_list_slot(node->slots[0], base);
-		fputs("? ", stdout);
-		node_list_slot(node->slots[2], base);
-		fputs(" | ", stdout);
-		node_list_slot(node->slots[4], base);
-		fputs("]\n", stdout);
+		fputc('[', out);
+		node_list_slot(out, node->slots[0], base);
+		fputs("? ", out);
+		node_list_slot(out, node->slots[2], base);
+		fputs(" | ", out);
+		node_list_slot(out, node->slots[4], base);
+		fputs("]\n", out);
 		return;
 	default:
 		/* fall through... */;
@@ -381,22 +438,23 @@ node_list_contents(const struct node *node, uintptr_t base, unsigned depth)
 	assert(depth >= node->depth);	/* we indent non-abstraction depth */
 	if (node_is_abs(node)) {
 		for (size_t i = 1; i < node->nslots; ++i)
-			printf("%s%s", i == 1 ? "<" : ",",
-			       symtab_lookup(node->slots[i].name));
-		fputs(">\n", stdout);
+			fprintf(out, "%s%s", i == 1 ? "<" : ",",
+				symtab_lookup(node->slots[i].name));
+		fputs(">\n", out);
 		/* body may have been wiped with node_wipe_body() */
 		if (node_abs_body(node))
-			node_list_helper(node_abs_body(node), base, depth + 1);
+			node_list_helper(out, node_abs_body(node), base,
+					 depth + 1);
 		else
-			fputs("{collected}\n", stdout);
+			fputs("{collected}\n", out);
 		return;
 	}
-	putchar('\n');
+	fputc('\n', out);
 
 	for (size_t i = 0; i < node->nslots; ++i) {
-		node_list_indent(depth);
-		node_list_slot(node->slots[i], base);
-		putchar('\n');
+		node_list_indent(out, depth);
+		node_list_slot(out, node->slots[i], base);
+		fputc('\n', out);
 	}
 }
 
@@ -411,17 +469,17 @@ node_list_contents(const struct node *node, uintptr_t base, unsigned depth)
  * '*' position since we flip the direction of 'prev' pointers during
  * reduction and printing, so we have to be told by the caller.
  */
-static void node_list(const struct node *node, uintptr_t base,
+static void node_list(FILE *out, const struct node *node, uintptr_t base,
 		      unsigned depth, bool star)
 {
 	assert(depth >= node->depth);	/* we indent non-abstraction depth */
-	node_list_header(node, base, depth);
+	node_list_header(out, node, base, depth);
 	if (star) {
 		assert(node->nref == 0);
-		printf("*+%d\t", node->depth);
+		fprintf(out, "*+%d\t", node->depth);
 	} else
-		printf("@+%d#%d\t", node->depth, node->nref);
-	node_list_contents(node, base, depth);
+		fprintf(out, "@+%d#%d\t", node->depth, node->nref);
+	node_list_contents(out, node, base, depth);
 }
 
 /*
@@ -429,7 +487,8 @@ static void node_list(const struct node *node, uintptr_t base,
  * blowing the stack, we use a pointer-reversing traversal as we do
  * in reduction.  First reverse, then print on the way back.
  */
-static void node_list_helper(struct node *node, uintptr_t base, unsigned depth)
+static void node_list_helper(FILE *out, struct node *node, uintptr_t base,
+			     unsigned depth)
 {
 	assert(depth >= node->depth);	/* we indent non-abstraction depth */
 	struct node *rev, *tmp;
@@ -437,59 +496,61 @@ static void node_list_helper(struct node *node, uintptr_t base, unsigned depth)
 	     tmp = node->prev, node->prev = rev, rev = node, node = tmp);
 	for (bool first = true; rev; first = false,
 	     tmp = rev->prev, rev->prev = node, node = rev, rev = tmp)
-		node_list(rev, base, depth, first);
+		node_list(out, rev, base, depth, first);
 	assert(rev == NULL);
 }
 
-void node_list_rl(struct node *node)
+void node_list_rl(FILE *out, struct node *node)
 {
-	node_list_helper(node, (intptr_t) node, 0);
+	node_list_helper(out, node, (intptr_t) node, 0);
 }
 
-static void node_print_body_contents(const struct node *node)
+static void node_print_body_contents(FILE *out, const struct node *node)
 {
 	/* body may have been wiped with node_wipe_body() */
 	if (node) {
 		assert(node->variety == NODE_SENTINEL);
-		node_print_body(node);
+		node_print_body(out, node);
 	} else
-		fputs("{collected}", stdout);
+		fputs("{collected}", out);
 }
 
-static void node_print_slot(struct slot slot)
+static void node_print_slot(FILE *out, struct slot slot)
 {
 	switch (slot.variety) {
-	case SLOT_BODY:		putchar('(');
-				node_print_body_contents(slot.subst);
-				putchar(')');
+	case SLOT_BODY:		fputc('(', out);
+				node_print_body_contents(out, slot.subst);
+				fputc(')', out);
 				break;
-	case SLOT_BOUND:	printf("$%d.%d", slot.bv.up, slot.bv.across);
+	case SLOT_BOUND:	fprintf(out, "$%d.%d",
+					slot.bv.up, slot.bv.across);
 				break;
-	case SLOT_FREE:		term_print(slot.term); break;
-	case SLOT_NUM:		num_print(slot.num); break;
-	case SLOT_PRIM:		printf("'%s'", slot.prim->name); break;
-	case SLOT_STRING:	printf("\"%s\"", slot.str); break;
-	case SLOT_SUBST:	printf("^%s", memloc(slot.subst)); break;
+	case SLOT_CHURCH:	fprintf(out, "church[%lu]", slot.count); break;
+	case SLOT_FREE:		term_print(out, slot.term); break;
+	case SLOT_NUM:		num_print(out, slot.num); break;
+	case SLOT_PRIM:		fprintf(out, "'%s'", slot.prim->name); break;
+	case SLOT_STRING:	fprintf(out, "\"%s\"", slot.str); break;
+	case SLOT_SUBST:	fprintf(out, "^%s", memloc(slot.subst)); break;
 	default:	panicf("Unhandled slot variety %d\n", slot.variety);
 	}
 }
 
-static void node_print_contents(const struct node *node)
+static void node_print_contents(FILE *out, const struct node *node)
 {
 	switch (node->variety) {
 	case NODE_CELL:
 		for (size_t i = 0; i < node->nslots; ++i) {
-			if (i) fputs(" | ", stdout);
-			node_print_slot(node->slots[i]);
+			if (i) fputs(" | ", out);
+			node_print_slot(out, node->slots[i]);
 		}
 		return;
 	case NODE_TEST:
 		assert(node->nslots == 3);
-		node_print_slot(node->slots[0]);	/* predicate */
-		fputs("? ", stdout);
-		node_print_body_contents(node->slots[SLOT_TEST_CSQ].subst);
-		fputs(" | ", stdout);
-		node_print_body_contents(node->slots[SLOT_TEST_ALT].subst);
+		node_print_slot(out, node->slots[0]);	/* predicate */
+		fputs("? ", out);
+		node_print_body_contents(out, node->slots[SLOT_TEST_CSQ].subst);
+		fputs(" | ", out);
+		node_print_body_contents(out, node->slots[SLOT_TEST_ALT].subst);
 		return;
 	default:
 		/* fall through... */;
@@ -497,43 +558,43 @@ static void node_print_contents(const struct node *node)
 
 	if (node_is_abs(node)) {
 		for (size_t i = 1; i < node->nslots; ++i)
-			printf("%s%s", i == 1 ? "<" : ",",
-			       symtab_lookup(node->slots[i].name));
-		fputs(">.", stdout);
-		node_print_body_contents(node_abs_body(node));
+			fprintf(out, "%s%s", i == 1 ? "<" : ",",
+				symtab_lookup(node->slots[i].name));
+		fputs(">.", out);
+		node_print_body_contents(out, node_abs_body(node));
 		return;
 	}
 
 	assert(node->nslots);
-	node_print_slot(node->slots[0]);
+	node_print_slot(out, node->slots[0]);
 	for (size_t i = 1; i < node->nslots; ++i) {
-		fputs(i == 1 ? " (" : ", ", stdout);
-		node_print_slot(node->slots[i]);
+		fputs(i == 1 ? " (" : ", ", out);
+		node_print_slot(out, node->slots[i]);
 	}
-	if (node->nslots > 1) putchar(')');
+	if (node->nslots > 1) fputc(')', out);
 }
 
-static void node_print(const struct node *node)
+static void node_print(FILE *out, const struct node *node)
 {
-	printf("[@%s+%d#%d ", memloc(node), node->depth, node->nref);
-	node_print_contents(node);
-	putchar(']');
+	fprintf(out, "[@%s+%d#%d ", memloc(node), node->depth, node->nref);
+	node_print_contents(out, node);
+	fputc(']', out);
 }
 
-void node_print_body(const struct node *node)
+void node_print_body(FILE *out, const struct node *node)
 {
 	assert(node->variety == NODE_SENTINEL);
 	for (node = node->next; !done(node); node = node->next)
-		node_print(node);
+		node_print(out, node);
 }
 
-void node_print_after(const struct node *node)
+void node_print_after(FILE *out, const struct node *node)
 {
 	for (/* nada */; !done(node); node = node->next)
-		node_print(node);
+		node_print(out, node);
 }
 
-void node_print_until(const struct node *node)
+void node_print_until(FILE *out, const struct node *node)
 {
 	/* XXX this is inelegant */
 	if (done(node)) return;
@@ -542,6 +603,6 @@ void node_print_until(const struct node *node)
 	assert(curr->variety == NODE_SENTINEL);
 	do {
 		curr = curr->next;
-		node_print(curr);
+		node_print(out, curr);
 	} while (curr != node);
 }
@@ -24,6 +24,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 #include <util/symtab.h>
 
@@ -37,6 +38,7 @@ enum slot_variety {
 	SLOT_INVALID,
 	SLOT_BODY,	/* subexpression e.g. function body */
 	SLOT_BOUND,	/* bound variable, De Bruijn indexed */
+	SLOT_CHURCH,	/* Church numeral, as native count */
 	SLOT_FREE,	/* free variable, as uninterpreted symbol */
 	SLOT_NULL,	/* placeholder for missing value */
 	SLOT_NUM,	/* floating-point number */
@@ -52,6 +54,7 @@ struct slot {
 		struct { int up, across; } bv;
 		symbol_mt name;		/* free vars & formal params */
 		double num;
+		unsigned long count;
 		const struct prim *prim;
 		struct node *subst;
 		const char *str;
@@ -112,8 +115,10 @@ enum node_variety {
 struct node {
 	enum node_variety variety;
 	bool isfresh;		/* freshly allocated subst? (not a copy) */
+	unsigned char church;	/* Church combinator (see church.h) */
 	int depth,		/* abstraction depth */
 	    nref;		/* reference count for gc */
+	symbol_mt origin;	/* defining name, for profiling */
 	size_t nslots;		/* slot count for this node */
 	struct node *prev, *next;	/* for doubly-linked node chains */
 	union {
@@ -137,6 +142,8 @@ static inline bool node_is_binder(const struct node *node)
 		 node->variety == NODE_LET; }
 static inline bool node_is_prim(const struct node *node)
 	{ return node->slots[0].variety == SLOT_PRIM; }
+static inline bool node_is_church(const struct node *node)
+	{ return node->slots[0].variety == SLOT_CHURCH; }
 static inline struct node *node_abs_body(const struct node *abs)
 	{ return abs->slots[SLOT_ABS_BODY].subst; }
 static inline size_t node_app_nargs(const struct node *app)
@@ -153,6 +160,7 @@ struct node *NodeAbs(struct node *prev, int depth, struct node *body,
 struct node *NodeApp(struct node *prev, int depth, size_t nargs);
 struct node *NodeBoundVar(struct node *prev, int depth, int up, int across);
 struct node *NodeCell(struct node *prev, int depth, size_t n);
+struct node *NodeChurch(struct node *prev, int depth, unsigned long count);
 struct node *NodeFreeVar(struct node *prev, int depth, struct term *var);
 struct node *NodeGeneric(struct node *prev, int depth, size_t nslots);
 struct node *NodeLet(struct node *prev, int depth, size_t ndefs);
@@ -172,10 +180,10 @@ extern void node_replace(struct node *node, struct node *dest);
 extern void node_wipe_body(struct node *abs);
 
 	/* XXX {list,print}_rl are non-const b/c ptr reversing */
-extern void node_list_rl(struct node *node);
-extern void node_print_body(const struct node *node);
-extern void node_print_after(const struct node *node);
-extern void node_print_until(const struct node *node);
+extern void node_list_rl(FILE *out, struct node *node);
+extern void node_print_body(FILE *out, const struct node *node);
+extern void node_print_after(FILE *out, const struct node *node);
+extern void node_print_until(FILE *out, const struct node *node);
 extern struct node *node_take_body(struct node *abs);
 
 #endif /* LARK_MLC_NODE_H */
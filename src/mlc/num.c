@@ -26,11 +26,11 @@
 
 #include "num.h"
 
-void num_print(double num)
+void num_print(FILE *out, double num)
 {
 	double intpart;
 	if (fabs(num) < INT64_MAX && !modf(num, &intpart))
-		printf("%"PRIi64, (int64_t) intpart);
+		fprintf(out, "%"PRIi64, (int64_t) intpart);
 	else
-		printf("%g", num);
+		fprintf(out, "%g", num);
 }
@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-extern void num_print(double num);
+#include <stdio.h>
+
+extern void num_print(FILE *out, double num);
 
 #endif /* LARK_MLC_NUM_H */
@@ -24,33 +24,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <util/memutil.h>
 #include <util/message.h>
 
+#include "cache.h"
+#include "ctx.h"
 #include "mlc.h"
 #include "mlc.lex.h"
 #include "parse.h"
 
-int parse_file(const char *pathname)
+/*
+ * Regular files are mapped into memory and scanned in place, so a
+ * library costs one pass over the page cache rather than a copy through
+ * stdio and then another into flex's buffer.  The mapping is private
+ * and writable because flex writes into its buffer while scanning, and
+ * the file is mapped over a slightly larger anonymous mapping to supply
+ * the two trailing NULs flex requires.
+ */
+static char *map_input(FILE *fin, size_t *size)
 {
-	FILE *input = strcmp(pathname, "-") ? fopen(pathname, "r") : stdin;
-	if (!input)
-		return xperror(pathname);
+	int fd = fileno(fin);
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+	    lseek(fd, 0, SEEK_CUR) != 0)
+		return NULL;
 
+	size_t len = st.st_size;
+	char *base = mmap(NULL, len + 2, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+	if (len && mmap(base, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, len + 2);
+		return NULL;
+	}
+	*size = len + 2;
+	return base;
+}
+
+/*
+ * Other input (pipes, terminals) is read through a large block buffer.
+ */
+#define PARSE_STREAM_BUFSIZE (1 << 16)
+
+static int parse_stream(struct mlc_ctx *ctx, FILE *fin)
+{
 	struct scanner_state scanner;
-	mlc_scan_init(&scanner);
-	mlc_yyrestart(input, scanner.flexstate);
-	int retval = mlc_yyparse(scanner.flexstate);
+	mlc_scan_init(&scanner, ctx->err);
+
+	size_t size;
+	char *base = map_input(fin, &size);
+	if (base)
+		mlc_scan_buffer(base, size, &scanner);
+	else {
+		setvbuf(fin, NULL, _IOFBF, PARSE_STREAM_BUFSIZE);
+		mlc_yyrestart(fin, scanner.flexstate);
+	}
+	int retval = mlc_yyparse(scanner.flexstate, ctx);
 	mlc_scan_fini(&scanner);
+	if (base)
+		munmap(base, size);
+	return retval;
+}
+
+int parse_file(struct mlc_ctx *ctx, const char *pathname)
+{
+	FILE *input = strcmp(pathname, "-") ? fopen(pathname, "r") : stdin;
+	if (!input) {
+		int err = -errno;
+		fprintf(ctx->err, "%s: %s: %s\n", execname, pathname,
+			strerror(-err));
+		return err;
+	}
+
+	int retval = parse_stream(ctx, input);
 	if (input != stdin) fclose(input);
 	return retval;
 }
 
-int parse_include(const char *pathname)
+int parse_include(struct mlc_ctx *ctx, const char *pathname)
 {
 	char *envpaths = getenv("MLC_INCLUDE");
+	char *found = NULL;
 	FILE *fin = NULL;
 
+	cache_note_include(ctx, pathname);
 	if (envpaths) {
 		char pathbuf [strlen(envpaths) + 1], *allpaths = pathbuf;
 		strcpy(pathbuf, envpaths);
@@ -61,14 +124,15 @@ int parse_include(const char *pathname)
 			char *p = stpcpy(curname, curpath);
 			*p++ = '/';
 			strcpy(p, pathname);
-			fin = fopen(curname, "r");
+			if ((fin = fopen(curname, "r")))
+				found = xstrdup(curname);
 		}
 		if (!fin) {
 			/*
 			 * We can't use pathbuf in this error message since
 			 * it has been modified by the calls to strsep().
 			 */
-			fprintf(stderr, "Include: No such file: %s in %s\n",
+			fprintf(ctx->err, "Include: No such file: %s in %s\n",
 				pathname, envpaths);
 			return -1;
 		}
@@ -76,32 +140,43 @@ int parse_include(const char *pathname)
 	} else {
 		fin = fopen(pathname, "r");
 		if (!fin) {
-			fprintf(stderr, "Include: %s: %s\n",
+			fprintf(ctx->err, "Include: %s: %s\n",
 				pathname, strerror(errno));
 			return -1;
 		}
+		found = xstrdup(pathname);
 	}
 
-	struct scanner_state scanner;
-	mlc_scan_init(&scanner);
-	mlc_yyrestart(fin, scanner.flexstate);
-	int retval = 0;
-	if (mlc_yyparse(scanner.flexstate)) {
-		fprintf(stderr, "File include failed (parse error): %s\n",
-			pathname);
-		retval = -1;
+	/*
+	 * Replay the library's compiled artifact if it's current;
+	 * otherwise parse it, saving an artifact if possible.
+	 */
+	struct cache_key key;
+	int retval = cache_load(ctx, found, &key);
+	if (retval > 0) {
+		cache_compile_begin(ctx);
+		retval = parse_stream(ctx, fin) ? 1 : 0;
+		cache_compile_end(ctx, &key, !retval);
 	}
-	mlc_scan_fini(&scanner);
+	if (retval)
+		fprintf(ctx->err, "File include failed (parse error): %s\n",
+			pathname);
 	fclose(fin);
+	xfree(found);
 	return retval;
 }
 
-int parse_stdin(void)
+int parse_string(struct mlc_ctx *ctx, const char *text)
 {
 	struct scanner_state scanner;
-	mlc_scan_init(&scanner);
-	mlc_yyrestart(stdin, scanner.flexstate);
-	int retval = mlc_yyparse(scanner.flexstate);
+	mlc_scan_init(&scanner, ctx->err);
+	mlc_scan_string(text, &scanner);
+	int retval = mlc_yyparse(scanner.flexstate, ctx);
 	mlc_scan_fini(&scanner);
 	return retval;
 }
+
+int parse_stdin(struct mlc_ctx *ctx)
+{
+	return parse_stream(ctx, stdin);
+}
@@ -22,8 +22,15 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-extern int parse_file(const char *pathname);
-extern int parse_include(const char *pathname);
-extern int parse_stdin(void);
+struct mlc_ctx;
+
+/*
+ * Each returns zero on success, negative if the input couldn't be
+ * read, or positive on a parse error.
+ */
+extern int parse_file(struct mlc_ctx *ctx, const char *pathname);
+extern int parse_include(struct mlc_ctx *ctx, const char *pathname);
+extern int parse_stdin(struct mlc_ctx *ctx);
+extern int parse_string(struct mlc_ctx *ctx, const char *text);
 
 #endif /* LARK_MLC_PARSE_H */
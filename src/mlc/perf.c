@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <util/message.h>
+
+#include "heap.h"
+#include "perf.h"
+#include "reduce.h"
+
+static struct perf_costs {
+	unsigned long reductions, eval_rl, beta, rename, test, zeta, prim;
+	unsigned long node_allocs, nodes_peak;
+} the_perf_costs;
+
+static unsigned long the_allocs_at_begin;
+
+/*
+ * Heap statistics are reset before each reduction, but allocations
+ * counted at reset include nodes already live, so we take our own
+ * starting point after the reset.
+ */
+void perf_begin_reduction(void)
+{
+	the_allocs_at_begin = node_heap_allocs();
+}
+
+void perf_end_reduction(void)
+{
+	const struct eval_stats *stats = current_eval_stats();
+	the_perf_costs.reductions += stats->reduce_start;
+	the_perf_costs.eval_rl += stats->eval_rl;
+	the_perf_costs.beta += stats->rule_beta;
+	the_perf_costs.rename += stats->rule_rename;
+	the_perf_costs.test += stats->rule_test;
+	the_perf_costs.zeta += stats->rule_zeta;
+	the_perf_costs.prim += stats->rule_prim;
+	the_perf_costs.node_allocs += node_heap_allocs() - the_allocs_at_begin;
+	if (node_heap_peak() > the_perf_costs.nodes_peak)
+		the_perf_costs.nodes_peak = node_heap_peak();
+}
+
+int write_perf(const char *pathname)
+{
+	FILE *fout = fopen(pathname, "w");
+	if (!fout)
+		return xperror(pathname);
+	fprintf(fout,
+		"reductions %lu\n"
+		"eval_rl %lu\n"
+		"beta %lu\n"
+		"rename %lu\n"
+		"test %lu\n"
+		"zeta %lu\n"
+		"prim %lu\n"
+		"allocs %lu\n"
+		"peak %lu\n",
+		the_perf_costs.reductions,
+		the_perf_costs.eval_rl,
+		the_perf_costs.beta,
+		the_perf_costs.rename,
+		the_perf_costs.test,
+		the_perf_costs.zeta,
+		the_perf_costs.prim,
+		the_perf_costs.node_allocs,
+		the_perf_costs.nodes_peak);
+	if (fclose(fout))
+		return xperror(pathname);
+	return 0;
+}
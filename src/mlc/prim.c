@@ -23,12 +23,15 @@
 #include <assert.h>
 #include <math.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <util/memutil.h>
 #include <util/message.h>
 
 #include "node.h"
 #include "prim.h"
+#include "profile.h"
+#include "term.h"
 
 enum prim_variety {
 	PRIM_INVALID,
@@ -68,6 +71,17 @@ enum prim_variety {
  * variety and nslots works.
  */
 
+/*
+ * Nodes allocated by primitives are charged to the definition which
+ * contained the redex.
+ */
+static struct node *prim_charge(struct node *redex, struct node *node)
+{
+	node->origin = redex->origin;
+	if (profile_setting) profile_alloc(node->origin, node->nslots);
+	return node;
+}
+
 static struct node *
 prim_replace_redex(struct node *redex, struct node *val)
 {
@@ -188,48 +202,70 @@ static bool known_string(const struct node *redex, size_t i, const char **str)
 	return false;
 }
 
-static struct node *prim_reduce_arith1(unsigned variety, struct node *redex)
+/*
+ * Operations shared by reduction (on nodes) and folding (on terms).
+ */
+static double prim_arith1(unsigned variety, double arg)
 {
-	double arg, val;
-	if (!(	redex->nslots == 2 &&
-		known_num(redex, 1, &arg)))
-		return redex->prev;
 	switch ((enum prim_variety) variety) {
 	case PRIM_IS_INTEGRAL: {
 		double intpart;
-		val = !modf(arg, &intpart);
-		break;
+		return !modf(arg, &intpart);
 	}
-	case PRIM_NOT:	val = !arg; break;
+	case PRIM_NOT:	return !arg;
 	default: panicf("Unhandled primitive variety %u\n", variety);
 	}
-	return prim_return_num(redex, val);
+}
+
+static double prim_arith2(unsigned variety, double lhs, double rhs)
+{
+	switch ((enum prim_variety) variety) {
+	case PRIM_ADD:	return lhs + rhs;
+	case PRIM_SUB:	return lhs - rhs;
+	case PRIM_MULT:	return lhs * rhs;
+	case PRIM_DIV:	return lhs / rhs;
+	case PRIM_EQ:	return lhs == rhs;
+	case PRIM_NE:	return lhs != rhs;
+	case PRIM_LT:	return lhs <  rhs;
+	case PRIM_LTE:	return lhs <= rhs;
+	case PRIM_GT:	return lhs >  rhs;
+	case PRIM_GTE:	return lhs >= rhs;
+	case PRIM_AND:	return lhs && rhs;
+	case PRIM_OR:	return lhs || rhs;
+	case PRIM_XOR:	return !lhs ^ !rhs;	/* logical XOR */
+	default: panicf("Unhandled primitive variety %u\n", variety);
+	}
+}
+
+static char *prim_str2(unsigned variety, const char *lhs, const char *rhs)
+{
+	switch ((enum prim_variety) variety) {
+	case PRIM_CONCAT: {
+		char *val = xmalloc(strlen(lhs) + strlen(rhs) + 1);
+		strcpy(stpcpy(val, lhs), rhs);
+		return val;
+	}
+	default: panicf("Unhandled primitive variety %u\n", variety);
+	}
+}
+
+static struct node *prim_reduce_arith1(unsigned variety, struct node *redex)
+{
+	double arg;
+	if (!(	redex->nslots == 2 &&
+		known_num(redex, 1, &arg)))
+		return redex->prev;
+	return prim_return_num(redex, prim_arith1(variety, arg));
 }
 
 static struct node *prim_reduce_arith2(unsigned variety, struct node *redex)
 {
-	double lhs, rhs, val;
+	double lhs, rhs;
 	if (!(	redex->nslots == 3 &&
 		known_num(redex, 1, &lhs) &&
 		known_num(redex, 2, &rhs)))
 		return redex->prev;
-	switch ((enum prim_variety) variety) {
-	case PRIM_ADD:	val = lhs + rhs; break;
-	case PRIM_SUB:	val = lhs - rhs; break;
-	case PRIM_MULT:	val = lhs * rhs; break;
-	case PRIM_DIV:	val = lhs / rhs; break;
-	case PRIM_EQ:	val = lhs == rhs; break;
-	case PRIM_NE:	val = lhs != rhs; break;
-	case PRIM_LT:	val = lhs <  rhs; break;
-	case PRIM_LTE:	val = lhs <= rhs; break;
-	case PRIM_GT:	val = lhs >  rhs; break;
-	case PRIM_GTE:	val = lhs >= rhs; break;
-	case PRIM_AND:	val = lhs && rhs; break;
-	case PRIM_OR:	val = lhs || rhs; break;
-	case PRIM_XOR:	val = !lhs ^ !rhs; break;	/* logical XOR */
-	default: panicf("Unhandled primitive variety %u\n", variety);
-	}
-	return prim_return_num(redex, val);
+	return prim_return_num(redex, prim_arith2(variety, lhs, rhs));
 }
 
 static struct node *prim_reduce_at(unsigned variety, struct node *redex)
@@ -261,7 +297,8 @@ static struct node *prim_reduce_cell(unsigned variety, struct node *redex)
 	if (k.variety == SLOT_SUBST) k.subst->nref += nelems;
 
 	/* could hypothetically recycle in some cases */
-	struct node *cell = NodeCell(redex->prev, redex->depth, nelems);
+	struct node *cell = prim_charge(redex,
+		NodeCell(redex->prev, redex->depth, nelems));
 	for (size_t i = 0; i < nelems; ++i) cell->slots[i] = k;
 	return prim_replace_redex(redex, cell);
 }
@@ -293,13 +330,15 @@ static struct node *prim_reduce_fill(unsigned variety, struct node *redex)
 	 * otherwise we could recycle the redex.  Not pursuing that
 	 * microoptimization at the moment, for simplicity.
 	 */
-	struct node *cell = NodeCell(redex->prev, redex->depth, nelems),
-		    *prev = cell;
+	struct node *cell = prim_charge(redex,
+		NodeCell(redex->prev, redex->depth, nelems)), *prev = cell;
 	for (size_t i = 0; i < nelems; ++i) {
 
 		/* create and link arguments */
-		struct node *app = NodeApp(prev, redex->depth, 1);
-		struct node *arg = NodeNum(app, redex->depth, i);
+		struct node *app = prim_charge(redex,
+			NodeApp(prev, redex->depth, 1));
+		struct node *arg = prim_charge(redex,
+			NodeNum(app, redex->depth, i));
 		prev->next = app, app->next = arg;
 		prev = arg;
 
@@ -392,7 +431,8 @@ static struct node *prim_reduce_fuse(unsigned variety, struct node *redex)
 	 * microoptimization at the moment, for simplicity.
 	 */
 	size_t nslots = cell0->nslots + cell1->nslots;
-	struct node *cell = NodeCell(redex->prev, redex->depth, nslots);
+	struct node *cell = prim_charge(redex,
+		NodeCell(redex->prev, redex->depth, nslots));
 	size_t i = 0;
 	for (size_t j = 0; j < cell0->nslots; ++i, ++j) {
 		cell->slots[i] = cell0->slots[j];
@@ -444,20 +484,40 @@ static struct node *prim_reduce_pair(unsigned variety, struct node *redex)
 static struct node *prim_reduce_str2(unsigned variety, struct node *redex)
 {
 	const char *lhs, *rhs;
-	char *val;
 	if (!(	redex->nslots == 3 &&
 		known_string(redex, 1, &lhs) &&
 		known_string(redex, 2, &rhs)))
 		return redex->prev;
-	switch ((enum prim_variety) variety) {
-	case PRIM_CONCAT: {
-		val = xmalloc(strlen(lhs) + strlen(rhs) + 1);
-		strcpy(stpcpy(val, lhs), rhs);
-		break;
-	}
-	default: panicf("Unhandled primitive variety %u\n", variety);
-	}
-	return prim_return_string(redex, val);
+	return prim_return_string(redex, prim_str2(variety, lhs, rhs));
+}
+
+static struct term *
+prim_fold_arith1(unsigned variety, size_t nargs, struct term **args)
+{
+	if (!(	nargs == 1 &&
+		args[0]->variety == TERM_NUM))
+		return NULL;
+	return TermNum(prim_arith1(variety, args[0]->num));
+}
+
+static struct term *
+prim_fold_arith2(unsigned variety, size_t nargs, struct term **args)
+{
+	if (!(	nargs == 2 &&
+		args[0]->variety == TERM_NUM &&
+		args[1]->variety == TERM_NUM))
+		return NULL;
+	return TermNum(prim_arith2(variety, args[0]->num, args[1]->num));
+}
+
+static struct term *
+prim_fold_str2(unsigned variety, size_t nargs, struct term **args)
+{
+	if (!(	nargs == 2 &&
+		args[0]->variety == TERM_STRING &&
+		args[1]->variety == TERM_STRING))
+		return NULL;
+	return TermString(prim_str2(variety, args[0]->str, args[1]->str));
 }
 
 static struct node *prim_reduce_test(unsigned variety, struct node *redex)
@@ -488,6 +548,7 @@ struct prim prim_add = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "+",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_sub = {
@@ -495,6 +556,7 @@ struct prim prim_sub = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "-",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_mult = {
@@ -502,6 +564,7 @@ struct prim prim_mult = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "*",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_div = {
@@ -509,6 +572,7 @@ struct prim prim_div = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "/",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_eq = {
@@ -516,6 +580,7 @@ struct prim prim_eq = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "==",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_ne = {
@@ -523,6 +588,7 @@ struct prim prim_ne = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "<>",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_lt = {
@@ -530,6 +596,7 @@ struct prim prim_lt = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "<",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_lte = {
@@ -537,6 +604,7 @@ struct prim prim_lte = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "<=",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_gt = {
@@ -544,6 +612,7 @@ struct prim prim_gt = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = ">",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_gte = {
@@ -551,6 +620,7 @@ struct prim prim_gte = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = ">=",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_and = {
@@ -558,6 +628,7 @@ struct prim prim_and = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$and",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_or = {
@@ -565,6 +636,7 @@ struct prim prim_or = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$or",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_xor = {
@@ -572,6 +644,7 @@ struct prim prim_xor = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$xor",
 	.reduce = prim_reduce_arith2,
+	.fold = prim_fold_arith2,
 };
 
 struct prim prim_not = {
@@ -579,6 +652,7 @@ struct prim prim_not = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$not",
 	.reduce = prim_reduce_arith1,
+	.fold = prim_fold_arith1,
 };
 
 struct prim prim_is_integral = {
@@ -586,6 +660,7 @@ struct prim prim_is_integral = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$is-integral",
 	.reduce = prim_reduce_arith1,
+	.fold = prim_fold_arith1,
 };
 
 struct prim prim_concat = {
@@ -593,6 +668,7 @@ struct prim prim_concat = {
 	.syntax = PRIM_SYNTAX_OP2,
 	.name = "++",
 	.reduce = prim_reduce_str2,
+	.fold = prim_fold_str2,
 };
 
 struct prim prim_at = {
@@ -683,3 +759,38 @@ struct prim prim_panic = {
 	.syntax = PRIM_SYNTAX_FUNCTION,
 	.name = "$panic",
 };
+
+static const struct prim *const all_prims [] = {
+	&prim_add, &prim_sub, &prim_mult, &prim_div,
+	&prim_eq, &prim_ne, &prim_lt, &prim_lte, &prim_gt, &prim_gte,
+	&prim_and, &prim_or, &prim_xor, &prim_not,
+	&prim_is_integral,
+	&prim_concat,
+	&prim_at, &prim_cell, &prim_fill, &prim_find, &prim_fuse,
+	&prim_is_cell, &prim_nelems,
+	&prim_car, &prim_cdr, &prim_is_nil, &prim_is_pair,
+	&prim_undefined, &prim_panic,
+};
+
+const struct prim *prim_lookup(const char *name)
+{
+	for (size_t i = 0; i < sizeof all_prims / sizeof all_prims[0]; ++i)
+		if (!strcmp(all_prims[i]->name, name))
+			return all_prims[i];
+	return NULL;
+}
+
+size_t prim_num_arity(const struct prim *prim)
+{
+	return	prim->reduce == prim_reduce_arith1 ? 1 :
+		prim->reduce == prim_reduce_arith2 ? 2 : 0;
+}
+
+double prim_apply_num(const struct prim *prim, const double *args)
+{
+	switch (prim_num_arity(prim)) {
+	case 1: return prim_arith1(prim->variety, args[0]);
+	case 2: return prim_arith2(prim->variety, args[0], args[1]);
+	default: panicf("Not a numeric primitive: %s\n", prim->name);
+	}
+}
@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stddef.h>
+
 enum prim_syntax {
 	PRIM_SYNTAX_INVALID,
 	PRIM_SYNTAX_ATOM,
@@ -31,12 +33,20 @@ enum prim_syntax {
 };
 
 struct node;
+struct term;
 
+/*
+ * 'fold' is optional; when present it evaluates the primitive on terms
+ * before flattening, returning NULL if the arguments aren't literals
+ * it can handle (see fold.c).
+ */
 struct prim {
 	unsigned variety;
 	enum prim_syntax syntax;
 	const char *name;
 	struct node *(*reduce)(unsigned variety, struct node *);
+	struct term *(*fold)(unsigned variety, size_t nargs,
+			     struct term **args);
 };
 
 extern struct prim
@@ -65,4 +75,14 @@ extern struct prim
 
 	prim_undefined, prim_panic;
 
+extern const struct prim *prim_lookup(const char *name);
+
+/*
+ * Numeric primitives applied to already-evaluated arguments, for
+ * compiled execution (see compile.c).  prim_num_arity() returns 0 if
+ * 'prim' doesn't operate on numbers alone.
+ */
+extern size_t prim_num_arity(const struct prim *prim);
+extern double prim_apply_num(const struct prim *prim, const double *args);
+
 #endif /* LARK_MLC_PRIM_H */
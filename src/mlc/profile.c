@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/bytebuf.h>
+#include <util/hashtab.h>
+#include <util/memutil.h>
+#include <util/message.h>
+#include <util/wordbuf.h>
+#include <util/wordtab.h>
+
+#include "heap.h"
+#include "node.h"
+#include "profile.h"
+
+#define PROFILE_SIZE_HINT 100
+
+bool profile_setting = false;
+
+struct profile_entry {
+	symbol_mt origin;
+	unsigned long betas, copies, allocs, bytes;
+};
+
+/*
+ * Folded stacks are keyed by their text in a table of our own rather
+ * than interned, so they don't accumulate in the global symbol table.
+ */
+static struct wordtab the_profile;
+static struct hashtab the_folded_stacks;
+static bool profile_initialized = false;
+
+static void profile_init(void)
+{
+	wordtab_init(&the_profile, PROFILE_SIZE_HINT);
+	hashtab_init(&the_folded_stacks, PROFILE_SIZE_HINT);
+	profile_initialized = true;
+}
+
+static struct profile_entry *profile_get(symbol_mt origin)
+{
+	if (!profile_initialized)
+		profile_init();
+	struct profile_entry *pe = wordtab_get(&the_profile, origin);
+	if (!pe) {
+		pe = xmalloc(sizeof *pe);
+		pe->origin = origin;
+		pe->betas = pe->copies = pe->allocs = pe->bytes = 0;
+		wordtab_put(&the_profile, origin, pe);
+	}
+	return pe;
+}
+
+static const char *origin_name(symbol_mt origin)
+{
+	return origin ? symtab_lookup(origin) : "(toplevel)";
+}
+
+void profile_alloc(symbol_mt origin, size_t nslots)
+{
+	struct profile_entry *pe = profile_get(origin);
+	pe->allocs++;
+	pe->bytes += node_heap_bytes(nslots);
+}
+
+/*
+ * Build the folded stack for this beta-reduction by walking outward
+ * through the enclosing abstractions, then emitting frames outermost-
+ * first.  Adjacent frames with the same origin are collapsed, since
+ * a single definition typically contributes several nested binders.
+ */
+void profile_beta(symbol_mt origin, const struct node *outer)
+{
+	profile_get(origin)->betas++;
+
+	struct wordbuf frames;
+	wordbuf_init(&frames);
+	wordbuf_push(&frames, origin);
+	for (/* nada */; outer; outer = outer->outer)
+		if (outer->origin !=
+		    wordbuf_at(&frames, wordbuf_used(&frames) - 1))
+			wordbuf_push(&frames, outer->origin);
+
+	struct bytebuf stack;
+	bytebuf_init(&stack);
+	for (size_t i = wordbuf_used(&frames); i--; /* nada */) {
+		const char *name = origin_name(wordbuf_at(&frames, i));
+		bytebuf_append_string(&stack, name, strlen(name));
+		bytebuf_append_char(&stack, i ? ';' : '\0');
+	}
+	size_t keysize = bytebuf_used(&stack);
+	word count = (word) hashtab_get(&the_folded_stacks,
+					stack.data, keysize);
+	const void *key = count ? stack.data : xmemdup(stack.data, keysize);
+	hashtab_put(&the_folded_stacks, key, keysize, (void*) (count + 1));
+	bytebuf_fini(&stack);
+	wordbuf_fini(&frames);
+}
+
+void profile_copy(symbol_mt origin, size_t nslots)
+{
+	profile_get(origin)->copies++;
+	profile_alloc(origin, nslots);
+}
+
+static int profile_entry_cmp(const void *a, const void *b)
+{
+	const struct profile_entry
+		*pa = *(const struct profile_entry *const *) a,
+		*pb = *(const struct profile_entry *const *) b;
+	if (pa->betas != pb->betas)
+		return pa->betas < pb->betas ? +1 : -1;
+	if (pa->bytes != pb->bytes)
+		return pa->bytes < pb->bytes ? +1 : -1;
+	return strcmp(origin_name(pa->origin), origin_name(pb->origin));
+}
+
+void print_profile(FILE *out)
+{
+	if (!profile_initialized)
+		profile_init();
+
+	struct wordbuf entries;
+	wordbuf_init(&entries);
+	struct wordtab_iter iter;
+	wordtab_iter_init(&the_profile, &iter);
+	struct wordtab_entry *entry;
+	while ((entry = wordtab_iter_next(&iter)))
+		wordbuf_push(&entries, (word) entry->data);
+
+	size_t n = wordbuf_used(&entries);
+	qsort(entries.data, n, sizeof entries.data[0], profile_entry_cmp);
+	fprintf(out,
+	"\t\t\tDEFINITION PROFILE\n"
+	"\t\t\t==================\n"
+	"%-24s %12s %12s %12s %12s\n",
+	"definition", "betas", "copies", "allocs", "bytes");
+	for (size_t i = 0; i < n; ++i) {
+		const struct profile_entry *pe =
+			(const struct profile_entry *) wordbuf_at(&entries, i);
+		fprintf(out, "%-24s %12lu %12lu %12lu %12lu\n",
+			origin_name(pe->origin),
+			pe->betas, pe->copies, pe->allocs, pe->bytes);
+	}
+	wordbuf_fini(&entries);
+}
+
+/*
+ * Per-definition counters are reset for each statement, as are the
+ * evaluation statistics; folded stacks accumulate over the entire run.
+ */
+void reset_profile(void)
+{
+	if (!profile_initialized)
+		return;
+	wordtab_free_all_data(&the_profile);
+	wordtab_fini(&the_profile);
+	wordtab_init(&the_profile, PROFILE_SIZE_HINT);
+}
+
+int write_profile_folded(const char *pathname)
+{
+	FILE *fout = fopen(pathname, "w");
+	if (!fout)
+		return xperror(pathname);
+	if (profile_initialized) {
+		struct hashtab_iter iter;
+		hashtab_iter_init(&the_folded_stacks, &iter);
+		struct hashtab_entry *entry;
+		while ((entry = hashtab_iter_next(&iter)))
+			fprintf(fout, "%s %lu\n", (const char *) entry->key,
+				(unsigned long) (word) entry->data);
+	}
+	if (fclose(fout))
+		return xperror(pathname);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef LARK_MLC_PROFILE_H
+#define LARK_MLC_PROFILE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Definition-level cost attribution.  Terms installed in the global
+ * environment are tagged with the name they were defined under; that
+ * tag (the 'origin') is carried from terms to nodes by flattening and
+ * from nodes to nodes by copying, so reduction costs can be charged
+ * back to the library definitions which incurred them.  Terms and
+ * nodes from toplevel statements have origin 0 (no definition).
+ *
+ * When profiling, each beta-reduction is also charged to a "stack" of
+ * origins gathered along the chain of enclosing abstractions (i.e. the
+ * 'outer' links in reduce()), which we emit in the folded-stack format
+ * accepted by flamegraph tools.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <util/symtab.h>
+
+struct node;
+
+extern bool profile_setting;
+
+extern void profile_alloc(symbol_mt origin, size_t nslots);
+extern void profile_beta(symbol_mt origin, const struct node *outer);
+extern void profile_copy(symbol_mt origin, size_t nslots);
+extern void print_profile(FILE *out);
+extern void reset_profile(void);
+extern int write_profile_folded(const char *pathname);
+
+#endif /* LARK_MLC_PROFILE_H */
@@ -38,10 +38,11 @@
  * this makes testing fragile.  Should come up with a more stable approach.
  *	https://github.com/mptz/lark/issues/38
  */
-static symbol_mt fresh_name(symbol_mt name, const struct wordbuf *names)
+static symbol_mt fresh_name(struct env *env, symbol_mt name,
+			    const struct wordbuf *names)
 {
 	size_t i, bound;
-	if (env_test(name))
+	if (env_test(env, name))
 		goto freshen;
 	for (i = 0, bound = wordbuf_used(names); i < bound; ++i)
 		if (wordbuf_at(names, i) == name)
@@ -52,7 +53,7 @@ freshen:
 }
 
 static struct form *readback_term(const struct term *term,
-				  struct wordbuf *names);
+				  struct env *env, struct wordbuf *names);
 
 /*
  * We store variable names for bound variables in a wordbuf.  wordbufs
@@ -60,7 +61,8 @@ static struct form *readback_term(const struct term *term,
  * variable names at a given abtraction level followed by a count,
  * allowing us to walk upwards by skipping.
  */
-static struct form *readback_abs(const struct term *abs, struct wordbuf *names)
+static struct form *readback_abs(const struct term *abs, struct env *env,
+				 struct wordbuf *names)
 {
 	assert(abs->variety == TERM_ABS || abs->variety == TERM_FIX);
 	struct form *params = NULL;
@@ -78,7 +80,7 @@ static struct form *readback_abs(const struct term *abs, struct wordbuf *names)
 		symbol_mt formal =
 			abs->abs.formals[i] == the_placeholder_symbol ?
 			abs->abs.formals[i] :
-			fresh_name(abs->abs.formals[i], names);
+			fresh_name(env, abs->abs.formals[i], names);
 		wordbuf_push(names, formal);
 		params = FormVarNext(formal, params);
 	}
@@ -86,7 +88,8 @@ static struct form *readback_abs(const struct term *abs, struct wordbuf *names)
 
 	struct form *bodies = NULL;
 	for (size_t i = 0; i < abs->abs.nbodies; ++i) {
-		struct form *body = readback_term(abs->abs.bodies[i], names);
+		struct form *body = readback_term(abs->abs.bodies[i], env,
+						  names);
 		body->prev = bodies, bodies = body;
 	}
 
@@ -96,12 +99,13 @@ static struct form *readback_abs(const struct term *abs, struct wordbuf *names)
 		FormAbs(params, bodies);
 }
 
-static struct form *readback_app(const struct term *app, struct wordbuf *names)
+static struct form *readback_app(const struct term *app, struct env *env,
+				 struct wordbuf *names)
 {
 	assert(app->variety == TERM_APP);
 	struct form *fun = NULL, *args = NULL;
 	for (size_t i = 0; i < app->app.nargs; ++i) {
-		struct form *arg = readback_term(app->app.args[i], names);
+		struct form *arg = readback_term(app->app.args[i], env, names);
 		assert(!arg->prev);
 		arg->prev = args, args = arg;
 	}
@@ -120,17 +124,18 @@ static struct form *readback_app(const struct term *app, struct wordbuf *names)
 			       app->app.fun->prim->syntax);
 		}
 	}
-	return FormApp(fun ? : readback_term(app->app.fun, names), args,
+	return FormApp(fun ? : readback_term(app->app.fun, env, names), args,
 		       FORM_SYNTAX_AUTO);
 }
 
 static struct form *
-readback_cell(const struct term *term, struct wordbuf *names)
+readback_cell(const struct term *term, struct env *env, struct wordbuf *names)
 {
 	assert(term->variety == TERM_CELL);
 	struct form *elts = NULL;
 	for (size_t i = 0; i < term->cell.nelts; ++i) {
-		struct form *elt = readback_term(term->cell.elts[i], names);
+		struct form *elt = readback_term(term->cell.elts[i], env,
+						 names);
 		assert(!elt->prev);
 		elt->prev = elts, elts = elt;
 	}
@@ -170,35 +175,37 @@ static struct form *readback_name(int up, int across, struct wordbuf *names)
 }
 
 static struct form *readback_test(const struct term *test,
-				  struct wordbuf *names)
+				  struct env *env, struct wordbuf *names)
 {
 	assert(test->variety == TERM_TEST);
 	struct form *csqs = NULL, *alts = NULL;
 	for (size_t i = 0; i < test->test.ncsqs; ++i) {
-		struct form *csq = readback_term(test->test.csqs[i], names);
+		struct form *csq = readback_term(test->test.csqs[i], env,
+						 names);
 		assert(!csq->prev);
 		csq->prev = csqs, csqs = csq;
 	}
 	for (size_t i = 0; i < test->test.nalts; ++i) {
-		struct form *alt = readback_term(test->test.alts[i], names);
+		struct form *alt = readback_term(test->test.alts[i], env,
+						 names);
 		assert(!alt->prev);
 		alt->prev = alts, alts = alt;
 	}
-	return FormTest(readback_term(test->test.pred, names), csqs, alts);
+	return FormTest(readback_term(test->test.pred, env, names), csqs, alts);
 }
 
 static struct form *readback_term(const struct term *term,
-				  struct wordbuf *names)
+				  struct env *env, struct wordbuf *names)
 {
 	switch (term->variety) {
 	case TERM_ABS: case TERM_FIX:
-		return readback_abs(term, names);
+		return readback_abs(term, env, names);
 	case TERM_APP:
-		return readback_app(term, names);
+		return readback_app(term, env, names);
 	case TERM_BOUND_VAR:
 		return readback_name(term->bv.up, term->bv.across, names);
 	case TERM_CELL:
-		return readback_cell(term, names);
+		return readback_cell(term, env, names);
 	case TERM_FREE_VAR:
 		return FormVar(term->fv.name);
 	case TERM_NUM:
@@ -210,17 +217,17 @@ static struct form *readback_term(const struct term *term,
 	case TERM_STRING:
 		return FormString(xstrdup(term->str));
 	case TERM_TEST:
-		return readback_test(term, names);
+		return readback_test(term, env, names);
 	default:
 		panicf("Unhandled term variety %d\n", term->variety);
 	}
 }
 
-struct form *readback(const struct term *term)
+struct form *readback(struct env *env, const struct term *term)
 {
 	struct wordbuf names;
 	wordbuf_init(&names);
-	struct form *retval = readback_term(term, &names);
+	struct form *retval = readback_term(term, env, &names);
 	wordbuf_fini(&names);
 	return retval;
 }
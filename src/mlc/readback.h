@@ -22,9 +22,10 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+struct env;
 struct form;
 struct term;
 
-extern struct form *readback(const struct term *term);
+extern struct form *readback(struct env *env, const struct term *term);
 
 #endif /* LARK_MLC_READBACK_H */
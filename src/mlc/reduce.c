@@ -25,41 +25,67 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <engine/clock.h>
+#include <engine/memloc.h>
+#include <engine/stats.h>
 #include <util/message.h>
 
 #include "beta.h"
+#include "church.h"
 #include "heap.h"
-#include "memloc.h"
-#include "mlc.h"
 #include "node.h"
 #include "prim.h"
+#include "profile.h"
 #include "reduce.h"
+#include "trace.h"
 
 #define EVAL_STATS 1
 #define SANITY_CHECK 1
 #define TRACE_EVAL 0
 
-struct eval_stats {
-	unsigned long
-		reduce_start, reduce_done,
-		eval_rl, eval_lr,
-		rule_beta, rule_rename, rule_test,
-		rule_zeta,
-		rule_prim,
-		rule_move_left, rule_reverse, rule_move_right,
-		rule_move_up, rule_collect,
-		rule_enter_abs, rule_exit_abs,
-		rule_enter_test, rule_exit_test,
-		quick_inert_unref, quick_value_unref, quick_beta_move;
-};
+#define TRACE_STEP(event, aux) do { \
+	if (trace_setting) trace_event(event, depth, head, aux); \
+} while (0)
 
 static struct eval_stats the_eval_stats;
 
-static void gc(struct node *head, struct node *outer)
+enum reduce_status the_reduce_status;
+
+const char *reduce_status_message(enum reduce_status status)
+{
+	switch (status) {
+	case REDUCE_DONE: return "reduced";
+	case REDUCE_STEP_LIMIT: return "step budget exhausted";
+	case REDUCE_HEAP_LIMIT: return "heap budget exhausted";
+	case REDUCE_TIME_LIMIT: return "time budget exhausted";
+	}
+	return "unknown status";
+}
+
+/*
+ * Heap and time budgets are only checked periodically, since reading
+ * the clock on every step would be relatively expensive.
+ */
+static enum reduce_status check_budget(const struct reduce_budget *budget,
+				       double t0)
 {
-	if (!quiet_setting)
+	if (budget->heap_bytes &&
+	    node_heap_bytes_in_use() > budget->heap_bytes)
+		return REDUCE_HEAP_LIMIT;
+	if (budget->seconds > 0.0 &&
+	    clock_seconds() - t0 > budget->seconds)
+		return REDUCE_TIME_LIMIT;
+	return REDUCE_DONE;
+}
+
+static void gc(struct node *head, struct node *outer, FILE *log)
+{
+	if (log)
 		fputs("==================== COLLECTING "
-		      "GARBAGE ====================\n", stderr);
+		      "GARBAGE ====================\n", log);
+	size_t nodes = node_heap_in_use();
+	if (trace_setting)
+		trace_event(TRACE_GC_START, head->depth, head, nodes);
 	do {
 		assert(!done(head));
 		for (head = head->next; !done(head); /* nada */) {
@@ -77,23 +103,25 @@ static void gc(struct node *head, struct node *outer)
 		if (head) outer = head->outer;
 	} while (head);
 	node_heap_calibrate();
-	fflush(stdout);
-	if (!quiet_setting) print_heap_stats();
+	if (trace_setting)
+		trace_event(TRACE_GC_END, 0, NULL, nodes - node_heap_in_use());
+	if (log) print_heap_stats(log);
 }
 
-void print_eval_stats(void)
+void print_eval_stats(FILE *out)
 {
-	printf(
+	fprintf(out,
 	"\t\t\tREDUCTION STATISTICS\n"
 	"\t\t\t====================\n"
 	"Steps:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"		/* 1 */
 	"Rules:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"		/* 2 */
 	      "\t%12s %-10lu %12s %-10lu\n"			/* 3 */
-	      "\t%12s %-10lu %12s %-10lu %12s %-10lu\n"		/* 4 */
-	      "\t%12s %-10lu %12s %-10lu\n"			/* 5 */
+	      "\t%12s %-10lu %12s %-10lu\n"			/* 4 */
+	      "\t%12s %-10lu %12s %-10lu %12s %-10lu\n"		/* 5 */
 	      "\t%12s %-10lu %12s %-10lu\n"			/* 6 */
 	      "\t%12s %-10lu %12s %-10lu\n"			/* 7 */
-	"Quick:\t%12s %-10lu %12s %-10lu %12s %-10lu\n",	/* 8 */
+	      "\t%12s %-10lu %12s %-10lu\n"			/* 8 */
+	"Quick:\t%12s %-10lu %12s %-10lu %12s %-10lu\n",	/* 9 */
 
 	"reductions",	the_eval_stats.reduce_start,		/* 1 */
 	/* not showing reduce_done but won't differ unless reducing */
@@ -107,24 +135,62 @@ void print_eval_stats(void)
 	"zeta",		the_eval_stats.rule_zeta,		/* 3 */
 	"prim",		the_eval_stats.rule_prim,
 
-	"move_left",	the_eval_stats.rule_move_left,		/* 4 */
+	"church",	the_eval_stats.rule_church,		/* 4 */
+	"expand",	the_eval_stats.rule_expand,
+
+	"move_left",	the_eval_stats.rule_move_left,		/* 5 */
 	"reverse",	the_eval_stats.rule_reverse,
 	"move_right",	the_eval_stats.rule_move_right,
 
-	"enter_abs",	the_eval_stats.rule_enter_abs,		/* 5 */
+	"enter_abs",	the_eval_stats.rule_enter_abs,		/* 6 */
 	"enter_test",	the_eval_stats.rule_enter_test,
 
-	"exit_abs",	the_eval_stats.rule_exit_abs,		/* 6 */
+	"exit_abs",	the_eval_stats.rule_exit_abs,		/* 7 */
 	"exit_test",	the_eval_stats.rule_exit_test,
 
-	"move_up",	the_eval_stats.rule_move_up,		/* 7 */
+	"move_up",	the_eval_stats.rule_move_up,		/* 8 */
 	"collect",	the_eval_stats.rule_collect,
 
-	"inert_unref",	the_eval_stats.quick_inert_unref,	/* 8 */
+	"inert_unref",	the_eval_stats.quick_inert_unref,	/* 9 */
 	"value_unref",	the_eval_stats.quick_value_unref,
 	"beta_move",	the_eval_stats.quick_beta_move);
 }
 
+static const struct stat_desc the_eval_stat_descs [] = {
+	{ "reductions",	STAT_ULONG,	&the_eval_stats.reduce_start },
+	{ "eval_rl",	STAT_ULONG,	&the_eval_stats.eval_rl },
+	{ "eval_lr",	STAT_ULONG,	&the_eval_stats.eval_lr },
+	{ "beta",	STAT_ULONG,	&the_eval_stats.rule_beta },
+	{ "rename",	STAT_ULONG,	&the_eval_stats.rule_rename },
+	{ "test",	STAT_ULONG,	&the_eval_stats.rule_test },
+	{ "zeta",	STAT_ULONG,	&the_eval_stats.rule_zeta },
+	{ "prim",	STAT_ULONG,	&the_eval_stats.rule_prim },
+	{ "church",	STAT_ULONG,	&the_eval_stats.rule_church },
+	{ "expand",	STAT_ULONG,	&the_eval_stats.rule_expand },
+	{ "move_left",	STAT_ULONG,	&the_eval_stats.rule_move_left },
+	{ "reverse",	STAT_ULONG,	&the_eval_stats.rule_reverse },
+	{ "move_right",	STAT_ULONG,	&the_eval_stats.rule_move_right },
+	{ "enter_abs",	STAT_ULONG,	&the_eval_stats.rule_enter_abs },
+	{ "enter_test",	STAT_ULONG,	&the_eval_stats.rule_enter_test },
+	{ "exit_abs",	STAT_ULONG,	&the_eval_stats.rule_exit_abs },
+	{ "exit_test",	STAT_ULONG,	&the_eval_stats.rule_exit_test },
+	{ "move_up",	STAT_ULONG,	&the_eval_stats.rule_move_up },
+	{ "collect",	STAT_ULONG,	&the_eval_stats.rule_collect },
+	{ "inert_unref", STAT_ULONG,	&the_eval_stats.quick_inert_unref },
+	{ "value_unref", STAT_ULONG,	&the_eval_stats.quick_value_unref },
+	{ "beta_move",	STAT_ULONG,	&the_eval_stats.quick_beta_move },
+};
+
+void register_eval_stats(void)
+{
+	STATS_REGISTER("eval", the_eval_stat_descs);
+}
+
+const struct eval_stats *current_eval_stats(void)
+{
+	return &the_eval_stats;
+}
+
 void reset_eval_stats(void)
 {
 	memset(&the_eval_stats, 0, sizeof the_eval_stats);
@@ -226,9 +292,9 @@ static void trace_eval(enum eval_dir dir, unsigned depth, struct node *head)
 	struct node *lb = dir == RL ? head : head->prev,
 		    *rb = dir == RL ? head->next : head;
 	printf("eval_%s[+%u]: ", dir == RL ? "rl" : "lr", depth);
-	node_print_until(lb);
+	node_print_until(stdout, lb);
 	fputs(dir == RL ? " <=L=< " : " >=R=> ", stdout);
-	node_print_after(rb);
+	node_print_after(stdout, rb);
 	putchar('\n');
 	fflush(stdout);
 }
@@ -243,12 +309,17 @@ static void trace_eval(enum eval_dir dir, unsigned depth, struct node *head)
  * Descent into an abstraction is a recursive traversal, i.e. we echo
  * right-to-left then left-to-right traversals on the abstraction body.
  */
-struct node *reduce(struct node *head)
+struct node *reduce(struct node *head, const struct reduce_budget *budget,
+		    FILE *log)
 {
 	struct node *outer = NULL,	/* containing abstraction links */
+		    *root = head,	/* for freeing on abort */
 		    *x, *y;		/* temporaries */
-	unsigned depth = 0, ticks = 0;
+	unsigned depth = 0;
+	unsigned long ticks = 0;
+	double t0 = clock_seconds();
 
+	the_reduce_status = REDUCE_DONE;
 	the_eval_stats.reduce_start++;
 	/* fall through to eval_body... */
 
@@ -264,8 +335,17 @@ eval_rl:
 	if (TRACE_EVAL) trace_eval(RL, depth, head);
 	if (done(head))
 		goto rule_reverse;
-	if ((++ticks & 0xFF) == 0 && the_heap_pressure > the_heap_threshold)
-		gc(head, outer);
+	if (budget->steps && ticks >= budget->steps) {
+		the_reduce_status = REDUCE_STEP_LIMIT;
+		goto abort;
+	}
+	if ((++ticks & 0xFF) == 0) {
+		if (heap_pressure_high(&the_heap_pressure))
+			gc(head, outer, log);
+		if ((the_reduce_status = check_budget(budget, t0)) !=
+		    REDUCE_DONE)
+			goto abort;
+	}
 
 	/*
 	 * Verify some invariants: before we evaluate nodes in R-to-L,
@@ -309,8 +389,18 @@ eval_rl:
 		 */
 		if (node_is_prim(head->slots[0].subst))
 			goto rule_prim;
-		if (node_is_abs(head->slots[0].subst))
+		if (node_is_abs(head->slots[0].subst)) {
+			/*
+			 * A recognized Church combinator applied to
+			 * numerals is computed natively, in place.
+			 */
+			if (head->slots[0].subst->church &&
+			    church_reduce(head))
+				goto rule_church;
 			goto rule_beta;
+		}
+		if (node_is_church(head->slots[0].subst))
+			goto rule_expand;
 		break;
 	case NODE_CELL:
 		break;
@@ -343,11 +433,13 @@ rule_move_left:
 	 * the reduction head to the left.
 	 */
 	if (EVAL_STATS) the_eval_stats.rule_move_left++;
+	TRACE_STEP(TRACE_MOVE_LEFT, 0);
 	head = head->prev;
 	goto eval_rl;
 
 rule_zeta:
 	if (EVAL_STATS) the_eval_stats.rule_zeta++;
+	TRACE_STEP(TRACE_ZETA, 0);
 	assert(head->variety == NODE_LET);
 	assert(head->slots[0].variety == SLOT_BODY);
 	x = head;
@@ -355,6 +447,7 @@ rule_zeta:
 
 rule_beta:
 	if (EVAL_STATS) the_eval_stats.rule_beta++;
+	TRACE_STEP(TRACE_BETA, 0);
 	assert(head->slots[0].variety == SLOT_SUBST);
 	x = head->slots[0].subst;
 	assert(head->depth >= x->depth);
@@ -372,6 +465,7 @@ do_subst:
 	 */ 
 	if (head->nslots != x->nslots)
 		panic("Arity mismatch in beta-reduction!\n");
+	if (profile_setting) profile_beta(x->origin, outer);
 
 	/*
 	 * First traverse and preprocess the application's arguments:
@@ -454,6 +548,8 @@ do_subst:
 			NodeBoundVar(NULL, depth, slot.bv.up, slot.bv.across) :
 			NodeFreeVar(NULL, depth, slot.term);
 		node->isfresh = true;
+		node->origin = head->origin;
+		if (profile_setting) profile_alloc(node->origin, node->nslots);
 		head->slots[i].subst = node;
 		head->slots[i].variety = SLOT_SUBST;
 	}
@@ -488,8 +584,10 @@ do_subst:
 				   head->depth - x->depth);
 	} else {
 		y = head;	/* save a redex reference before reducing */
+		size_t nodes = node_heap_in_use();
 		head = beta_reduce(head, node_abs_body(x), depth,
 				   head->depth - x->depth);
+		TRACE_STEP(TRACE_COPY, node_heap_in_use() - nodes);
 	}
 
 	/*
@@ -566,6 +664,7 @@ do_subst:
 
 rule_prim:
 	if (EVAL_STATS) the_eval_stats.rule_prim++;
+	TRACE_STEP(TRACE_PRIM, 0);
 
 	/*
 	 * Primitive reduction handles connecting the result to the
@@ -581,6 +680,26 @@ rule_prim:
 	head = x->slots[0].prim->reduce(x->slots[0].prim->variety, head);
 	goto eval_rl;
 
+rule_church:
+	/*
+	 * church_reduce() has already replaced the redex with a native
+	 * numeral, as primitive reduction replaces it with a value.
+	 */
+	if (EVAL_STATS) the_eval_stats.rule_church++;
+	TRACE_STEP(TRACE_CHURCH, head->slots[0].count);
+	goto eval_rl;
+
+rule_expand:
+	/*
+	 * A native numeral in function position is expanded into the
+	 * abstraction its Church form would give when applied; the
+	 * redex becomes that abstraction.
+	 */
+	if (EVAL_STATS) the_eval_stats.rule_expand++;
+	TRACE_STEP(TRACE_EXPAND, head->slots[0].subst->slots[0].count);
+	head = church_expand(head);
+	goto eval_rl;
+
 rule_rename:
 	/*
 	 * Note that backreferences point not to nodes, but to slots
@@ -610,6 +729,7 @@ rule_rename:
 	 *		[@Y subst] (disconnected & freed)
 	 */
 	if (EVAL_STATS) the_eval_stats.rule_rename++;
+	TRACE_STEP(TRACE_RENAME, 0);
 	assert(head->nslots == 1);
 	assert(head->slots[0].variety == SLOT_SUBST);
 	assert(head->backref);
@@ -622,6 +742,7 @@ rule_rename:
 
 rule_test:
 	if (EVAL_STATS) the_eval_stats.rule_test++;
+	TRACE_STEP(TRACE_TEST, 0);
 	assert(head->variety == NODE_TEST);
 	assert(head->nslots == 3);
 	assert(head->slots[SLOT_TEST_PRED].variety == SLOT_SUBST &&
@@ -675,6 +796,7 @@ rule_test:
 
 rule_reverse:
 	if (EVAL_STATS) the_eval_stats.rule_reverse++;
+	TRACE_STEP(TRACE_REVERSE, 0);
 	if (SANITY_CHECK) sanity_check_l(head, depth);
 	assert(head->variety == NODE_SENTINEL);
 	head = head->next;
@@ -703,11 +825,13 @@ eval_lr:
 	 * Move right without taking any other action.
 	 */
 	if (EVAL_STATS) the_eval_stats.rule_move_right++;
+	TRACE_STEP(TRACE_MOVE_RIGHT, 0);
 	head = head->next;
 	goto eval_lr;
 
 rule_move_up:
 	if (EVAL_STATS) the_eval_stats.rule_move_up++;
+	TRACE_STEP(TRACE_MOVE_UP, 0);
 	if (!outer) goto done;
 	switch (outer->variety) {
 	case NODE_ABS:
@@ -730,6 +854,7 @@ rule_move_up:
 
 rule_collect:
 	if (EVAL_STATS) the_eval_stats.rule_collect++;
+	TRACE_STEP(TRACE_COLLECT, 0);
 	assert(!head->nref);
 	x = head->next;
 	node_remove(head);
@@ -747,6 +872,7 @@ rule_enter_abs:
 	 * treated uniformly here.
 	 */
 	if (EVAL_STATS) the_eval_stats.rule_enter_abs++;
+	TRACE_STEP(TRACE_ENTER_ABS, 0);
 	if (TRACE_EVAL)
 		printf("enter_abs[+%u]: vvv @%s\n", depth, memloc(head));
 	assert(node_is_binder(head));	/* ABS, FIX, or LET */
@@ -764,6 +890,7 @@ rule_exit_abs:
 	 * (to outer->next) since we're done reducing this node.
 	 */
 	if (EVAL_STATS) the_eval_stats.rule_exit_abs++;
+	TRACE_STEP(TRACE_EXIT_ABS, 0);
 	assert(done(head));
 	assert(outer != NULL);
 	assert(node_is_binder(outer));
@@ -777,6 +904,7 @@ rule_exit_abs:
 
 rule_enter_test:
 	if (EVAL_STATS) the_eval_stats.rule_enter_test++;
+	TRACE_STEP(TRACE_ENTER_TEST, 0);
 	if (TRACE_EVAL)
 		printf("enter_test[+%u]: vvv @%s\n", depth, memloc(head));
 	assert(head->variety == NODE_TEST);
@@ -788,6 +916,7 @@ rule_enter_test:
 
 rule_exit_test:
 	if (EVAL_STATS) the_eval_stats.rule_exit_test++;
+	TRACE_STEP(TRACE_EXIT_TEST, 0);
 	assert(done(head));
 	assert(outer != NULL);
 	assert(outer->variety == NODE_TEST);
@@ -804,4 +933,12 @@ done:
 	if (SANITY_CHECK) sanity_check_r(head, depth);
 	the_eval_stats.reduce_done++;
 	return head;
+
+abort:
+	/*
+	 * We only abort between steps, when the graph is consistent, so
+	 * we can free it from the root just as we would a normal form.
+	 */
+	node_free(root);
+	return NULL;
 }
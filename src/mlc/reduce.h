@@ -22,10 +22,59 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stddef.h>
+#include <stdio.h>
+
 struct node;
 
-extern struct node *reduce(struct node *node);
-extern void print_eval_stats(void);
+/*
+ * Optional resource budgets for a single reduction; zero means no
+ * limit.  Steps are counted in right-to-left evaluation steps, and
+ * heap usage includes nodes allocated before reduction started.  When
+ * a budget is exhausted, reduce() frees the partially-reduced graph
+ * and returns NULL, leaving the reason in the_reduce_status.  Garbage
+ * collection is noted on reduce()'s 'log' unless that is NULL.
+ */
+struct reduce_budget {
+	unsigned long steps;
+	size_t heap_bytes;
+	double seconds;
+};
+
+enum reduce_status {
+	REDUCE_DONE,
+	REDUCE_STEP_LIMIT,
+	REDUCE_HEAP_LIMIT,
+	REDUCE_TIME_LIMIT,
+};
+
+/*
+ * Counts of evaluation steps and rules applied, reset before each
+ * top-level reduction.
+ */
+struct eval_stats {
+	unsigned long
+		reduce_start, reduce_done,
+		eval_rl, eval_lr,
+		rule_beta, rule_rename, rule_test,
+		rule_zeta,
+		rule_prim,
+		rule_church, rule_expand,
+		rule_move_left, rule_reverse, rule_move_right,
+		rule_move_up, rule_collect,
+		rule_enter_abs, rule_exit_abs,
+		rule_enter_test, rule_exit_test,
+		quick_inert_unref, quick_value_unref, quick_beta_move;
+};
+
+extern enum reduce_status the_reduce_status;
+
+extern struct node *reduce(struct node *node,
+			   const struct reduce_budget *budget, FILE *log);
+extern const char *reduce_status_message(enum reduce_status status);
+extern const struct eval_stats *current_eval_stats(void);
+extern void print_eval_stats(FILE *out);
+extern void register_eval_stats(void);
 extern void reset_eval_stats(void);
 
 #endif /* LARK_MLC_REDUCE_H */
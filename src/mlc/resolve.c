@@ -25,13 +25,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <engine/memloc.h>
 #include <util/memutil.h>
 #include <util/message.h>
 #include <util/wordbuf.h>
 
 #include "env.h"
 #include "form.h"
-#include "memloc.h"
 #include "node.h"
 #include "prim.h"
 #include "term.h"
@@ -196,6 +196,7 @@ static struct binding context_lookup(const struct context *context,
 }
 
 static struct term *form_convert(const struct form *form,
+				 struct env *env,
 				 struct wordbuf *defs,
 				 struct context *context);
 
@@ -205,6 +206,7 @@ static struct term *form_convert(const struct form *form,
  * becomes the 0th parameter of the construction abstraction term.
  */
 static struct term *form_convert_abs(const struct form *form,
+				     struct env *env,
 				     struct wordbuf *defs,
 				     struct context *context)
 {
@@ -236,7 +238,7 @@ static struct term *form_convert_abs(const struct form *form,
 		    **bdst = bodies + nbodies;
 	const struct form *body;
 	for (body = form->abs.bodies; body; body = body->prev)
-		*--bdst = form_convert(body, defs, &link);
+		*--bdst = form_convert(body, env, defs, &link);
 	assert(bdst == bodies);
 
 	/* transfer ownership of 'formals' and 'bodies' */
@@ -246,6 +248,7 @@ static struct term *form_convert_abs(const struct form *form,
 }
 
 static struct term *form_convert_let(const struct form *form,
+				     struct env *env,
 				     struct wordbuf *defs,
 				     struct context *context)
 {
@@ -259,7 +262,7 @@ static struct term *form_convert_let(const struct form *form,
 	for (i = ndefs, def = form->let.defs; i-- > 1; def = def->prev) {
 		assert(def->def.var->variety == FORM_VAR);
 		vars[i] = def->def.var->var.name;
-		vals[i] = form_convert(def->def.val, defs, context);
+		vals[i] = form_convert(def->def.val, env, defs, context);
 	}
 	assert(!i);
 	vars[i] = the_empty_symbol;
@@ -274,7 +277,7 @@ static struct term *form_convert_let(const struct form *form,
 
 	/* transfer ownership of 'vars' and 'vals' */
 	return TermLet(ndefs, vars, vals,
-		       form_convert(form->let.body, defs, &link));
+		       form_convert(form->let.body, env, defs, &link));
 }
 
 /*
@@ -285,27 +288,28 @@ static struct term *form_convert_let(const struct form *form,
  * entries of global definitions referenced by 'form' in 'defs'.
  */
 static struct term *form_convert(const struct form *form,
+				 struct env *env,
 				 struct wordbuf *defs,
 				 struct context *context)
 {
 	switch (form->variety) {
 	case FORM_ABS: case FORM_FIX:
-		return form_convert_abs(form, defs, context);
+		return form_convert_abs(form, env, defs, context);
 	case FORM_APP: {
 		size_t nargs = form_length(form->app.args);
 		/*
 		 * 0-ary applications also collapse.
 		 */
 		if (nargs == 0)
-			return form_convert(form->app.fun, defs, context);
+			return form_convert(form->app.fun, env, defs, context);
 
 		struct term **args = xmalloc(sizeof *args * nargs),
 			    **dst = args + nargs;
 		const struct form *arg;
 		for (arg = form->app.args; arg; arg = arg->prev)
-			*--dst = form_convert(arg, defs, context);
+			*--dst = form_convert(arg, env, defs, context);
 		assert(dst == args);
-		return TermApp(form_convert(form->app.fun, defs, context),
+		return TermApp(form_convert(form->app.fun, env, defs, context),
 			       nargs, args);
 	}
 	case FORM_CELL: {
@@ -314,19 +318,19 @@ static struct term *form_convert(const struct form *form,
 			    **dst = elts + nelts;
 		for (const struct form *elt = form->cell.elts;
 		     elt; elt = elt->prev)
-			*--dst = form_convert(elt, defs, context);
+			*--dst = form_convert(elt, env, defs, context);
 		assert(dst == elts);
 		return TermCell(nelts, elts);
 	}
 	case FORM_LET:
-		return form_convert_let(form, defs, context);
+		return form_convert_let(form, env, defs, context);
 	case FORM_NUM:
 		return TermNum(form->num);
 	case FORM_OP1: {
 		const size_t nargs = 1;
 		struct term **args = xmalloc(sizeof *args * nargs),
 			    **dst = args + nargs;
-		*--dst = form_convert(form->op1.arg, defs, context);
+		*--dst = form_convert(form->op1.arg, env, defs, context);
 		assert(dst == args);
 		return TermApp(TermPrim(form->op1.prim), nargs, args);
 	}
@@ -334,8 +338,8 @@ static struct term *form_convert(const struct form *form,
 		const size_t nargs = 2;
 		struct term **args = xmalloc(sizeof *args * nargs),
 			    **dst = args + nargs;
-		*--dst = form_convert(form->op2.rhs, defs, context);
-		*--dst = form_convert(form->op2.lhs, defs, context);
+		*--dst = form_convert(form->op2.rhs, env, defs, context);
+		*--dst = form_convert(form->op2.lhs, env, defs, context);
 		assert(dst == args);
 		return TermApp(TermPrim(form->op2.prim), nargs, args);
 	}
@@ -352,11 +356,12 @@ static struct term *form_convert(const struct form *form,
 			    **cdst = csq + ncsq, **adst = alt + nalt;
 		const struct form *p;
 		for (p = form->test.csq; p; p = p->prev)
-			*--cdst = form_convert(p, defs, context);
+			*--cdst = form_convert(p, env, defs, context);
 		for (p = form->test.alt; p; p = p->prev)
-			*--adst = form_convert(p, defs, context);
+			*--adst = form_convert(p, env, defs, context);
 		assert(cdst == csq && adst == alt);
-		return TermTest(form_convert(form->test.pred, defs, context),
+		return TermTest(form_convert(form->test.pred, env, defs,
+					     context),
 				ncsq, csq /* transfer ownership */,
 				nalt, alt /* transfer ownership */);
 	}
@@ -365,7 +370,7 @@ static struct term *form_convert(const struct form *form,
 		if (b.up >= 0)
 			return TermBoundVar(b.up, b.across, form->var.name);
 
-		struct env_entry ee = env_declare(form->var.name);
+		struct env_entry ee = env_declare(env, form->var.name);
 		assert(ee.var);
 		assert(ee.var->variety == TERM_FREE_VAR);
 		if (ee.val) {
@@ -380,12 +385,12 @@ static struct term *form_convert(const struct form *form,
 	}
 }
 
-struct term *resolve(const struct form *form)
+struct term *resolve(struct env *env, const struct form *form)
 {
 	struct wordbuf defs;
 	wordbuf_init(&defs);
 
-	struct term *term = form_convert(form, &defs, NULL);
+	struct term *term = form_convert(form, env, &defs, NULL);
 	if (!term) goto done;	/* error message already printed */
 	if (wordbuf_used(&defs) > 0) term = lift(term, &defs);
 done:
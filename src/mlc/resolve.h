@@ -35,9 +35,10 @@
  * for each free definition d = v in t.
  */
 
+struct env;
 struct form;
 struct term;
 
-extern struct term *resolve(const struct form *form);
+extern struct term *resolve(struct env *env, const struct form *form);
 
 #endif /* LARK_MLC_RESOLVE_H */
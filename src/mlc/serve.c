@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <util/fdutil.h>
+#include <util/memutil.h>
+#include <util/message.h>
+
+#include "libmlc.h"
+#include "serve.h"
+
+static int serve_respond(int conn, const struct mlc_result *result)
+{
+	if (result->length > UINT32_MAX)
+		return -1;
+	uint32_t header [2] = { htonl(result->status ? 1 : 0),
+				htonl(result->length) };
+	if (r_writeall(conn, header, sizeof header) ||
+	    r_writeall(conn, result->output, result->length))
+		return -1;
+	return 0;
+}
+
+/*
+ * Like r_readall(), but a client hanging up (EOF) isn't an error.
+ */
+static int read_request(int conn, void *buf, size_t count)
+{
+	for (char *bytes = buf; count; /* nada */) {
+		ssize_t nread = r_read(conn, bytes, count);
+		if (nread <= 0)
+			return -1;
+		bytes += nread, count -= nread;
+	}
+	return 0;
+}
+
+static void serve_connection(struct mlc_ctx *ctx, int conn)
+{
+	uint32_t length;
+	while (!read_request(conn, &length, sizeof length)) {
+		length = ntohl(length);
+		if (length > SERVE_MAX_REQUEST) {
+			fprintf(stderr, "Request too large (%lu bytes)\n",
+				(unsigned long) length);
+			break;
+		}
+		char *text = xmalloc(length + 1);
+		if (read_request(conn, text, length)) {
+			xfree(text);
+			break;
+		}
+		text[length] = '\0';
+		struct mlc_result result;
+		mlc_eval(ctx, text, &result);
+		xfree(text);
+		int retval = result.output ? serve_respond(conn, &result) : -1;
+		mlc_result_fini(&result);
+		if (retval)
+			break;
+	}
+}
+
+/*
+ * Only remove a stale socket, never some other file which happens to
+ * be in the way.
+ */
+static int unlink_stale_socket(const char *pathname)
+{
+	struct stat st;
+	if (lstat(pathname, &st))
+		return errno == ENOENT ? 0 : xperror(pathname);
+	if (!S_ISSOCK(st.st_mode)) {
+		fprintf(stderr, "%s: File exists and is not a socket\n",
+			pathname);
+		return -1;
+	}
+	return unlink(pathname) ? xperror(pathname) : 0;
+}
+
+int serve(struct mlc_ctx *ctx, const char *pathname, bool fork_workers)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(pathname) >= sizeof addr.sun_path) {
+		fprintf(stderr, "%s: Socket pathname too long\n", pathname);
+		return -1;
+	}
+	strcpy(addr.sun_path, pathname);
+	if (unlink_stale_socket(pathname))
+		return -1;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return xperror("socket");
+	if (bind(sock, (struct sockaddr *) &addr, sizeof addr) ||
+	    listen(sock, SOMAXCONN)) {
+		int retval = xperror(pathname);
+		close(sock);
+		return retval;
+	}
+
+	signal(SIGPIPE, SIG_IGN);		/* clients may hang up */
+	if (fork_workers)
+		signal(SIGCHLD, SIG_IGN);	/* reap automatically */
+
+	for (;;) {
+		int conn = accept(sock, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			xperror("accept");
+			break;
+		}
+		if (!fork_workers) {
+			serve_connection(ctx, conn);
+			close(conn);
+			continue;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			serve_connection(ctx, conn);
+			_exit(0);
+		}
+		if (pid < 0)
+			xperror("fork");
+		close(conn);
+	}
+	close(sock);
+	return -1;
+}
@@ -0,0 +1,57 @@
+#ifndef LARK_MLC_SERVE_H
+#define LARK_MLC_SERVE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Evaluation server.  Loading the prelude and libraries is a large part
+ * of the cost of a short mlc run, so serve() instead listens on a Unix-
+ * domain socket and evaluates requests against an environment which has
+ * already been loaded.
+ *
+ * Each request is a 32-bit big-endian length followed by that many bytes
+ * of mlc source text, which may contain any number of '.'-terminated
+ * statements; requests are evaluated with mlc_eval() in the given
+ * context.  Each response is a 32-bit big-endian status (0 on success,
+ * nonzero on parse error) and a 32-bit big-endian length, followed by
+ * that many bytes of output: exactly what mlc would have written to
+ * stdout and stderr for the same statements, including normal forms and
+ * (unless quiet) statistics.  A connection may carry any number of
+ * requests.
+ *
+ * By default connections are served one at a time in the server process,
+ * so definitions made by one request are visible to later ones.  With
+ * 'fork_workers', each connection is instead served by a forked child,
+ * which isolates clients from one another (and the server from crashes)
+ * at the cost of a fork per connection.
+ */
+
+#include <stdbool.h>
+
+#define SERVE_MAX_REQUEST (16 << 20)
+
+struct mlc_ctx;
+
+extern int serve(struct mlc_ctx *ctx, const char *pathname,
+		 bool fork_workers);
+
+#endif /* LARK_MLC_SERVE_H */
@@ -27,13 +27,21 @@
 
 #include <util/message.h>
 
+#include "cache.h"
+#include "church.h"
+#include "compile.h"
+#include "ctx.h"
+#include "elim.h"
 #include "env.h"
 #include "form.h"
 #include "heap.h"
+#include "inline.h"
 #include "flatten.h"
+#include "fold.h"
 #include "interpret.h"
-#include "mlc.h"
 #include "node.h"
+#include "perf.h"
+#include "profile.h"
 #include "readback.h"
 #include "reduce.h"
 #include "resolve.h"
@@ -41,24 +49,25 @@
 #include "term.h"
 #include "unflatten.h"
 
-static void node_listing(const char *label, struct node *node)
+static void node_listing(struct mlc_ctx *ctx, const char *label,
+			 struct node *node)
 {
-	if (quiet_setting)
+	if (ctx->options.quiet)
 		return;
 
-	fputs(label, stdout);
-	putchar(':');
-	if (listing_setting) {
-		putchar('\n');
-		node_list_rl(node);
+	fputs(label, ctx->out);
+	putc(':', ctx->out);
+	if (ctx->options.listing) {
+		putc('\n', ctx->out);
+		node_list_rl(ctx->out, node);
 	} else {
-		putchar(' ');
-		node_print_body(node);
-		putchar('\n');
+		putc(' ', ctx->out);
+		node_print_body(ctx->out, node);
+		putc('\n', ctx->out);
 	}
 }
 
-void stmt_define(symbol_mt name, struct form *form)
+void stmt_define(struct mlc_ctx *ctx, symbol_mt name, struct form *form)
 {
 	/*
 	 * Definition currently uses resolve, which lifts the form;
@@ -68,8 +77,29 @@ void stmt_define(symbol_mt name, struct form *form)
 	 * all values in the global environment are closed and thus can
 	 * be substituted without further closing/expansion.
 	 */
-	struct term *body = resolve(form);
-	if (!body) return;	/* error already printed */
+	struct term *body = resolve(ctx->env, form);
+	if (!body) {		/* error already printed */
+		cache_note_uncacheable(ctx);
+		return;
+	}
+	body = fold(ctx->env, body);
+	if (ctx->options.inline_size) {
+		body = inline_term(ctx->env, body, ctx->options.inline_size);
+		body = fold(ctx->env, body);
+	}
+	body = elim(ctx->env, body);
+	stmt_define_term(ctx, name, body);
+}
+
+/*
+ * Shared by stmt_define() and replay of compiled libraries (cache.c).
+ */
+void stmt_define_term(struct mlc_ctx *ctx, symbol_mt name, struct term *body)
+{
+	term_set_origin(body, name);
+	cache_note_define(ctx, name, body);
+	if (ctx->options.church)
+		church_note_define(ctx->env, body);
 
 	/*
 	 * Note that this doesn't allow for recursive definitions;
@@ -77,89 +107,121 @@ void stmt_define(symbol_mt name, struct form *form)
 	 * to the environment as a free variable and this definition
 	 * will fail.
 	 */
-	if (!env_define(name, body).var)
-		fprintf(stderr, "Error: Name already exists: %s\n",
+	if (!env_define(ctx->env, name, body).var)
+		fprintf(ctx->err, "Error: Name already exists: %s\n",
 			symtab_lookup(name));
 }
 
-void stmt_list(struct form *form)
+void stmt_list(struct mlc_ctx *ctx, struct form *form)
 {
-	fputs("form: ", stdout);
-	form_print(form);
-	putchar('\n');
+	cache_note_uncacheable(ctx);
+	fputs("form: ", ctx->out);
+	form_print(ctx->out, form);
+	putc('\n', ctx->out);
 
-	struct term *term = resolve(form);
+	struct term *term = resolve(ctx->env, form);
 	if (!term)
 		return;
-	if (!quiet_setting) {
-		fputs("term: ", stdout);
-		term_print(term);
-		putchar('\n');
+	term = fold(ctx->env, term);
+	term = elim(ctx->env, term);
+	if (!ctx->options.quiet) {
+		fputs("term: ", ctx->out);
+		term_print(ctx->out, term);
+		putc('\n', ctx->out);
 	}
 
 	struct node *node = flatten(term);
-	node_listing("flat", node->prev);
+	node_listing(ctx, "flat", node->prev);
 	node_free(node);
 
 	fputs("==================================="
-	      "===================================\n", stdout);
+	      "===================================\n", ctx->out);
 }
 
-void stmt_reduce(struct form *form)
+void stmt_reduce(struct mlc_ctx *ctx, struct form *form)
 {
-	fputs("form: ", stdout);
-	form_print(form);
-	putchar('\n');
+	cache_note_uncacheable(ctx);
+	fputs("form: ", ctx->out);
+	form_print(ctx->out, form);
+	putc('\n', ctx->out);
 
-	struct term *term = resolve(form);
+	struct term *term = resolve(ctx->env, form);
 	if (!term)
 		return;
-	if (!quiet_setting) {
-		fputs("term: ", stdout);
-		term_print(term);
-		putchar('\n');
+	term = fold(ctx->env, term);
+	term = elim(ctx->env, term);
+	if (!ctx->options.quiet) {
+		fputs("term: ", ctx->out);
+		term_print(ctx->out, term);
+		putc('\n', ctx->out);
 	}
+	if (ctx->options.compile && compile_run(ctx, form, term))
+		goto done;
 
 	struct node *node = flatten(term);
-	node_listing("flat", node);
+	node_listing(ctx, "flat", node);
 
 	/* XXX should have option for this? */
 	reset_eval_stats();
 	reset_heap_stats();
+	reset_profile();
+	perf_begin_reduction();
 
+	struct form *norm = NULL;
 	struct timeval t0, t;
 	gettimeofday(&t0, NULL);
-	node = reduce(node);
-	assert(node);
+	node = reduce(node, &ctx->budget, ctx->options.quiet ? NULL : ctx->err);
 	gettimeofday(&t, NULL);
+	if (!node) {
+		fflush(ctx->out);
+		fprintf(ctx->err, "Reduction aborted: %s\n",
+			reduce_status_message(the_reduce_status));
+		goto stats;
+	}
 
-	node_listing("eval", node);
+	node_listing(ctx, "eval", node);
 
 	term = unflatten(node);
 	assert(term);
 	node_free(node);
 	node = NULL;
-	if (!quiet_setting) {
-		fputs("term: ", stdout);
-		term_print(term);
-		putchar('\n');
+	if (!ctx->options.quiet) {
+		fputs("term: ", ctx->out);
+		term_print(ctx->out, term);
+		putc('\n', ctx->out);
 	}
 
-	form = readback(term);
-	fputs("norm: ", stdout);
-	form_print(form);
-	putchar('\n');
+	norm = readback(ctx->env, term);
+	fputs("norm: ", ctx->out);
+	form_print(ctx->out, norm);
+	putc('\n', ctx->out);
 
-	interpret(term);
+	interpret(ctx->out, term);
 
+stats:;
+	perf_end_reduction();
 	long elapsed = (t.tv_sec - t0.tv_sec) * 1000000 +
 		       (t.tv_usec - t0.tv_usec);
-	if (!quiet_setting) {
-		printf("dt: %.6fs\n", elapsed / 1000000.0);
-		print_eval_stats();
-		fflush(stdout);		/* XXX move up */
-		print_heap_stats();
+	if (!ctx->options.quiet) {
+		fprintf(ctx->out, "dt: %.6fs\n", elapsed / 1000000.0);
+		print_eval_stats(ctx->out);
+		fflush(ctx->out);	/* XXX move up */
+		print_heap_stats(ctx->err);
 	}
+	if (profile_setting)
+		print_profile(ctx->out);
+
+	const struct eval_stats *eval = current_eval_stats();
+	struct mlc_stats stats = {
+		.seconds = elapsed / 1000000.0,
+		.steps = eval->eval_rl + eval->eval_lr,
+		.betas = eval->rule_beta,
+		.prims = eval->rule_prim,
+		.allocs = node_heap_allocs(),
+		.peak = node_heap_peak(),
+	};
+	ctx_note_reduction(ctx, form, norm, the_reduce_status, &stats);
+done:
 	fputs("==================================="
-	      "===================================\n", stdout);
+	      "===================================\n", ctx->out);
 }
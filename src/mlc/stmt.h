@@ -25,9 +25,13 @@
 #include <util/symtab.h>
 
 struct form;
+struct mlc_ctx;
+struct term;
 
-extern void stmt_define(symbol_mt name, struct form *form);
-extern void stmt_list(struct form *form);
-extern void stmt_reduce(struct form *form);
+extern void stmt_define(struct mlc_ctx *ctx, symbol_mt name, struct form *form);
+extern void stmt_define_term(struct mlc_ctx *ctx, symbol_mt name,
+			     struct term *body);
+extern void stmt_list(struct mlc_ctx *ctx, struct form *form);
+extern void stmt_reduce(struct mlc_ctx *ctx, struct form *form);
 
 #endif /* LARK_MLC_STMT_H */
@@ -26,6 +26,7 @@
 #include <util/message.h>
 
 #include "node.h"
+#include "profile.h"
 #include "subst.h"
 
 static struct node *copy_node(struct node *prev, const struct node *src,
@@ -209,6 +210,7 @@ static struct node *copy_slots(struct node *copy, const struct node *src,
 						 src->slots[i].bv.across,
 						 var, subst);
 			break;
+		case SLOT_CHURCH:
 		case SLOT_FREE:
 		case SLOT_NUM:
 		case SLOT_PARAM:
@@ -237,6 +239,9 @@ static struct node *copy_node(struct node *prev, const struct node *src,
 	struct node *dst = NodeGeneric(prev, depth, src->nslots);
 	copy_slots(dst, src, var, subst);
 	dst->variety = src->variety;
+	dst->church = src->church;
+	dst->origin = src->origin;
+	if (profile_setting) profile_copy(src->origin, src->nslots);
 	return dst;
 }
 
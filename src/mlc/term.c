@@ -23,10 +23,10 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <engine/memloc.h>
 #include <util/memutil.h>
 #include <util/message.h>
 
-#include "memloc.h"
 #include "num.h"
 #include "prim.h"
 #include "term.h"
@@ -36,6 +36,7 @@ term_alloc(enum term_variety variety)
 {
 	struct term *term = xmalloc(sizeof *term);
 	term->variety = variety;
+	term->origin = 0;
 	return term;
 }
 
@@ -161,99 +162,147 @@ TermTest(struct term *pred,
 	return term;
 }
 
-void term_print(const struct term *term)
+void term_print(FILE *out, const struct term *term)
 {
 	switch (term->variety) {
 	case TERM_ABS:
-		putchar('[');
+		fputc('[', out);
 		/* skip unused 0th (self-reference) formal */
 		for (size_t i = 1; i < term->abs.nformals; ++i)
-			printf("%s%s", i > 1 ? ", " : "",
-			       symtab_lookup(term->abs.formals[i]));
-		putchar('.');
+			fprintf(out, "%s%s", i > 1 ? ", " : "",
+				symtab_lookup(term->abs.formals[i]));
+		fputc('.', out);
 		for (size_t i = 0; i < term->abs.nbodies; ++i) {
-			fputs(i ? ", " : " ", stdout);
-			term_print(term->abs.bodies[i]);
+			fputs(i ? ", " : " ", out);
+			term_print(out, term->abs.bodies[i]);
 		}
-		putchar(']');
+		fputc(']', out);
 		break;
 	case TERM_APP:
-		putchar('(');
-		term_print(term->app.fun);
-		fputs(") (", stdout);
+		fputc('(', out);
+		term_print(out, term->app.fun);
+		fputs(") (", out);
 		for (size_t i = 0; i < term->app.nargs; ++i) {
-			if (i) fputs(", ", stdout);
-			term_print(term->app.args[i]);
+			if (i) fputs(", ", out);
+			term_print(out, term->app.args[i]);
 		}
-		putchar(')');
+		fputc(')', out);
 		break;
 	case TERM_BOUND_VAR:
-		printf("%s<%d.%d>", symtab_lookup(term->bv.name),
-		       term->bv.up, term->bv.across);
+		fprintf(out, "%s<%d.%d>", symtab_lookup(term->bv.name),
+			term->bv.up, term->bv.across);
 		break;
 	case TERM_CELL:
-		putchar('[');
+		fputc('[', out);
 		for (size_t i = 0; i < term->cell.nelts; ++i) {
-			if (i) fputs(" | ", stdout);
-			term_print(term->cell.elts[i]);
+			if (i) fputs(" | ", out);
+			term_print(out, term->cell.elts[i]);
 		}
-		putchar(']');
+		fputc(']', out);
 		break;
 	case TERM_FREE_VAR:
 		/*
 		 * XXX why print memloc() for a free variable?  Aren't
 		 * all free instances of e.g. 'x' the same?
 		 */
-		printf("%s@%s", symtab_lookup(term->fv.name), memloc(term));
+		fprintf(out, "%s@%s", symtab_lookup(term->fv.name),
+			memloc(term));
 		break;
 	case TERM_FIX:
-		printf("[%s! ", symtab_lookup(term->abs.formals[0]));
+		fprintf(out, "[%s! ", symtab_lookup(term->abs.formals[0]));
 		for (size_t i = 1; i < term->abs.nformals; ++i)
-			printf("%s%s", i > 1 ? ", " : "",
-			       symtab_lookup(term->abs.formals[i]));
-		putchar('.');
+			fprintf(out, "%s%s", i > 1 ? ", " : "",
+				symtab_lookup(term->abs.formals[i]));
+		fputc('.', out);
 		for (size_t i = 0; i < term->abs.nbodies; ++i) {
-			fputs(i ? ", " : " ", stdout);
-			term_print(term->abs.bodies[i]);
+			fputs(i ? ", " : " ", out);
+			term_print(out, term->abs.bodies[i]);
 		}
-		putchar(']');
+		fputc(']', out);
 		break;
 	case TERM_LET:
-		fputs("let {", stdout);
+		fputs("let {", out);
 		for (size_t i = 1; i < term->let.ndefs; ++i) {
-			printf("%s%s := ", i > 1 ? ". " : "",
-			       symtab_lookup(term->let.vars[i]));
-			term_print(term->let.vals[i]);
+			fprintf(out, "%s%s := ", i > 1 ? ". " : "",
+				symtab_lookup(term->let.vars[i]));
+			term_print(out, term->let.vals[i]);
 		}
-		fputs("} ", stdout);
-		term_print(term->let.body);
+		fputs("} ", out);
+		term_print(out, term->let.body);
 		break;
 	case TERM_NUM:
-		num_print(term->num);
+		num_print(out, term->num);
 		break;
 	case TERM_PRIM:
-		printf("'%s'", term->prim->name);
+		fprintf(out, "'%s'", term->prim->name);
 		break;
 	case TERM_PRUNED:
-		fputs("<PRUNED>", stdout);
+		fputs("<PRUNED>", out);
 		break;
 	case TERM_STRING:
-		printf("\"%s\"", term->str);
+		fprintf(out, "\"%s\"", term->str);
 		break;
 	case TERM_TEST:
-		putchar('[');
-		term_print(term->test.pred);
+		fputc('[', out);
+		term_print(out, term->test.pred);
 		for (size_t i = 0; i < term->test.ncsqs; ++i) {
-			fputs(i ? ", " : "? ", stdout);
-			term_print(term->test.csqs[i]);
+			fputs(i ? ", " : "? ", out);
+			term_print(out, term->test.csqs[i]);
 		}
 		for (size_t i = 0; i < term->test.nalts; ++i) {
-			fputs(i ? ", " : " | ", stdout);
-			term_print(term->test.alts[i]);
+			fputs(i ? ", " : " | ", out);
+			term_print(out, term->test.alts[i]);
 		}
-		putchar(']');
+		fputc(']', out);
 		break;
 	default:
 		panicf("Unhandled term variety %d\n", term->variety);
 	}
 }
+
+/*
+ * Tag a term and its subterms with the name of the definition they
+ * belong to.  Terms are shared (resolve() lifts the values of earlier
+ * definitions into later ones by reference), so we stop descending at
+ * subterms which are already tagged; those belong to other definitions.
+ * Free variables are shared by every term referencing them, so they
+ * don't belong to any one definition and are left untagged.
+ */
+void term_set_origin(struct term *term, symbol_mt origin)
+{
+	if (term->origin || term->variety == TERM_FREE_VAR ||
+	    term->variety == TERM_PRUNED)
+		return;
+	term->origin = origin;
+
+	switch (term->variety) {
+	case TERM_ABS:
+	case TERM_FIX:
+		for (size_t i = 0; i < term->abs.nbodies; ++i)
+			term_set_origin(term->abs.bodies[i], origin);
+		break;
+	case TERM_APP:
+		term_set_origin(term->app.fun, origin);
+		for (size_t i = 0; i < term->app.nargs; ++i)
+			term_set_origin(term->app.args[i], origin);
+		break;
+	case TERM_CELL:
+		for (size_t i = 0; i < term->cell.nelts; ++i)
+			term_set_origin(term->cell.elts[i], origin);
+		break;
+	case TERM_LET:
+		for (size_t i = 0; i < term->let.ndefs; ++i)
+			term_set_origin(term->let.vals[i], origin);
+		term_set_origin(term->let.body, origin);
+		break;
+	case TERM_TEST:
+		term_set_origin(term->test.pred, origin);
+		for (size_t i = 0; i < term->test.ncsqs; ++i)
+			term_set_origin(term->test.csqs[i], origin);
+		for (size_t i = 0; i < term->test.nalts; ++i)
+			term_set_origin(term->test.alts[i], origin);
+		break;
+	default:
+		/* nada */;
+	}
+}
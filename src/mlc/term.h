@@ -30,6 +30,8 @@
  * variable name for printing.
  */
 
+#include <stdio.h>
+
 #include <util/symtab.h>
 
 enum term_variety {
@@ -50,6 +52,7 @@ enum term_variety {
 
 struct term {
 	enum term_variety variety;
+	symbol_mt origin;	/* defining name, for profiling */
 	union {
 		struct { size_t nformals, nbodies;
 			 symbol_mt *formals;
@@ -87,6 +90,7 @@ extern struct term *TermTest(struct term *pred,
 			     size_t ncsqs, struct term **csqs,
 			     size_t nalts, struct term **alts);
 
-extern void term_print(const struct term *term);
+extern void term_print(FILE *out, const struct term *term);
+extern void term_set_origin(struct term *term, symbol_mt origin);
 
 #endif /* LARK_MLC_TERM_H */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "trace.h"
+
+bool trace_setting = false;
+
+static const char *const the_event_names [TRACE_NEVENTS] = {
+	[TRACE_BETA] = "beta",
+	[TRACE_ZETA] = "zeta",
+	[TRACE_PRIM] = "prim",
+	[TRACE_RENAME] = "rename",
+	[TRACE_TEST] = "test",
+	[TRACE_MOVE_LEFT] = "move_left",
+	[TRACE_REVERSE] = "reverse",
+	[TRACE_MOVE_RIGHT] = "move_right",
+	[TRACE_MOVE_UP] = "move_up",
+	[TRACE_COLLECT] = "collect",
+	[TRACE_ENTER_ABS] = "enter_abs",
+	[TRACE_EXIT_ABS] = "exit_abs",
+	[TRACE_ENTER_TEST] = "enter_test",
+	[TRACE_EXIT_TEST] = "exit_test",
+	[TRACE_COPY] = "copy",
+	[TRACE_GC_START] = "gc_start",
+	[TRACE_GC_END] = "gc_end",
+	[TRACE_CHURCH] = "church",
+	[TRACE_EXPAND] = "expand",
+};
+
+const char *trace_event_name(unsigned event)
+{
+	return event < TRACE_NEVENTS ? the_event_names[event] : "unknown";
+}
+
+int trace_open(const char *pathname, size_t capacity)
+{
+	int result = trace_sink_open(pathname, capacity,
+				     TRACE_MAGIC, TRACE_VERSION);
+	if (!result)
+		trace_setting = true;
+	return result;
+}
+
+void trace_close(void)
+{
+	trace_setting = false;
+	trace_sink_close();
+}
@@ -0,0 +1,66 @@
+#ifndef LARK_MLC_TRACE_H
+#define LARK_MLC_TRACE_H
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Binary reduction tracing.  Unlike TRACE_EVAL in reduce.c, which prints
+ * whole node chains at every step, we record fixed-size records with the
+ * engine's trace sink, so tracing can be left on for production-sized
+ * runs; see engine/trace.h.  This module defines MLC's events.
+ *
+ * Node IDs are derived from node addresses, so they're only meaningful
+ * while the node is live (malloc recycles addresses).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <engine/trace.h>
+
+enum trace_event {
+	TRACE_BETA, TRACE_ZETA, TRACE_PRIM, TRACE_RENAME, TRACE_TEST,
+	TRACE_MOVE_LEFT, TRACE_REVERSE, TRACE_MOVE_RIGHT,
+	TRACE_MOVE_UP, TRACE_COLLECT,
+	TRACE_ENTER_ABS, TRACE_EXIT_ABS, TRACE_ENTER_TEST, TRACE_EXIT_TEST,
+	TRACE_COPY,		/* aux: nodes allocated copying a body */
+	TRACE_GC_START,		/* aux: nodes in use */
+	TRACE_GC_END,		/* aux: nodes freed */
+	TRACE_CHURCH,		/* aux: numeral computed natively */
+	TRACE_EXPAND,		/* aux: numeral applied */
+	TRACE_NEVENTS
+};
+
+#define TRACE_MAGIC "MLCTRACE"
+#define TRACE_VERSION 1
+
+extern bool trace_setting;
+
+extern int trace_open(const char *pathname, size_t capacity);
+extern void trace_close(void);
+extern const char *trace_event_name(unsigned event);
+
+static inline void trace_event(enum trace_event event, unsigned depth,
+			       const void *node, unsigned long aux)
+	{ trace_sink_record(event, depth, node, aux); }
+
+#endif /* LARK_MLC_TRACE_H */
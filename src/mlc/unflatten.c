@@ -29,6 +29,7 @@
 #include <util/symtab.h>
 #include <util/wordtab.h>
 
+#include "church.h"
 #include "node.h"
 #include "term.h"
 #include "unflatten.h"
@@ -175,6 +176,7 @@ static struct term *unflatten_slot(struct slot slot, int depth, int cutoff,
 				    name_lookup(shifted, slot.bv.across,
 						context));
 	}
+	case SLOT_CHURCH: return church_numeral(slot.count);
 	case SLOT_FREE: return slot.term;
 	case SLOT_NUM: return TermNum(slot.num);
 	case SLOT_PRIM: return TermPrim(slot.prim);
@@ -1,9 +1,17 @@
 make_binary(slc, beta.c crumble.c env.c form.c heap.c interpret.c
-		 memloc.c node.c parse.c readback.c reduce.c
+		 node.c parse.c perf.c readback.c reduce.c
 		 resolve.c slc.c slc.l slc.y
-		 stmt.c term.c uncrumble.c, util, readline)
+		 stmt.c term.c uncrumble.c, engine util, readline)
 
 export SLC_INCLUDE := lib/slc
 
-%.runout %.runerr: %.slc $(subdir)slc
-	src/slc/slc -q $*.slc > $*.runout 2> $*.runerr
+%.runout %.runerr %.runperf: %.slc $(subdir)slc
+	src/slc/slc -q -p $*.runperf $*.slc > $*.runout 2> $*.runerr
+
+# Tests named *-small run with a one-chunk node heap and must exhaust it;
+# we keep only the panic message, without the backtrace.
+%-small.runout %-small.runerr: %-small.slc $(subdir)slc
+	! src/slc/slc -q -m 65536 $*-small.slc > $*-small.runout \
+		2> $*-small.runerr.tmp
+	sed -n 's/.*PANIC: //p' $*-small.runerr.tmp > $*-small.runerr
+	rm $*-small.runerr.tmp
@@ -21,6 +21,7 @@
  */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #include <util/message.h>
@@ -370,6 +371,32 @@ static struct node *subst_node_rl(struct node *src, int var,
 	return src;
 }
 
+/*
+ * Scan an abstraction body for occurrences of its bound variable,
+ * stopping at the first.  Like copying, we track the variable's
+ * index as we descend into nested abstractions.
+ */
+static bool uses_var(const struct node *node, int var)
+{
+	for (/* nada */; node; node = node->prev) {
+		if (node->bits == NODE_BITS_ABS) {
+			if (uses_var(node_abs_body(node), var + 1))
+				return true;
+			continue;
+		}
+		if ((node->bits & NODE_LHS_BOUND) && node->lhs.index == var)
+			return true;
+		if ((node->bits & NODE_RHS_BOUND) && node->rhs.index == var)
+			return true;
+	}
+	return false;
+}
+
+bool beta_uses_var(const struct node *body)
+{
+	return uses_var(body, 0);
+}
+
 struct node *beta_nocopy(struct node *redex, struct node *body,
 			 struct node *val, int depth, int delta)
 {
@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdbool.h>
+
 /*
  * Perform a beta-reduction via copying with substitution; encompasses
  * the following operations in a single linear-time pass:
@@ -51,12 +53,18 @@
  * we still need to do a) and b), but not c)--substitution modifies
  * the last copy destructively since we know we won't need to copy
  * it again.
+ *
+ * beta_uses_var reports whether an abstraction body references its
+ * bound variable, i.e. whether substitution will create references to
+ * the value; for self-application, this decides whether the body can
+ * be reduced destructively.
  */
 
 struct node;
 
 extern struct node *beta_reduce(struct node *redex, struct node *body,
 				struct node *val, int depth, int delta);
+extern bool beta_uses_var(const struct node *body);
 extern struct node *beta_nocopy(struct node *redex, struct node *body,
 				struct node *val, int depth, int delta);
 
@@ -21,8 +21,12 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
 
+#include <engine/stats.h>
 #include <util/memutil.h>
 #include <util/message.h>
 
@@ -30,41 +34,151 @@
 #include "node.h"
 
 /*
- * We could easily make the heap more dynamic, but as SLC is meant as a
- * prototype/proof of concept, it's not clear it's worth it (yet).
+ * Nodes live in a single reservation of address space, committed a
+ * chunk at a time as the heap grows, up to a configurable limit.
+ *
+ * Free nodes are tracked in a bitmap rather than a LIFO free list, and
+ * allocation always takes the lowest free address.  Environments are
+ * chains of nodes linked through 'prev' and built in allocation order,
+ * so this keeps them close together in memory even after a lot of
+ * churn.  A summary bitmap, one bit per word of the free bitmap, keeps
+ * the search for the lowest free node short.
  */
-#define MAX_NODES 1000000
+#define CHUNK_NODES NODE_HEAP_CHUNK	/* nodes committed at a time */
+#define CHUNK_WORDS (CHUNK_NODES / 64)	/* free bitmap words per chunk */
+
+size_t node_heap_limit = DEFAULT_NODE_HEAP_LIMIT;
 
-static struct node the_nodes [MAX_NODES];
+static struct node *the_nodes,		/* base of the reservation */
+		   *the_next_node,	/* first node never allocated */
+		   *the_node_bound;	/* end of committed nodes */
+static size_t the_max_nodes;		/* nodes reserved */
 
-static struct node *the_free_list,
-		   *the_next_node = the_nodes,
-		   *the_node_bound;
+static uint64_t *the_free_bits,		/* set for freed nodes */
+		*the_free_summary;	/* set for nonzero free words */
+static size_t the_summary_hint;		/* no free nodes below this word */
 
 struct heap_stats {
 	unsigned long node_allocs, node_frees;
+	unsigned long collections;
+	size_t live, peak_live;
 };
 
+/*
+ * Pressure is measured against the committed heap rather than the
+ * reservation, so it rises as we approach the next chunk commit and
+ * reduction can sweep garbage in preference to growing.
+ */
+struct heap_pressure the_heap_pressure = HEAP_PRESSURE_INIT;
+
 static struct heap_stats the_heap_stats;
 
+static const struct stat_desc the_heap_stat_descs [] = {
+	{ "allocs",	STAT_ULONG,	&the_heap_stats.node_allocs },
+	{ "frees",	STAT_ULONG,	&the_heap_stats.node_frees },
+	{ "live",	STAT_SIZE,	&the_heap_stats.live },
+	{ "peak_live",	STAT_SIZE,	&the_heap_stats.peak_live },
+	{ "pressure",	STAT_FLOAT,	&the_heap_pressure.level },
+	{ "threshold",	STAT_FLOAT,	&the_heap_pressure.threshold },
+	{ "gcs",	STAT_ULONG,	&the_heap_stats.collections },
+};
+
+static inline void update_heap_pressure(void)
+{
+	heap_pressure_update(&the_heap_pressure, the_heap_stats.live,
+			     the_node_bound - the_nodes);
+}
+
 void node_heap_init(void)
 {
-	the_node_bound = the_next_node + MAX_NODES;
+	size_t max = node_heap_limit;
+	max += CHUNK_NODES - 1;
+	max -= max % CHUNK_NODES;
+	if (!max)
+		max = CHUNK_NODES;
+
+	void *base = MAP_FAILED;
+	for (/* nada */; max >= CHUNK_NODES; max /= 2) {
+		base = mmap(NULL, max * sizeof the_nodes[0], PROT_NONE,
+			    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			    -1, 0);
+		if (base != MAP_FAILED)
+			break;
+	}
+	if (base == MAP_FAILED)
+		panic("Can't reserve node heap\n");
+	the_nodes = the_next_node = the_node_bound = base;
+	the_max_nodes = max - max % CHUNK_NODES;
+
+	size_t words = the_max_nodes / 64,
+	       summaries = (words + 63) / 64;
+	the_free_bits = xmalloc(words * sizeof the_free_bits[0]);
+	memset(the_free_bits, 0, words * sizeof the_free_bits[0]);
+	the_free_summary = xmalloc(summaries * sizeof the_free_summary[0]);
+	memset(the_free_summary, 0, summaries * sizeof the_free_summary[0]);
+	update_heap_pressure();
+	STATS_REGISTER("heap", the_heap_stat_descs);
+}
+
+/*
+ * Called once after each garbage collection, so it also counts them.
+ */
+void node_heap_calibrate(void)
+{
+	the_heap_stats.collections++;
+	update_heap_pressure();
+	heap_pressure_calibrate(&the_heap_pressure);
+}
+
+static void node_heap_grow(void)
+{
+	if (the_node_bound - the_nodes >= the_max_nodes)
+		panicf("Node heap exhausted (limit %zu nodes)!\n",
+		       the_max_nodes);
+	if (mprotect(the_node_bound, CHUNK_NODES * sizeof the_nodes[0],
+		     PROT_READ | PROT_WRITE))
+		panic("Can't commit node heap\n");
+	the_node_bound += CHUNK_NODES;
+}
+
+/*
+ * Take the lowest-addressed freed node, if there is one.
+ */
+static struct node *node_heap_reuse(void)
+{
+	size_t touched = (the_next_node - the_nodes + 63) / 64,
+	       summaries = (touched + 63) / 64;
+	for (size_t s = the_summary_hint; s < summaries; ++s) {
+		uint64_t summary = the_free_summary[s];
+		if (!summary)
+			continue;
+		the_summary_hint = s;
+		size_t w = s * 64 + __builtin_ctzll(summary);
+		uint64_t bits = the_free_bits[w];
+		assert(bits);
+		unsigned b = __builtin_ctzll(bits);
+		if (!(the_free_bits[w] = bits & (bits - 1)))
+			the_free_summary[s] &= ~(UINT64_C(1) << (w % 64));
+		return the_nodes + w * 64 + b;
+	}
+	the_summary_hint = summaries;
+	return NULL;
 }
 
 struct node *node_heap_alloc(void)
 {
 	the_heap_stats.node_allocs++;
-	struct node *node = the_free_list;
-	if (node) {
-		the_free_list = the_free_list->prev;
+	if (++the_heap_stats.live > the_heap_stats.peak_live)
+		the_heap_stats.peak_live = the_heap_stats.live;
+	struct node *node = node_heap_reuse();
+	if (node)
 		goto done;
-	}
 	if (the_next_node >= the_node_bound)
-		panic("Node heap exhausted!\n");
+		node_heap_grow();
 	node = the_next_node++;
 	node->bits = NODE_INVALID;
 done:
+	update_heap_pressure();
 	node->prev = NULL;	/* for safety */
 	return node;
 }
@@ -72,30 +186,51 @@ done:
 void node_heap_free(struct node *node)
 {
 	the_heap_stats.node_frees++;
+	the_heap_stats.live--;
 	assert(node);
 	node->bits = NODE_INVALID;
-	node->prev = the_free_list;
-	the_free_list = node;
+	size_t i = node - the_nodes, w = i / 64, s = w / 64;
+	assert(!(the_free_bits[w] & (UINT64_C(1) << (i % 64))));
+	the_free_bits[w] |= UINT64_C(1) << (i % 64);
+	the_free_summary[s] |= UINT64_C(1) << (w % 64);
+	if (s < the_summary_hint)
+		the_summary_hint = s;
+	update_heap_pressure();
+}
+
+unsigned long node_heap_allocs(void)
+{
+	return the_heap_stats.node_allocs;
 }
 
-static unsigned long free_list_length(void)
+size_t node_heap_peak(void)
 {
-	const struct node *p;
-	unsigned long i;
-	for (p = the_free_list, i = 0; p; p = p->prev, ++i);
-	return i;
+	return the_heap_stats.peak_live;
 }
 
 void print_heap_stats(void)
 {
+	size_t committed = the_node_bound - the_nodes,
+	       touched = the_next_node - the_nodes;
 	printf(
 	"\t\t\tHEAP STATISTICS\n"
 	"\t\t\t===============\n"
-	"Nodes:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
-	      "\t%12s %-10lu %12s %-10lu\n",
-	"total",	(unsigned long) MAX_NODES,
-	"untouched",	(unsigned long) (the_node_bound - the_next_node),
-	"free_list",	free_list_length(),
+	"Nodes:\t%12s %-10zu %12s %-10zu %12s %-10zu\n"
+	      "\t%12s %-10lu %12s %-10lu %12s %-10zu\n"
+	      "\t%12s %-10zu %12s %-10zu %12s %-10zu\n"
+	"Usage:\t%12s %-10g %12s %-10g %12s %-10lu\n",
+	"total",	committed,
+	"untouched",	committed - touched,
+	"free",		touched - the_heap_stats.live,
 	"allocs",	the_heap_stats.node_allocs,
-	"frees",	the_heap_stats.node_frees);
+	"frees",	the_heap_stats.node_frees,
+	/* we reuse the lowest freed nodes first, so touched nodes are a
+	   high-water mark of address space in use */
+	"peak",		touched,
+	"live",		the_heap_stats.live,
+	"peak_live",	the_heap_stats.peak_live,
+	"limit",	the_max_nodes,
+	"pressure",	the_heap_pressure.level,
+	"threshold",	the_heap_pressure.threshold,
+	"gcs",		the_heap_stats.collections);
 }
@@ -22,11 +22,29 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stddef.h>
+
+#include <engine/pressure.h>
+
 struct node;
 
+/*
+ * Maximum number of nodes the heap may grow to; set before calling
+ * node_heap_init().  The heap grows a chunk of NODE_HEAP_CHUNK nodes at
+ * a time, so the limit is rounded up to a multiple of that.
+ */
+#define NODE_HEAP_CHUNK ((size_t) 65536)
+#define DEFAULT_NODE_HEAP_LIMIT ((size_t) 1 << 26)
+extern size_t node_heap_limit;
+
+extern struct heap_pressure the_heap_pressure;
+
 void node_heap_init(void);
+void node_heap_calibrate(void);		/* set threshold after gc */
 struct node *node_heap_alloc(void);
 void node_heap_free(struct node *node);
+unsigned long node_heap_allocs(void);
+size_t node_heap_peak(void);		/* live nodes, over the run */
 void print_heap_stats(void);
 
 #endif /* LARK_SLC_HEAP_H */
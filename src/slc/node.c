@@ -23,11 +23,11 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <engine/memloc.h>
 #include <util/message.h>
 
 #include "heap.h"
 #include "node.h"
-#include "memloc.h"
 #include "term.h"
 
 static struct node *node_alloc(unsigned bits, struct node *prev, int depth)
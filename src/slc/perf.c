@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2009-2024 Michael P. Touloumtzis.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <util/message.h>
+
+#include "heap.h"
+#include "perf.h"
+#include "reduce.h"
+
+/*
+ * slc never resets its evaluation or heap statistics, so the costs of
+ * a run are simply their values at exit.
+ */
+int write_perf(const char *pathname)
+{
+	FILE *fout = fopen(pathname, "w");
+	if (!fout)
+		return xperror(pathname);
+	const struct eval_stats *stats = current_eval_stats();
+	fprintf(fout,
+		"reductions %lu\n"
+		"eval_rl %lu\n"
+		"eval_lr %lu\n"
+		"beta_value %lu\n"
+		"beta_inert %lu\n"
+		"rename %lu\n"
+		"allocs %lu\n"
+		"peak %zu\n",
+		stats->reduce_start,
+		stats->eval_rl,
+		stats->eval_lr,
+		stats->rule_beta_value,
+		stats->rule_beta_inert,
+		stats->rule_rename,
+		node_heap_allocs(),
+		node_heap_peak());
+	if (fclose(fout))
+		return xperror(pathname);
+	return 0;
+}
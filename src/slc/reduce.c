@@ -24,26 +24,23 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include <engine/memloc.h>
+#include <engine/stats.h>
 #include <util/message.h>
 
 #include "beta.h"
+#include "heap.h"
 #include "node.h"
-#include "memloc.h"
 #include "reduce.h"
 
 #define EVAL_STATS 1
 #define SANITY_CHECK 1
 #define TRACE_EVAL 0
 
-struct eval_stats {
-	unsigned long
-		reduce_start, reduce_done,
-		eval_rl, eval_lr,
-		rule_beta_value, rule_beta_inert, rule_rename,
-		rule_move_left, rule_reverse, rule_move_right,
-		rule_enter_abs, rule_exit_abs, rule_collect,
-		quick_inert_unref, quick_value_unref, quick_beta_move;
-};
+/*
+ * Nodes examined per mid-reduction sweep step; see sweep_right().
+ */
+#define SWEEP_CHUNK 1024
 
 static struct eval_stats the_eval_stats;
 
@@ -56,7 +53,9 @@ void print_eval_stats(void)
 	"Rules:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
 	      "\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
 	      "\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
-	"Quick:\t%12s %-10lu %12s %-10lu %12s %-10lu\n",
+	"Quick:\t%12s %-10lu %12s %-10lu %12s %-10lu\n"
+	      "\t%12s %-10lu\n"
+	"Sweep:\t%12s %-10lu %12s %-10lu\n",
 	"reductions",	the_eval_stats.reduce_start,
 	/* not showing reduce_done but won't differ unless reducing */
 	"eval_rl",	the_eval_stats.eval_rl,
@@ -72,7 +71,41 @@ void print_eval_stats(void)
 	"collect",	the_eval_stats.rule_collect,
 	"inert_unref",	the_eval_stats.quick_inert_unref,
 	"value_unref",	the_eval_stats.quick_value_unref,
-	"beta_move",	the_eval_stats.quick_beta_move);
+	"beta_move",	the_eval_stats.quick_beta_move,
+	"self_move",	the_eval_stats.quick_self_move,
+	"scanned",	the_eval_stats.sweep_scanned,
+	"collected",	the_eval_stats.sweep_collected);
+}
+
+static const struct stat_desc the_eval_stat_descs [] = {
+	{ "reductions",	STAT_ULONG,	&the_eval_stats.reduce_start },
+	{ "eval_rl",	STAT_ULONG,	&the_eval_stats.eval_rl },
+	{ "eval_lr",	STAT_ULONG,	&the_eval_stats.eval_lr },
+	{ "beta_value",	STAT_ULONG,	&the_eval_stats.rule_beta_value },
+	{ "beta_inert",	STAT_ULONG,	&the_eval_stats.rule_beta_inert },
+	{ "rename",	STAT_ULONG,	&the_eval_stats.rule_rename },
+	{ "move_left",	STAT_ULONG,	&the_eval_stats.rule_move_left },
+	{ "reverse",	STAT_ULONG,	&the_eval_stats.rule_reverse },
+	{ "move_right",	STAT_ULONG,	&the_eval_stats.rule_move_right },
+	{ "enter_abs",	STAT_ULONG,	&the_eval_stats.rule_enter_abs },
+	{ "exit_abs",	STAT_ULONG,	&the_eval_stats.rule_exit_abs },
+	{ "collect",	STAT_ULONG,	&the_eval_stats.rule_collect },
+	{ "inert_unref", STAT_ULONG,	&the_eval_stats.quick_inert_unref },
+	{ "value_unref", STAT_ULONG,	&the_eval_stats.quick_value_unref },
+	{ "beta_move",	STAT_ULONG,	&the_eval_stats.quick_beta_move },
+	{ "self_move",	STAT_ULONG,	&the_eval_stats.quick_self_move },
+	{ "scanned",	STAT_ULONG,	&the_eval_stats.sweep_scanned },
+	{ "collected",	STAT_ULONG,	&the_eval_stats.sweep_collected },
+};
+
+void register_eval_stats(void)
+{
+	STATS_REGISTER("eval", the_eval_stat_descs);
+}
+
+const struct eval_stats *current_eval_stats(void)
+{
+	return &the_eval_stats;
 }
 
 /*
@@ -158,6 +191,41 @@ static void trace_eval(enum eval_dir dir, unsigned depth,
 	fflush(stdout);
 }
 
+/*
+ * Mid-reduction garbage collection.  Beta reduction drops references
+ * to nodes we've already passed in the R-to-L traversal, but rule_collect
+ * only reaches them in the following L-to-R traversal, so long weak
+ * reductions can fill the heap with garbage.  When heap pressure
+ * exceeds its threshold we sweep the nodes to our right incrementally,
+ * at most 'budget' of them per call, freeing the unreferenced ones.
+ *
+ * During R-to-L traversal that list only changes at its head, so 'link'
+ * (the slot which references the next node to examine) stays valid
+ * between calls as long as we restart from &headr on changing levels
+ * or direction.  Returns where to resume, or NULL after a full pass.
+ *
+ * Nodes examined and retained are bounded by 'budget' per call, so a
+ * call every fixed number of transitions keeps them O(1); freeing an
+ * abstraction frees its body too, but that's paid for by allocation.
+ */
+static struct node **sweep_right(struct node **link, unsigned budget)
+{
+	struct node *node;
+	while ((node = *link)) {
+		if (!budget--)
+			return link;
+		if (EVAL_STATS) the_eval_stats.sweep_scanned++;
+		if (node->nref)
+			link = &node->prev;
+		else {
+			if (EVAL_STATS) the_eval_stats.sweep_collected++;
+			*link = node->prev;
+			node_free(node);
+		}
+	}
+	return NULL;
+}
+
 /*
  * Reduction proceeds right-to-left then left-to-right.  Each pass has
  * both a primary and a secondary function:
@@ -172,6 +240,8 @@ struct node *reduce(struct node *headl)
 {
 	struct node *headr = NULL, *outer = NULL,	/* reduction state */
 		    *x, *y;				/* temporaries */
+	struct node **sweep = &headr;			/* gc progress */
+	unsigned long ticks = 0;
 	unsigned depth = 0;
 
 	the_eval_stats.reduce_start++;
@@ -193,6 +263,18 @@ eval_rl:
 	if (!headl)				/* done with R-to-L? */
 		goto rule_reverse;		
 
+	/*
+	 * Sweep garbage to our right under heap pressure, or to finish
+	 * a sweep already under way.  We do this only with headl set,
+	 * as the '*' node (the last one to move right) has no references.
+	 */
+	if ((++ticks & 0xFF) == 0 &&
+	    (sweep != &headr || heap_pressure_high(&the_heap_pressure)) &&
+	    !(sweep = sweep_right(sweep, SWEEP_CHUNK))) {
+		node_heap_calibrate();
+		sweep = &headr;
+	}
+
 	/*
 	 * For most scenarios we simply move to the left without acting.
 	 */
@@ -282,12 +364,20 @@ rule_beta_value:
 	 * has fallen to 0 for the moment, but might come back up as
 	 * we substitute x for the free variable in the body of x
 	 * (creating new references).  So we can't destroy x's body
-	 * yet.
+	 * yet--unless the body doesn't reference its bound variable,
+	 * as when self-applying a function which discards its
+	 * argument (e.g. 'or false q' reduces 'false false q').
+	 * Scanning for the variable costs no more than the copy
+	 * we'd otherwise make, and allocates nothing.
 	 */
 	if (x->nref == 0 && x != y) {
 		if (EVAL_STATS) the_eval_stats.quick_beta_move++;
 		headl = beta_nocopy(headl, node_take_body(x), y, depth,
 				    headl->depth - x->depth);
+	} else if (x->nref == 0 && !beta_uses_var(node_abs_body(x))) {
+		if (EVAL_STATS) the_eval_stats.quick_self_move++;
+		headl = beta_nocopy(headl, node_take_body(x), y, depth,
+				    headl->depth - x->depth);
 	} else
 		headl = beta_reduce(headl, node_abs_body(x), y, depth,
 				    headl->depth - x->depth);
@@ -397,6 +487,7 @@ rule_rename:
 rule_reverse:
 	if (EVAL_STATS) the_eval_stats.rule_reverse++;
 	if (SANITY_CHECK) sanity_check_l(headr, depth);
+	sweep = &headr;			/* L-to-R collects as it goes */
 	/* fall through to eval_lr... */
 
 eval_lr:
@@ -24,7 +24,21 @@
 
 struct node;
 
+struct eval_stats {
+	unsigned long
+		reduce_start, reduce_done,
+		eval_rl, eval_lr,
+		rule_beta_value, rule_beta_inert, rule_rename,
+		rule_move_left, rule_reverse, rule_move_right,
+		rule_enter_abs, rule_exit_abs, rule_collect,
+		quick_inert_unref, quick_value_unref, quick_beta_move,
+		quick_self_move,
+		sweep_scanned, sweep_collected;
+};
+
 extern struct node *reduce(struct node *node);
+extern const struct eval_stats *current_eval_stats(void);
 extern void print_eval_stats(void);
+extern void register_eval_stats(void);
 
 #endif /* LARK_SLC_REDUCE_H */
@@ -25,13 +25,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <engine/memloc.h>
 #include <util/memutil.h>
 #include <util/message.h>
 #include <util/wordbuf.h>
 
 #include "env.h"
 #include "form.h"
-#include "memloc.h"
 #include "node.h"
 #include "term.h"
 
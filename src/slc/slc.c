@@ -20,6 +20,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <errno.h>
 #include <getopt.h>
 #include <glob.h>
 #include <stdio.h>
@@ -28,6 +29,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <engine/stats.h>
 #include <util/memutil.h>
 #include <util/message.h>
 
@@ -35,6 +37,8 @@
 #include "form.h"
 #include "heap.h"
 #include "parse.h"
+#include "perf.h"
+#include "reduce.h"
 #include "slc.h"
 #include "slc.lex.h"
 #include "term.h"
@@ -55,6 +59,7 @@ static void usage(void) __attribute__ ((noreturn));
 static void init(void)
 {
 	node_heap_init();
+	register_eval_stats();
 	env_init();
 }
 
@@ -67,30 +72,53 @@ static void usage(void)
 	"        => read from standard input, otherwise.\n"
 	"Options:\n"
 	"        -e              Empty environment (don't load prelude)\n"
+	"        -j <pathname>   Write statistics as JSON at exit\n"
 	"        -l <pathname>   Load the given file before entering REPL\n"
-	"        -q              Quieter output\n"
+	"        -m <nodes>      Limit the node heap to this many nodes,\n"
+	"                        rounded up to a multiple of %zu\n"
+	"        -p <pathname>   Write deterministic reduction costs at exit\n"
+	"        -q              Quieter output\n",
+	NODE_HEAP_CHUNK
 	);
 	exit(EXIT_FAILURE);
 }
 
+/*
+ * A malformed limit would otherwise quietly become the smallest heap.
+ */
+static size_t parse_nodes(const char *arg)
+{
+	char *end;
+	errno = 0;
+	unsigned long nodes = strtoul(arg, &end, 0);
+	if (errno || end == arg || *end || !nodes || *arg == '-') {
+		fprintf(stderr, "Invalid node heap limit: '%s'\n", arg);
+		usage();
+	}
+	return nodes;
+}
+
 int main(int argc, char *argv[])
 {
 	set_execname(argv[0]);
-	init();
 
 	int c;
 	bool use_prelude = true;
-	const char *load_file = NULL;
-	while ((c = getopt(argc, argv, "el:q")) != -1) {
+	const char *load_file = NULL, *perf_file = NULL, *stats_file = NULL;
+	while ((c = getopt(argc, argv, "ej:l:m:p:q")) != -1) {
 		switch (c) {
 		case 'e': use_prelude = false; break;
+		case 'j': stats_file = optarg; break;
 		case 'l': load_file = optarg; break;
+		case 'm': node_heap_limit = parse_nodes(optarg); break;
+		case 'p': perf_file = optarg; break;
 		case 'q': quiet_setting = 1; break;
 		default: usage();
 		}
 	}
 	if (optind + 1 < argc)
 		usage();
+	init();
 
 	if (use_prelude)
 		parse_include("prelude.slc");
@@ -132,5 +160,9 @@ int main(int argc, char *argv[])
 	}
 
 done:
+	if (perf_file && write_perf(perf_file))
+		result = 1;
+	if (stats_file && stats_write_json(stats_file))
+		result = 1;
 	return result;
 }
@@ -22,10 +22,10 @@
 
 #include <stdio.h>
 
+#include <engine/memloc.h>
 #include <util/memutil.h>
 #include <util/message.h>
 
-#include "memloc.h"
 #include "term.h"
 
 static struct term *
@@ -45,6 +45,7 @@ const char *global_error_prefix = "";
 int failure_exit_code = EXIT_FAILURE;
 unsigned global_message_threshold = 20;		/* errors and warnings */
 const char *unreachable_message = "Should never get here!\n";
+void (*panic_hook)(const char *message);
 
 void set_execname(const char *execpath)
 {
@@ -123,6 +124,8 @@ void
 panic_real(const char *file, const char *function, int line,
 	   const char *message)
 {
+	if (panic_hook)
+		panic_hook(message);
 	fprintf(stderr, "%s: %s in %s (%d): PANIC: %s\n", execname,
 		file, function, line, message);
 	print_backtrace();
@@ -133,6 +136,11 @@ void
 ppanic_real(const char *file, const char *function, int line,
 	    const char *errstr)
 {
+	if (panic_hook) {
+		char buf [256];
+		snprintf(buf, sizeof buf, "%s: %s\n", errstr, strerror(errno));
+		panic_hook(buf);
+	}
 	fprintf(stderr, "%s: %s in %s (%d): PANIC: %s: %s\n",
 		execname, file, function, line, errstr, strerror(errno));
 	print_backtrace();
@@ -145,6 +153,13 @@ panicf_real(const char *file, const char *function, int line,
 {
 	va_list ap;
 
+	if (panic_hook) {
+		char buf [256];
+		va_start(ap, format);
+		vsnprintf(buf, sizeof buf, format, ap);
+		va_end(ap);
+		panic_hook(buf);
+	}
 	fprintf(stderr, "%s: %s in %s (%d): PANIC: ", execname,
 		file, function, line);
 	va_start(ap, format);
@@ -94,6 +94,12 @@ extern unsigned global_message_threshold;
 #define ppanic(message) \
 	ppanic_real(__FILE__, __func__, __LINE__, message)
 
+/*
+ * If set, called with the formatted message before a panic exits; an
+ * embedder may longjmp() out of it to recover instead.
+ */
+extern void (*panic_hook)(const char *message);
+
 /* marker for unreachable code */
 extern const char *unreachable_message;
 #define unreachable() panic(unreachable_message)